@@ -23,4 +23,8 @@ __kernel void SVMhelloworld(__global char* in, __global char* out)
 {
 	int num = get_global_id(0);
 	out[num] = in[num];
-}
\ No newline at end of file
+}
+
+__kernel void empty()
+{
+}
@@ -23,10 +23,18 @@ THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
 #include <iostream>
 #include <string>
 #include <fstream>
+#include <vector>
+#include <chrono>
+
+#include "../common/CLSetup.hpp"
+#include "../common/Histogram.hpp"
+#include "../common/BenchmarkRegistry.hpp"
 
 #define SUCCESS 0
 #define FAILURE 1
 
+SVM_BENCH_NAMESPACE_BEGIN(onedarray)
+
 using namespace std;
 
 /* convert the kernel file into a string */
@@ -62,74 +70,59 @@ int convertToString(const char *filename, std::string& s)
 
 int svm();
 int non_svm();
-
-
+int host_ptr();
+int launch_overhead();
+
+/* Launch-overhead run: samples per measurement, and whether to print the
+   full histogram for every payload size instead of only the smallest and
+   largest one. Usage: prog [iterations [all]] */
+int Iterations = 1000;
+bool AllHistograms = false;
+
+
+#ifdef SVM_BENCH_DRIVER
+static BenchmarkRegistrar registrar(Benchmark("1Darray", "1Darray")
+	.param("iterations", "launches per measurement in launch_overhead", &Iterations)
+	.param("all_histograms", "print every latency histogram", &AllHistograms)
+	.mode("svm", svm)
+	.mode("non_svm", non_svm)
+	.mode("host_ptr", host_ptr)
+	.mode("launch_overhead", launch_overhead));
+#else
 int main(int argc, char* argv[])
 {
+  if (argc > 1)
+    Iterations = atoi(argv[1]);
+  if (argc > 2)
+    AllHistograms = strcmp(argv[2], "all") == 0;
+
   std::cout << " SVM: \n" << std::endl;
   int isSuccess = svm();
   
   std::cout << "\n Non-SVM: " << std::endl;
   isSuccess = non_svm();
   
+  std::cout << "\n Host-Ptr: " << std::endl;
+  isSuccess = host_ptr();
+  
+  std::cout << "\n Launch overhead: " << std::endl;
+  isSuccess = launch_overhead();
+  return isSuccess;
 }
+#endif
 
 
 
 int svm(){
-/*Step1: Getting platforms and choose an available one.*/
-	cl_uint numPlatforms;	//the NO. of platforms
-	cl_platform_id platform = NULL;	//the chosen platform
-	cl_int	status = clGetPlatformIDs(0, NULL, &numPlatforms);
-	if (status != CL_SUCCESS)
-	{
-		cout << "Error: Getting platforms!" << endl;
+/*Step1-4: Platform, device, context and command queue.*/
+	CLEnv env;
+	if (setupCL(env, 0) != SUCCESS)
 		return FAILURE;
-	}
-
-	/*For clarity, choose the first available platform. */
-	if(numPlatforms > 0)
-	{
-		cl_platform_id* platforms = (cl_platform_id* )malloc(numPlatforms* sizeof(cl_platform_id));
-		status = clGetPlatformIDs(numPlatforms, platforms, NULL);
-		platform = platforms[0];
-		free(platforms);
-	}
+	cl_device_id *devices = env.devices;
+	cl_context context = env.context;
+	cl_command_queue commandQueue = env.commandQueue;
+	cl_int status = CL_SUCCESS;
 
-/*Step 2:Query the platform and choose the first GPU device if has one.Otherwise use the CPU as device.*/
-	cl_uint				numDevices = 0;
-	cl_device_id        *devices;
-	status = clGetDeviceIDs(platform, CL_DEVICE_TYPE_GPU, 0, NULL, &numDevices);	
-	if (numDevices == 0)	//no GPU available.
-	{
-		cout << "No GPU device available." << endl;
-		cout << "Choose CPU as default device." << endl;
-		status = clGetDeviceIDs(platform, CL_DEVICE_TYPE_CPU, 0, NULL, &numDevices);	
-		devices = (cl_device_id*)malloc(numDevices * sizeof(cl_device_id));
-		status = clGetDeviceIDs(platform, CL_DEVICE_TYPE_CPU, numDevices, devices, NULL);
-	}
-	else
-	{
-		devices = (cl_device_id*)malloc(numDevices * sizeof(cl_device_id));
-		status = clGetDeviceIDs(platform, CL_DEVICE_TYPE_GPU, numDevices, devices, NULL);
-	}
-	
-
-/*Step 3: Create context.*/
-	cl_context context = clCreateContext(NULL,1, devices,NULL,NULL,NULL);
-	
-/*Step 4: Creating command queue associate with the context.*/
-	/*old func. code
-		cl_command_queue commandQueue = clCreateCommandQueue(context, devices[0], 0, NULL);
-    	*/
-	/*new func.
-    	*	cl_command_queue clCreateCommandQueueWithProperties(
-			cl_context context, 
-			cl_device_id device, 
-			const cl_queue_properties *properties, 
-			cl_int *errcode_ret)
-	*/
-	cl_command_queue commandQueue = clCreateCommandQueueWithProperties(context, devices[0], 0, NULL);
 	//cl_command_queue commandQueue = clCreateCommandQueue(context, devices[0], 0, NULL);
 
 /*Step 5: Create program object */
@@ -143,6 +136,13 @@ int svm(){
 /*Step 6: Build program. */
 	const char options[] = "-cl-std=CL2.0";
 	status = clBuildProgram(program, 1,devices, options,NULL,NULL);
+	if (status != CL_SUCCESS)
+	{
+		cout << "Error: building " << filename << " failed, status: " << status << endl;
+		clReleaseProgram(program);
+		releaseCL(env);
+		return FAILURE;
+	}
 
 /*Step 7: Create kernel object */
 	cl_kernel kernel = clCreateKernel(program,"SVMhelloworld", NULL);
@@ -200,16 +200,9 @@ int svm(){
 	clSVMFree(context, outputBuffer);  
 	status = clReleaseKernel(kernel);				//Release kernel.
 	status = clReleaseProgram(program);				//Release the program object.
-	status = clReleaseCommandQueue(commandQueue);	//Release  Command queue.
-	status = clReleaseContext(context);				//Release context.
+	releaseCL(env);
 
 
-	if (devices != NULL)
-	{
-		free(devices);
-		devices = NULL;
-	}
-
 	cout<<"Program passed!\n";
   return SUCCESS;
 }
@@ -218,50 +211,14 @@ int svm(){
 
 int non_svm(){
 
-/*Step1: Getting platforms and choose an available one.*/
-	cl_uint numPlatforms; //the NO. of platforms
-	cl_platform_id platform = NULL; //the chosen platform
-	cl_int status = clGetPlatformIDs(0, NULL, &numPlatforms);
-	if (status != CL_SUCCESS)
-	{
-		cout << "Error: Getting platforms!" << endl;
+/*Step1-4: Platform, device, context and command queue.*/
+	CLEnv env;
+	if (setupCL(env, 0) != SUCCESS)
 		return FAILURE;
-	}
-
-	/*For clarity, choose the first available platform. */
-	if (numPlatforms > 0)
-	{
-		cl_platform_id* platforms = 
-                     (cl_platform_id*)malloc(numPlatforms * sizeof(cl_platform_id));
-		status = clGetPlatformIDs(numPlatforms, platforms, NULL);
-		platform = platforms[0];
-		free(platforms);
-	}
-
-	/*Step 2:Query the platform and choose the first GPU device if has one.Otherwise use the CPU as device.*/
-	cl_uint numDevices = 0;
-	cl_device_id        *devices;
-	status = clGetDeviceIDs(platform, CL_DEVICE_TYPE_GPU, 0, NULL, &numDevices);
-	if (numDevices == 0) //no GPU available.
-	{
-		cout << "No GPU device available." << endl;
-		cout << "Choose CPU as default device." << endl;
-		status = clGetDeviceIDs(platform, CL_DEVICE_TYPE_CPU, 0, NULL, &numDevices);
-		devices = (cl_device_id*)malloc(numDevices * sizeof(cl_device_id));
-		status = clGetDeviceIDs(platform, CL_DEVICE_TYPE_CPU, numDevices, devices, NULL);
-	}
-	else
-	{
-		devices = (cl_device_id*)malloc(numDevices * sizeof(cl_device_id));
-		status = clGetDeviceIDs(platform, CL_DEVICE_TYPE_GPU, numDevices, devices, NULL);
-	}
-
-
-	/*Step 3: Create context.*/
-	cl_context context = clCreateContext(NULL, 1, devices, NULL, NULL, NULL);
-
-	/*Step 4: Creating command queue associate with the context.*/
-	cl_command_queue commandQueue = clCreateCommandQueue(context, devices[0], 0, NULL);
+	cl_device_id *devices = env.devices;
+	cl_context context = env.context;
+	cl_command_queue commandQueue = env.commandQueue;
+	cl_int status = CL_SUCCESS;
 
 	/*Step 5: Create program object */
 	const char *filename = "HelloWorld_Kernel.cl";
@@ -273,6 +230,13 @@ int non_svm(){
 
 	/*Step 6: Build program. */
 	status = clBuildProgram(program, 1, devices, NULL, NULL, NULL);
+	if (status != CL_SUCCESS)
+	{
+		cout << "Error: building " << filename << " failed, status: " << status << endl;
+		clReleaseProgram(program);
+		releaseCL(env);
+		return FAILURE;
+	}
 
 	/*Step 7: Initial input,output for the host and create memory objects for the kernel*/
 	const char* input = "GdkknVnqkc";
@@ -317,8 +281,7 @@ int non_svm(){
 	status = clReleaseProgram(program); //Release the program object.
 	status = clReleaseMemObject(inputBuffer); //Release mem object.
 	status = clReleaseMemObject(outputBuffer);
-	status = clReleaseCommandQueue(commandQueue); //Release  Command queue.
-	status = clReleaseContext(context); //Release context.
+	releaseCL(env);
 
 	if (output != NULL)
 	{
@@ -326,13 +289,250 @@ int non_svm(){
 		output = NULL;
 	}
 
-	if (devices != NULL)
+	std::cout << "Passed!\n";
+	return SUCCESS;
+ 
+}
+
+
+
+int host_ptr(){
+
+/*Step1-4: Platform, device, context and command queue.*/
+	CLEnv env;
+	if (setupCL(env, 0) != SUCCESS)
+		return FAILURE;
+
+/*Step 5-6: Create and build program. */
+	cl_program program = buildProgramFromFile(env, "HelloWorld_Kernel.cl", NULL);
+	if (program == NULL)
 	{
-		free(devices);
-		devices = NULL;
+		releaseCL(env);
+		return FAILURE;
+	}
+
+/*Step 7: Zero-copy buffers: the input wraps a page-aligned host allocation
+  (CL_MEM_USE_HOST_PTR), the output is runtime-allocated host memory
+  (CL_MEM_ALLOC_HOST_PTR) that is mapped instead of read back.*/
+	cl_int status;
+	const char* input = "GdkknVnqkc";
+	size_t strlength = strlen(input);
+	cout << "input string:" << endl;
+	cout << input << endl;
+
+	char *in = (char *)alignedHostAlloc(strlength + 1);
+	memcpy(in, input, strlength + 1);
+
+	cl_mem inputBuffer = clCreateBuffer(env.context, CL_MEM_READ_ONLY | CL_MEM_USE_HOST_PTR, 
+                             (strlength + 1) * sizeof(char), in, NULL);
+	cl_mem outputBuffer = clCreateBuffer(env.context, CL_MEM_WRITE_ONLY | CL_MEM_ALLOC_HOST_PTR, 
+                              (strlength + 1) * sizeof(char), NULL, NULL);
+
+/*Step 8: Create kernel object */
+	cl_kernel kernel = clCreateKernel(program, "helloworld", NULL);
+
+/*Step 9: Sets Kernel arguments.*/
+	status = clSetKernelArg(kernel, 0, sizeof(cl_mem), (void *)&inputBuffer);
+	status = clSetKernelArg(kernel, 1, sizeof(cl_mem), (void *)&outputBuffer);
+
+/*Step 10: Running the kernel.*/
+	size_t global_work_size[1] = { strlength };
+	status = clEnqueueNDRangeKernel(env.commandQueue, kernel, 1, NULL, 
+                                        global_work_size, NULL, 0, NULL, NULL);
+
+/*Step 11: Map the output instead of reading it back.*/
+	char *output = (char *)clEnqueueMapBuffer(env.commandQueue, outputBuffer, CL_TRUE, CL_MAP_READ, 
+                 0, (strlength + 1) * sizeof(char), 0, NULL, NULL, &status);
+	cout << "Step 11, clEnqueueMapBuffer, status: " << status << std::endl;
+
+	cout << "\noutput string:" << endl;
+	for(size_t i = 0; i < strlength; i++){
+		cout <<"#" << i << ":" << output[i] << endl;
 	}
 
+	status = clEnqueueUnmapMemObject(env.commandQueue, outputBuffer, output, 0, NULL, NULL);
+	clFinish(env.commandQueue);
+
+/*Step 12: Clean the resources.*/
+	status = clReleaseKernel(kernel); //Release kernel.
+	status = clReleaseProgram(program); //Release the program object.
+	status = clReleaseMemObject(inputBuffer); //Release mem object.
+	status = clReleaseMemObject(outputBuffer);
+	releaseCL(env);
+
+	free(in);
+
 	std::cout << "Passed!\n";
 	return SUCCESS;
- 
-}
\ No newline at end of file
+}
+
+
+
+typedef std::chrono::steady_clock Clock;
+
+double elapsedNs(Clock::time_point start)
+{
+	return std::chrono::duration<double, std::nano>(Clock::now() - start).count();
+}
+
+/* All measurements taken for one payload size. */
+struct OverheadSample
+{
+	LatencyHistogram setArgSVM;      // clSetKernelArgSVMPointer
+	LatencyHistogram setArgBuffer;   // clSetKernelArg with a cl_mem
+	LatencyHistogram emptyEnqueue;   // clEnqueueNDRangeKernel call alone
+	LatencyHistogram emptyRoundTrip; // enqueue + clFinish
+	LatencyHistogram svmKernel;      // SVMhelloworld over the payload + clFinish
+	LatencyHistogram bufferKernel;   // helloworld over the payload + clFinish
+	LatencyHistogram svmMapUnmap;    // blocking clEnqueueSVMMap + unmap + clFinish
+	LatencyHistogram bufferMapUnmap; // blocking clEnqueueMapBuffer + unmap + clFinish
+	LatencyHistogram idleFinish;     // clFinish on an empty queue
+
+	OverheadSample()
+		: setArgSVM("setArg SVM pointer"), setArgBuffer("setArg cl_mem"),
+		  emptyEnqueue("empty enqueue (call)"), emptyRoundTrip("empty enqueue+finish"),
+		  svmKernel("SVMhelloworld+finish"), bufferKernel("helloworld+finish"),
+		  svmMapUnmap("SVM map/unmap"), bufferMapUnmap("buffer map/unmap"),
+		  idleFinish("clFinish idle") {}
+
+	void print(std::ostream &os, bool histograms) const
+	{
+		const LatencyHistogram *all[] = { &setArgSVM, &setArgBuffer, &emptyEnqueue, &emptyRoundTrip,
+		                                  &svmKernel, &bufferKernel, &svmMapUnmap, &bufferMapUnmap,
+		                                  &idleFinish };
+		for (size_t i = 0; i < sizeof(all) / sizeof(all[0]); i++)
+		{
+			if (histograms)
+				all[i]->print(os);
+			else
+				all[i]->printSummary(os);
+		}
+	}
+};
+
+
+/* Times every small-request building block in isolation, for payloads of
+   1 byte to 1 MB. Each sample is one API call (or one round trip), so the
+   histograms show the spread a single small request actually sees. */
+int launch_overhead(){
+
+/*Step1-4: Platform, device, context and command queue.*/
+	CLEnv env;
+	if (setupCL(env, 0) != SUCCESS)
+		return FAILURE;
+
+/*Step 5-6: Create and build program. */
+	cl_program program = buildProgramFromFile(env, "HelloWorld_Kernel.cl", "-cl-std=CL2.0");
+	if (program == NULL)
+	{
+		releaseCL(env);
+		return FAILURE;
+	}
+
+/*Step 7: Create kernel objects */
+	cl_kernel svmKernel = clCreateKernel(program, "SVMhelloworld", NULL);
+	cl_kernel bufferKernel = clCreateKernel(program, "helloworld", NULL);
+	cl_kernel emptyKernel = clCreateKernel(program, "empty", NULL);
+	cl_command_queue queue = env.commandQueue;
+
+	cout << Iterations << " samples per measurement, times in microseconds" << endl;
+	cout.setf(ios::fixed);
+	cout.precision(2);
+
+	const size_t MAX_PAYLOAD = 1 << 20;
+	for (size_t bytes = 1; bytes <= MAX_PAYLOAD; bytes *= 4)
+	{
+		OverheadSample sample;
+
+	/*Step 8: SVM and buffer copies of the payload.*/
+		char *svmIn = (char *)clSVMAlloc(env.context, CL_MEM_READ_WRITE, bytes, 0);
+		char *svmOut = (char *)clSVMAlloc(env.context, CL_MEM_READ_WRITE, bytes, 0);
+		cl_mem bufIn = clCreateBuffer(env.context, CL_MEM_READ_WRITE, bytes, NULL, NULL);
+		cl_mem bufOut = clCreateBuffer(env.context, CL_MEM_READ_WRITE, bytes, NULL, NULL);
+		clEnqueueSVMMemFill(queue, svmIn, "a", 1, bytes, 0, NULL, NULL);
+		clEnqueueFillBuffer(queue, bufIn, "a", 1, 0, bytes, 0, NULL, NULL);
+		clFinish(queue);
+
+		size_t global_work_size[1] = { bytes };
+		size_t one[1] = { 1 };
+
+		/* warm up: first launch pays for lazy allocation and kernel upload */
+		clSetKernelArgSVMPointer(svmKernel, 0, svmIn);
+		clSetKernelArgSVMPointer(svmKernel, 1, svmOut);
+		clSetKernelArg(bufferKernel, 0, sizeof(cl_mem), &bufIn);
+		clSetKernelArg(bufferKernel, 1, sizeof(cl_mem), &bufOut);
+		clEnqueueNDRangeKernel(queue, svmKernel, 1, NULL, global_work_size, NULL, 0, NULL, NULL);
+		clEnqueueNDRangeKernel(queue, bufferKernel, 1, NULL, global_work_size, NULL, 0, NULL, NULL);
+		clEnqueueNDRangeKernel(queue, emptyKernel, 1, NULL, one, NULL, 0, NULL, NULL);
+		clFinish(queue);
+
+	/*Step 9: Sample each operation.*/
+		for (int i = 0; i < Iterations; i++)
+		{
+			Clock::time_point t = Clock::now();
+			clSetKernelArgSVMPointer(svmKernel, 0, svmIn);
+			sample.setArgSVM.add(elapsedNs(t));
+
+			t = Clock::now();
+			clSetKernelArg(bufferKernel, 0, sizeof(cl_mem), &bufIn);
+			sample.setArgBuffer.add(elapsedNs(t));
+
+			t = Clock::now();
+			clEnqueueNDRangeKernel(queue, emptyKernel, 1, NULL, one, NULL, 0, NULL, NULL);
+			sample.emptyEnqueue.add(elapsedNs(t));
+			clFinish(queue);
+
+			t = Clock::now();
+			clEnqueueNDRangeKernel(queue, emptyKernel, 1, NULL, one, NULL, 0, NULL, NULL);
+			clFinish(queue);
+			sample.emptyRoundTrip.add(elapsedNs(t));
+
+			t = Clock::now();
+			clEnqueueNDRangeKernel(queue, svmKernel, 1, NULL, global_work_size, NULL, 0, NULL, NULL);
+			clFinish(queue);
+			sample.svmKernel.add(elapsedNs(t));
+
+			t = Clock::now();
+			clEnqueueNDRangeKernel(queue, bufferKernel, 1, NULL, global_work_size, NULL, 0, NULL, NULL);
+			clFinish(queue);
+			sample.bufferKernel.add(elapsedNs(t));
+
+			t = Clock::now();
+			clEnqueueSVMMap(queue, CL_TRUE, CL_MAP_READ, svmOut, bytes, 0, NULL, NULL);
+			clEnqueueSVMUnmap(queue, svmOut, 0, NULL, NULL);
+			clFinish(queue);
+			sample.svmMapUnmap.add(elapsedNs(t));
+
+			t = Clock::now();
+			void *mapped = clEnqueueMapBuffer(queue, bufOut, CL_TRUE, CL_MAP_READ, 0, bytes, 0, NULL, NULL, NULL);
+			clEnqueueUnmapMemObject(queue, bufOut, mapped, 0, NULL, NULL);
+			clFinish(queue);
+			sample.bufferMapUnmap.add(elapsedNs(t));
+
+			t = Clock::now();
+			clFinish(queue);
+			sample.idleFinish.add(elapsedNs(t));
+		}
+
+	/*Step 10: Report.*/
+		bool histograms = AllHistograms || bytes == 1 || bytes == MAX_PAYLOAD;
+		cout << "\nPayload " << bytes << " bytes\n------------------------------ " << endl;
+		sample.print(cout, histograms);
+
+	/*Step 11: Clean the per-size resources.*/
+		clSVMFree(env.context, svmIn);
+		clSVMFree(env.context, svmOut);
+		clReleaseMemObject(bufIn);
+		clReleaseMemObject(bufOut);
+	}
+
+/*Step 12: Clean the resources.*/
+	clReleaseKernel(svmKernel);
+	clReleaseKernel(bufferKernel);
+	clReleaseKernel(emptyKernel);
+	clReleaseProgram(program);
+	releaseCL(env);
+	return SUCCESS;
+}
+
+SVM_BENCH_NAMESPACE_END
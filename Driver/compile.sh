@@ -0,0 +1,3 @@
+#!bin/bash
+
+  g++ -std=c++11 -O2 -I${VIENNACL_DIR:-/home/ctchao/ViennaCLPP} -DSVM_BENCH_DRIVER main.cpp ../1Darray/prog.cpp ../GEMM/prog.cpp ../GEMV/prog.cpp ../VectorAdd/prog.cpp ../ViennaCL_Copy/prog.cpp -lOpenCL -Wno-deprecated-declarations -pthread -o prog
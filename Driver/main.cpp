@@ -0,0 +1,391 @@
+/**********************************************************************
+One binary for all registered benchmarks (common/BenchmarkRegistry.hpp).
+
+The programs are compiled in with -DSVM_BENCH_DRIVER (see compile.sh);
+every mode whose "benchmark/mode" name matches the filter runs in this
+process, against one shared OpenCL context and queue, and one combined
+report (status and wall time per mode, then the roofline table and
+roofline.csv) is printed at the end.
+
+Usage: prog [options] [regex]
+	--list                 list benchmarks, modes and parameters
+	--set bench.param=v    set a parameter, e.g. --set GEMM.size=1024
+	--repeat n             run each selected mode n times (default 1)
+	--root dir             directory holding the benchmark directories
+	                       (default ..)
+	--soak seconds         run the selected modes round robin for this
+	                       long (0: until Ctrl-C) instead of once each
+	--metrics path         soak metrics file, Prometheus text format
+	                       (default svm_metrics.prom)
+	--flush seconds        rewrite the metrics file this often (default 10)
+
+Every mode gets its context from setupCL(), so all of them share the
+driver's; a mode asking for other queue properties (no profiling) gets
+its own queue in that context.
+
+In soak mode every pass over the selected modes is one iteration. The
+metrics file carries, per mode, runs, failures, rolling throughput,
+p50/p90/p99 run time and the drift of the median against the first runs;
+and for the process the live and peak SVM bytes, RSS, and a 0/1 leak flag
+per resource that is set when it grew over SOAK_LEAK_WINDOW consecutive
+iterations (see common/Telemetry.hpp).
+
+With SVM_TRACE=<file.json> the whole run is one Chrome trace timeline
+(common/Trace.hpp) in which every mode is a host span.
+********************************************************************/
+
+#include <CL/cl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <iostream>
+#include <iomanip>
+#include <string>
+#include <vector>
+#include <regex>
+#include <chrono>
+#include <signal.h>
+
+#include "../common/CLSetup.hpp"
+#include "../common/PerfCounters.hpp"
+#include "../common/Roofline.hpp"
+#include "../common/BenchmarkRegistry.hpp"
+#include "../common/Telemetry.hpp"
+#include "../common/Trace.hpp"
+
+using namespace std;
+
+const size_t SOAK_LEAK_WINDOW = 8;         // iterations
+const double SOAK_RSS_SLACK = 1 << 20;      // bytes of RSS growth tolerated over the window
+
+struct ModeResult
+{
+	string name;
+	int status;
+	int runs;
+	double seconds;   // best of runs
+};
+
+/* one selected benchmark mode */
+struct Selected
+{
+	Benchmark *benchmark;
+	size_t mode;
+	string name;
+};
+
+static volatile sig_atomic_t interrupted = 0;
+
+static void onInterrupt(int)
+{
+	interrupted = 1;
+}
+
+static void listBenchmarks()
+{
+	vector<Benchmark> &benchmarks = BenchmarkRegistry::instance().benchmarks();
+	for (size_t b = 0; b < benchmarks.size(); b++)
+	{
+		cout << benchmarks[b].name << " (" << benchmarks[b].directory << ")" << endl;
+		for (size_t m = 0; m < benchmarks[b].modes.size(); m++)
+			cout << "  " << benchmarks[b].name << "/" << benchmarks[b].modes[m].name << endl;
+		for (size_t p = 0; p < benchmarks[b].params.size(); p++)
+			cout << "  --set " << benchmarks[b].name << "." << benchmarks[b].params[p].name << "="
+			     << benchmarks[b].params[p].get() << "  " << benchmarks[b].params[p].description << endl;
+	}
+}
+
+/* "GEMM.size=1024" */
+static int setParam(const string &assignment)
+{
+	size_t dot = assignment.find('.'), eq = assignment.find('=');
+	if (dot == string::npos || eq == string::npos || eq < dot)
+	{
+		cout << "Error: expected bench.param=value, got " << assignment << endl;
+		return FAILURE;
+	}
+	Benchmark *benchmark = BenchmarkRegistry::instance().find(assignment.substr(0, dot));
+	BenchmarkParam *param = benchmark != NULL ? benchmark->findParam(assignment.substr(dot + 1, eq - dot - 1)) : NULL;
+	if (param == NULL)
+	{
+		cout << "Error: unknown parameter " << assignment.substr(0, eq) << endl;
+		return FAILURE;
+	}
+	param->set(assignment.substr(eq + 1));
+	return SUCCESS;
+}
+
+/* Run one mode from its own directory; wall seconds in *seconds. */
+static int runMode(const Selected &selected, const string &root, const char *cwd, double *seconds)
+{
+	string dir = root + "/" + selected.benchmark->directory;
+	if (chdir(dir.c_str()) != 0)
+	{
+		cout << "Error: cannot enter " << dir << endl;
+		return FAILURE;
+	}
+	chrono::steady_clock::time_point start = chrono::steady_clock::now();
+	int status;
+	{
+		TraceSpan span(selected.name, "mode");
+		status = selected.benchmark->modes[selected.mode].run();
+	}
+	*seconds = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+	if (chdir(cwd) != 0)
+		return FAILURE;
+	return status;
+}
+
+static string modeLabel(const string &name)
+{
+	return "mode=\"" + name + "\"";
+}
+
+static void writeMetrics(MetricsFile &metrics, const vector<Selected> &selected, const vector<RollingWindow> &windows,
+                         const vector<GrowthDetector> &growth, size_t iterations, double uptime)
+{
+	for (size_t i = 0; i < selected.size(); i++)
+	{
+		string label = modeLabel(selected[i].name);
+		metrics.counter("svm_bench_mode_runs_total", "Completed runs per benchmark mode.", windows[i].runs(), label);
+		metrics.counter("svm_bench_mode_failures_total", "Runs that returned FAILURE.", windows[i].failures(), label);
+		metrics.gauge("svm_bench_mode_throughput", "Runs per second over the rolling window.", windows[i].throughput(), label);
+		const double quantiles[] = { 50, 90, 99 };
+		const char *quantileLabels[] = { "0.5", "0.9", "0.99" };
+		for (int q = 0; q < 3; q++)
+			metrics.gauge("svm_bench_mode_seconds", "Run time percentiles over the rolling window.",
+			              windows[i].percentile(quantiles[q]), label + ",quantile=\"" + quantileLabels[q] + "\"");
+		metrics.gauge("svm_bench_mode_drift", "Rolling median run time over the median of the first runs.", windows[i].drift(), label);
+	}
+	metrics.gauge("svm_bench_svm_bytes", "Live SVM bytes allocated through clSVMAlloc.", SvmAccounting::instance().bytes());
+	metrics.gauge("svm_bench_svm_peak_bytes", "Peak live SVM bytes.", SvmAccounting::instance().peak());
+	metrics.counter("svm_bench_svm_allocations_total", "clSVMAlloc calls that succeeded.", SvmAccounting::instance().allocations());
+	metrics.gauge("svm_bench_rss_bytes", "Resident set size of the driver process.", residentBytes());
+	for (size_t g = 0; g < growth.size(); g++)
+		metrics.gauge("svm_bench_leak_suspected", "1 if the resource grew monotonically over the last iterations.",
+		              growth[g].suspected() ? 1 : 0, "resource=\"" + growth[g].resource() + "\"");
+	metrics.counter("svm_bench_iterations_total", "Completed passes over the selected modes.", iterations);
+	metrics.gauge("svm_bench_uptime_seconds", "Seconds since the soak started.", uptime);
+	if (!metrics.flush())
+		cout << "Error: cannot write " << metrics.path() << endl;
+}
+
+/* Round robin over the selected modes until soakSeconds have passed (0:
+   until SIGINT), with the metrics file rewritten every flushSeconds. */
+static int runSoak(const vector<Selected> &selected, const string &root, const char *cwd,
+                   double soakSeconds, const string &metricsPath, double flushSeconds)
+{
+	if (selected.empty())
+	{
+		cout << "Error: no mode matches the filter" << endl;
+		return FAILURE;
+	}
+	signal(SIGINT, onInterrupt);
+	signal(SIGTERM, onInterrupt);
+
+	MetricsFile metrics(metricsPath);
+	vector<RollingWindow> windows(selected.size());
+	vector<GrowthDetector> growth;
+	growth.push_back(GrowthDetector("rss", SOAK_LEAK_WINDOW, SOAK_RSS_SLACK));
+	growth.push_back(GrowthDetector("svm", SOAK_LEAK_WINDOW, 0.0));
+	vector<bool> reported(growth.size(), false);
+
+	cout << "Soak: " << selected.size() << " modes, " << (soakSeconds > 0 ? to_string((int)soakSeconds) + " s" : string("until interrupted"))
+	     << ", metrics in " << metricsPath << " every " << flushSeconds << " s" << endl;
+
+	chrono::steady_clock::time_point start = chrono::steady_clock::now(), lastFlush = start;
+	size_t iterations = 0;
+	int failures = 0;
+	while (!interrupted)
+	{
+		for (size_t i = 0; i < selected.size() && !interrupted; i++)
+		{
+			cout << "\n\n" << selected[i].name << " (soak)\n------------------------------ " << endl;
+			double seconds = 0.0;
+			int status = runMode(selected[i], root, cwd, &seconds);
+			windows[i].add(seconds, status != SUCCESS);
+			failures += status != SUCCESS;
+
+			double sinceFlush = chrono::duration<double>(chrono::steady_clock::now() - lastFlush).count();
+			if (sinceFlush >= flushSeconds)
+			{
+				writeMetrics(metrics, selected, windows, growth, iterations,
+				             chrono::duration<double>(chrono::steady_clock::now() - start).count());
+				lastFlush = chrono::steady_clock::now();
+			}
+		}
+		if (interrupted)
+			break;
+
+	/*One iteration done: sample memory (the first pass warms caches and builds programs).*/
+		iterations++;
+		size_t rss = residentBytes(), svm = SvmAccounting::instance().bytes();
+		if (iterations > 1)
+		{
+			growth[0].add((double)rss);
+			growth[1].add((double)svm);
+		}
+		double uptime = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+		cout << fixed << setprecision(1) << "\n[soak] iteration " << iterations << ", " << uptime << " s, rss "
+		     << rss / 1048576.0 << " MiB, svm " << svm / 1048576.0 << " MiB (peak "
+		     << SvmAccounting::instance().peak() / 1048576.0 << "), failures " << failures << endl;
+		cout.unsetf(ios::fixed);
+		for (size_t g = 0; g < growth.size(); g++)
+		{
+			if (growth[g].suspected() && !reported[g])
+				cout << "[soak] WARNING: " << growth[g].resource() << " grew in each of the last " << SOAK_LEAK_WINDOW
+				     << " iterations (+" << growth[g].growth() / 1048576.0 << " MiB): possible leak" << endl;
+			reported[g] = growth[g].suspected();
+		}
+		if (soakSeconds > 0 && uptime >= soakSeconds)
+			break;
+	}
+
+	writeMetrics(metrics, selected, windows, growth, iterations,
+	             chrono::duration<double>(chrono::steady_clock::now() - start).count());
+	signal(SIGINT, SIG_DFL);
+	signal(SIGTERM, SIG_DFL);
+
+	cout << "\n\nSoak summary (" << iterations << " iterations)\n------------------------------ " << endl;
+	cout << fixed << setprecision(3);
+	for (size_t i = 0; i < selected.size(); i++)
+		cout << setw(28) << left << selected[i].name << right << setw(7) << windows[i].runs() << " runs"
+		     << setw(10) << windows[i].percentile(50) << " s p50" << setw(10) << windows[i].percentile(99) << " s p99"
+		     << setw(8) << setprecision(2) << windows[i].drift() << "x drift" << setprecision(3)
+		     << (windows[i].failures() ? "  FAILURES: " + to_string(windows[i].failures()) : string()) << endl;
+	cout.unsetf(ios::fixed);
+
+	bool leak = false;
+	for (size_t g = 0; g < growth.size(); g++)
+		leak = leak || growth[g].suspected();
+	return failures == 0 && !leak ? SUCCESS : FAILURE;
+}
+
+int main(int argc, char* argv[])
+{
+	PerfCounters::instance();  // SVM_PERF_COUNTERS=1: open before the runtime starts threads
+
+	string filter = ".*", root = "..", metricsPath = "svm_metrics.prom";
+	int repeat = 1;
+	double soakSeconds = -1.0, flushSeconds = 10.0;
+	for (int i = 1; i < argc; i++)
+	{
+		string arg = argv[i];
+		if (arg == "--list")
+		{
+			listBenchmarks();
+			return SUCCESS;
+		}
+		else if (arg == "--set" && i + 1 < argc)
+		{
+			if (setParam(argv[++i]) != SUCCESS)
+				return FAILURE;
+		}
+		else if (arg == "--repeat" && i + 1 < argc)
+			repeat = max(1, atoi(argv[++i]));
+		else if (arg == "--root" && i + 1 < argc)
+			root = argv[++i];
+		else if (arg == "--soak" && i + 1 < argc)
+			soakSeconds = max(0.0, atof(argv[++i]));
+		else if (arg == "--metrics" && i + 1 < argc)
+			metricsPath = argv[++i];
+		else if (arg == "--flush" && i + 1 < argc)
+			flushSeconds = max(0.1, atof(argv[++i]));
+		else
+			filter = arg;
+	}
+
+	regex pattern;
+	try
+	{
+		pattern = regex(filter);
+	}
+	catch (const regex_error &e)
+	{
+		cout << "Error: bad filter " << filter << ": " << e.what() << endl;
+		return FAILURE;
+	}
+
+	char cwd[4096];
+	if (getcwd(cwd, sizeof(cwd)) == NULL)
+		return FAILURE;
+
+/*Step 1-4: One context and queue for every mode.*/
+	CLEnv shared;
+	if (setupCL(shared) != SUCCESS)
+		return FAILURE;
+	sharedCLEnv() = &shared;
+
+/*Step 5: Select the modes.*/
+	vector<Selected> selected;
+	vector<Benchmark> &benchmarks = BenchmarkRegistry::instance().benchmarks();
+	for (size_t b = 0; b < benchmarks.size(); b++)
+	{
+		for (size_t m = 0; m < benchmarks[b].modes.size(); m++)
+		{
+			Selected s = { &benchmarks[b], m, benchmarks[b].name + "/" + benchmarks[b].modes[m].name };
+			if (regex_search(s.name, pattern))
+				selected.push_back(s);
+		}
+	}
+
+	if (soakSeconds >= 0.0)
+	{
+		int status = runSoak(selected, root, cwd, soakSeconds, metricsPath, flushSeconds);
+		Roofline::instance().report();
+		Roofline::instance().exportCsv("roofline.csv");
+		if (Trace::enabled())
+			Trace::instance().write();
+		sharedCLEnv() = NULL;
+		releaseCL(shared);
+		return status;
+	}
+
+/*Step 6: Run the selected modes from their own directories.*/
+	vector<ModeResult> results;
+	for (size_t i = 0; i < selected.size(); i++)
+	{
+		ModeResult r;
+		r.name = selected[i].name;
+		r.status = SUCCESS;
+		r.runs = 0;
+		r.seconds = 0.0;
+		for (int run = 0; run < repeat; run++)
+		{
+			cout << "\n\n" << r.name << (repeat > 1 ? " #" + to_string(run + 1) : string())
+			     << "\n------------------------------ " << endl;
+			double seconds = 0.0;
+			int status = runMode(selected[i], root, cwd, &seconds);
+			r.seconds = r.runs == 0 ? seconds : min(r.seconds, seconds);
+			r.runs++;
+			if (status != SUCCESS)
+			{
+				r.status = status;
+				break;
+			}
+		}
+		results.push_back(r);
+	}
+
+/*Step 7: Combined report.*/
+	cout << "\n\nSummary (" << results.size() << " modes, best of " << repeat << ")\n------------------------------ " << endl;
+	int failures = 0;
+	cout << fixed << setprecision(3);
+	for (size_t i = 0; i < results.size(); i++)
+	{
+		cout << setw(28) << left << results[i].name << right << setw(10) << results[i].seconds << " s  "
+		     << (results[i].status == SUCCESS ? "ok" : "FAILED") << endl;
+		failures += results[i].status != SUCCESS;
+	}
+	cout.unsetf(ios::fixed);
+
+	Roofline::instance().report();
+	Roofline::instance().exportCsv("roofline.csv");
+	if (Trace::enabled())
+		Trace::instance().write();
+
+	sharedCLEnv() = NULL;
+	releaseCL(shared);
+	return failures == 0 ? SUCCESS : FAILURE;
+}
@@ -0,0 +1,73 @@
+// Batched small MatMul: one work-group of TS x TS work-items per n x n
+// matrix (row-major, C = A B), global size { TS, TS, batch }. The group
+// walks the output tiles of its matrix and stages TS x TS tiles of A and B
+// in local memory; n need not be a multiple of TS.
+//   -DTS=..   tile size (16 by default)
+//
+// Two ways to describe the batch:
+//   MatMul_batched_ptr      arrays of SVM pointers, one allocation per
+//                           matrix (the host declares them with
+//                           CL_KERNEL_EXEC_INFO_SVM_PTRS). Kernel arguments
+//                           may not be pointers to pointers, so the arrays
+//                           hold the addresses as ulong.
+//   MatMul_batched_strided  matrices packed back to back, n * n apart
+//                           (SVM or cl_mem)
+
+#ifndef TS
+#define TS 16
+#endif
+
+void matmul_tiles(const __global int* A,
+                  const __global int* B,
+                  __global int* C,
+                  const int n,
+                  __local int* Asub,
+                  __local int* Bsub
+                  ) {
+  const int lc = get_local_id(0);   // column within the tile (contiguous)
+  const int lr = get_local_id(1);   // row within the tile
+  const int tiles = (n + TS - 1) / TS;
+
+  for (int tr = 0; tr < tiles; tr++) {
+    for (int tc = 0; tc < tiles; tc++) {
+      const int row = tr * TS + lr;
+      const int col = tc * TS + lc;
+      int temp = 0;
+      for (int t = 0; t < tiles; t++) {
+        const int k = t * TS;
+        Asub[lr * TS + lc] = (row < n && k + lc < n) ? A[row * n + k + lc] : 0;
+        Bsub[lr * TS + lc] = (k + lr < n && col < n) ? B[(k + lr) * n + col] : 0;
+        barrier(CLK_LOCAL_MEM_FENCE);
+        for (int kk = 0; kk < TS; kk++)
+          temp += Asub[lr * TS + kk] * Bsub[kk * TS + lc];
+        barrier(CLK_LOCAL_MEM_FENCE);
+      }
+      if (row < n && col < n)
+        C[row * n + col] = temp;
+    }
+  }
+}
+
+__kernel __attribute__((reqd_work_group_size(TS, TS, 1)))
+void MatMul_batched_ptr( const __global ulong* A,
+                         const __global ulong* B,
+                         const __global ulong* C,
+                         const int n
+                         ) {
+  __local int Asub[TS * TS];
+  __local int Bsub[TS * TS];
+  const size_t m = get_group_id(2);
+  matmul_tiles((const __global int*)A[m], (const __global int*)B[m], (__global int*)C[m], n, Asub, Bsub);
+}
+
+__kernel __attribute__((reqd_work_group_size(TS, TS, 1)))
+void MatMul_batched_strided( const __global int* A,
+                             const __global int* B,
+                             __global int* C,
+                             const int n
+                             ) {
+  __local int Asub[TS * TS];
+  __local int Bsub[TS * TS];
+  const size_t offset = get_group_id(2) * (size_t)n * n;
+  matmul_tiles(A + offset, B + offset, C + offset, n, Asub, Bsub);
+}
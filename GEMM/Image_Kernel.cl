@@ -0,0 +1,25 @@
+// MatMul with B read through the texture path: the same indexing as
+// MatMul in Kernel.cl, but B is a CL_R / CL_SIGNED_INT32 image2d of width
+// K and height N, so B[k * K + globalCol] becomes the texel (globalCol, k).
+// Kept out of Kernel.cl so devices without image support still build it.
+
+__constant sampler_t texels = CLK_NORMALIZED_COORDS_FALSE | CLK_ADDRESS_NONE | CLK_FILTER_NEAREST;
+
+__kernel void MatMul_image( const __global int* A,
+                            __read_only image2d_t B,
+                            __global int* C,
+                            const int M, const int N, const int K
+                            ) {
+
+  const int globalRow = get_global_id(0); // Row ID of C (0..M)
+  const int globalCol = get_global_id(1); // Col ID of C (0..N)
+
+  // Compute a single element (loop over K)
+  int temp = 0;
+  for (int k = 0; k < K; k++) {
+    temp += A[globalRow * N + k] * read_imagei(B, texels, (int2)(globalCol, k)).x;
+  }
+
+  // Store the result
+  C[globalCol * M + globalRow] = temp;
+}
@@ -0,0 +1,68 @@
+// Mixed-precision MatMul: narrow inputs, wide accumulation. C = A B with
+// A row-major M x K and B passed transposed (N x K, row-major), so both
+// operands are contiguous along K and load four at a time; K must be a
+// multiple of 4. C is row-major M x N. One work-item per element of C,
+// global size { N, M }.
+//   MatMul_int32   int  x int  -> int    baseline, int4 loads
+//   MatMul_int8    char x char -> int    char4 loads; dot() from
+//                                        cl_khr_integer_dot_product when
+//                                        the device has it
+//   MatMul_fp16    half x half -> float  vload_half4 (storage only, no
+//                                        cl_khr_fp16 needed)
+
+__kernel void MatMul_int32( const __global int* A,
+                            const __global int* Bt,
+                            __global int* C,
+                            const int M, const int N, const int K
+                            ) {
+  const int col = get_global_id(0);
+  const int row = get_global_id(1);
+  const __global int* a = A + (size_t)row * K;
+  const __global int* b = Bt + (size_t)col * K;
+
+  int4 acc = 0;
+  for (int k = 0; k < K / 4; k++)
+    acc += vload4(k, a) * vload4(k, b);
+
+  C[(size_t)row * N + col] = acc.x + acc.y + acc.z + acc.w;
+}
+
+__kernel void MatMul_int8( const __global char* A,
+                           const __global char* Bt,
+                           __global int* C,
+                           const int M, const int N, const int K
+                           ) {
+  const int col = get_global_id(0);
+  const int row = get_global_id(1);
+  const __global char* a = A + (size_t)row * K;
+  const __global char* b = Bt + (size_t)col * K;
+
+  int acc = 0;
+  for (int k = 0; k < K / 4; k++) {
+#ifdef __opencl_c_integer_dot_product_input_4x8bit
+    acc += dot(vload4(k, a), vload4(k, b));
+#else
+    int4 p = convert_int4(vload4(k, a)) * convert_int4(vload4(k, b));
+    acc += p.x + p.y + p.z + p.w;
+#endif
+  }
+
+  C[(size_t)row * N + col] = acc;
+}
+
+__kernel void MatMul_fp16( const __global half* A,
+                           const __global half* Bt,
+                           __global float* C,
+                           const int M, const int N, const int K
+                           ) {
+  const int col = get_global_id(0);
+  const int row = get_global_id(1);
+  const __global half* a = A + (size_t)row * K;
+  const __global half* b = Bt + (size_t)col * K;
+
+  float acc = 0.0f;
+  for (int k = 0; k < K / 4; k++)
+    acc += dot(vload_half4(k, a), vload_half4(k, b));
+
+  C[(size_t)row * N + col] = acc;
+}
@@ -0,0 +1,62 @@
+// MatMul with the problem shape fixed at build time. The host passes
+//   -DM=.. -DN=.. -DK=..   A is MxK, B is KxN (row-major), C column-major
+//                          as in MatMul (identical results for square)
+//   -DTS=..                tile size; must divide M, N and K, or 1 for
+//                          the untiled loop
+//   -DT=..                 element type (int by default)
+// so the compiler sees constant trip counts and strides.
+
+#ifndef T
+#define T int
+#endif
+
+#if TS > 1
+
+__kernel __attribute__((reqd_work_group_size(TS, TS, 1)))
+void MatMul_spec( const __global T* A,
+                  const __global T* B,
+                  __global T* C
+                  ) {
+  const int row = get_local_id(0);
+  const int col = get_local_id(1);
+  const int globalRow = TS * get_group_id(0) + row;
+  const int globalCol = TS * get_group_id(1) + col;
+
+  __local T Asub[TS][TS];
+  __local T Bsub[TS][TS];
+
+  T temp = 0;
+  for (int t = 0; t < K / TS; t++) {
+    Asub[col][row] = A[globalRow * K + TS * t + col];
+    Bsub[col][row] = B[(TS * t + row) * N + globalCol];
+    barrier(CLK_LOCAL_MEM_FENCE);
+
+    #pragma unroll
+    for (int k = 0; k < TS; k++) {
+      temp += Asub[k][row] * Bsub[col][k];
+    }
+    barrier(CLK_LOCAL_MEM_FENCE);
+  }
+
+  C[globalCol * M + globalRow] = temp;
+}
+
+#else
+
+__kernel void MatMul_spec( const __global T* A,
+                           const __global T* B,
+                           __global T* C
+                           ) {
+  const int globalRow = get_global_id(0);
+  const int globalCol = get_global_id(1);
+
+  T temp = 0;
+  #pragma unroll 8
+  for (int k = 0; k < K; k++) {
+    temp += A[globalRow * K + k] * B[k * N + globalCol];
+  }
+
+  C[globalCol * M + globalRow] = temp;
+}
+
+#endif
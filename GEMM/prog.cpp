@@ -24,17 +24,33 @@ THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
 #include <string>
 #include <fstream>
 #include <iomanip>
+#include <vector>
+#include <chrono>
 
-#include "/home/ctchao/ViennaCLPP/viennacl/tools/timer.hpp"
+#include "viennacl/tools/timer.hpp"
+#include "../common/MatrixLoader.hpp"
+#include "../common/CLSetup.hpp"
+#include "../common/PerfCounters.hpp"
+#include "../common/Numa.hpp"
+#include "../common/ProgramCache.hpp"
+#include "../common/Roofline.hpp"
+#include "../common/Quantize.hpp"
+#include "../common/BenchmarkRegistry.hpp"
 
 #define SUCCESS 0
 #define FAILURE 1
 
+SVM_BENCH_NAMESPACE_BEGIN(gemm)
+
 using namespace std;
 
 int Ndim = 2000;
 int Mdim = 2000;
 int Pdim = 2000;
+
+/* optional on-disk inputs: prog [A-file B-file], see common/MatrixLoader.hpp */
+MappedMatrix inputA;
+MappedMatrix inputB;
     
 /* convert the kernel file into a string */
 int convertToString(const char *filename, std::string& s)
@@ -69,14 +85,48 @@ int convertToString(const char *filename, std::string& s)
 
 int MatMul_svm();
 int MatMul_non_svm();
+int MatMul_host_ptr();
+int MatMul_image();
+int MatMul_specialized();
+int MatMul_batched();
+int MatMul_mixed();
 
 
+#ifdef SVM_BENCH_DRIVER
+static BenchmarkRegistrar registrar(Benchmark("GEMM", "GEMM")
+	.param("size", "M = N = K (the kernels assume square matrices)", { &Mdim, &Ndim, &Pdim })
+	.mode("svm", MatMul_svm)
+	.mode("non_svm", MatMul_non_svm)
+	.mode("host_ptr", MatMul_host_ptr)
+	.mode("image", MatMul_image)
+	.mode("specialized", MatMul_specialized)
+	.mode("batched", MatMul_batched)
+	.mode("mixed", MatMul_mixed));
+#else
 int main(int argc, char* argv[])
 {
+  PerfCounters::instance();  // SVM_PERF_COUNTERS=1: open before the runtime starts threads
+
   
   
   int isSuccess;
 
+  if (argc == 3)
+  {
+    if (mapMatrixFile(argv[1], ELEM_INT32, inputA) != SUCCESS ||
+        mapMatrixFile(argv[2], ELEM_INT32, inputB) != SUCCESS)
+      return FAILURE;
+    if (inputA.rows != inputA.cols || inputA.cols != inputB.rows || inputB.rows != inputB.cols)
+    {
+      cout << "Error: MatMul expects square A and B of the same size" << endl;
+      return FAILURE;
+    }
+    Mdim = inputA.rows;
+    Ndim = inputA.cols;
+    Pdim = inputB.cols;
+    cout << "Inputs: " << argv[1] << ", " << argv[2] << " (" << Mdim << "x" << Pdim << ")" << endl;
+  }
+
   std::cout << "SVM \n------------------------------ \n" << std::endl;
   {
     viennacl::tools::timer timer;
@@ -124,65 +174,82 @@ int main(int argc, char* argv[])
     std::cout << "OpenCl Non-SVM GEMV Execution time is: " << time_spent << " s, Nruns:" << Nruns << std::endl;
   }
   
-}
+  
+  std::cout << "\n\n" << "Host-Ptr \n------------------------------ " << std::endl;
+  {
+    viennacl::tools::timer timer;
+    double time_previous, time_spent;
+    size_t Nruns;
+    
+    timer.start(); 
+    Nruns = 0; 
+    time_spent = 0; 
+    
+    isSuccess = MatMul_host_ptr();
+    
+    while (Nruns < 1){ 
+      time_previous = timer.get(); 
+      isSuccess = MatMul_host_ptr();
+      time_spent += timer.get() - time_previous; 
+      Nruns+=1; 
+    } 
+    time_spent/=(double)Nruns; 
+    std::cout << "OpenCl Host-Ptr GEMM Execution time is: " << time_spent << " s, Nruns:" << Nruns << std::endl;
+  }
+  
+  std::cout << "\n\n" << "Image \n------------------------------ " << std::endl;
+  {
+    viennacl::tools::timer timer;
+    double time_previous, time_spent;
+    size_t Nruns;
+    
+    timer.start(); 
+    Nruns = 0; 
+    time_spent = 0; 
+    
+    isSuccess = MatMul_image();
+    
+    while (Nruns < 1){ 
+      time_previous = timer.get(); 
+      isSuccess = MatMul_image();
+      time_spent += timer.get() - time_previous; 
+      Nruns+=1; 
+    } 
+    time_spent/=(double)Nruns; 
+    std::cout << "OpenCl Image GEMM Execution time is: " << time_spent << " s, Nruns:" << Nruns << std::endl;
+  }
+  
+  std::cout << "\n\n" << "Specialized \n------------------------------ " << std::endl;
+  isSuccess = MatMul_specialized();
 
+  std::cout << "\n\n" << "Batched \n------------------------------ " << std::endl;
+  isSuccess = MatMul_batched();
 
+  std::cout << "\n\n" << "Mixed precision \n------------------------------ " << std::endl;
+  isSuccess = MatMul_mixed();
 
-int MatMul_svm(){
-/*Step1: Getting platforms and choose an available one.*/
-	cl_uint numPlatforms;	//the NO. of platforms
-	cl_platform_id platform = NULL;	//the chosen platform
-	cl_int	status = clGetPlatformIDs(0, NULL, &numPlatforms);
-	if (status != CL_SUCCESS)
-	{
-		cout << "Error: Getting platforms!" << endl;
-		return FAILURE;
-	}
+  Roofline::instance().report();
+  Roofline::instance().exportCsv("roofline.csv");
 
-	/*For clarity, choose the first available platform. */
-	if(numPlatforms > 0)
-	{
-		cl_platform_id* platforms = (cl_platform_id* )malloc(numPlatforms* sizeof(cl_platform_id));
-		status = clGetPlatformIDs(numPlatforms, platforms, NULL);
-		platform = platforms[0];
-		free(platforms);
-	}
+  unmapMatrixFile(inputA);
+  unmapMatrixFile(inputB);
+}
+#endif
 
-/*Step 2:Query the platform and choose the first GPU device if has one.Otherwise use the CPU as device.*/
-	cl_uint				numDevices = 0;
-	cl_device_id        *devices;
-	status = clGetDeviceIDs(platform, CL_DEVICE_TYPE_GPU, 0, NULL, &numDevices);	
-	if (numDevices == 0)	//no GPU available.
-	{
-		cout << "No GPU device available." << endl;
-		cout << "Choose CPU as default device." << endl;
-		status = clGetDeviceIDs(platform, CL_DEVICE_TYPE_CPU, 0, NULL, &numDevices);	
-		devices = (cl_device_id*)malloc(numDevices * sizeof(cl_device_id));
-		status = clGetDeviceIDs(platform, CL_DEVICE_TYPE_CPU, numDevices, devices, NULL);
-	}
-	else
-	{
-		devices = (cl_device_id*)malloc(numDevices * sizeof(cl_device_id));
-		status = clGetDeviceIDs(platform, CL_DEVICE_TYPE_GPU, numDevices, devices, NULL);
-	}
-	
 
-/*Step 3: Create context.*/
-	cl_context context = clCreateContext(NULL,1, devices,NULL,NULL,NULL);
-	
-/*Step 4: Creating command queue associate with the context.*/
-	/*old func. code
-		cl_command_queue commandQueue = clCreateCommandQueue(context, devices[0], 0, NULL);
-    	*/
-	/*new func.
-    	*	cl_command_queue clCreateCommandQueueWithProperties(
-			cl_context context, 
-			cl_device_id device, 
-			const cl_queue_properties *properties, 
-			cl_int *errcode_ret)
-	*/
-	//cl_command_queue commandQueue = clCreateCommandQueueWithProperties(context, devices[0], 0, NULL);
-	cl_command_queue commandQueue = clCreateCommandQueue(context, devices[0], CL_QUEUE_PROFILING_ENABLE, NULL);
+
+int MatMul_svm(){
+	PhaseProfiler phases("GEMM SVM");
+	phases.next("setup");
+
+/*Step1-4: Platform, device, context and command queue.*/
+	CLEnv env;
+	if (setupCL(env) != SUCCESS)
+		return FAILURE;
+	cl_device_id *devices = env.devices;
+	cl_context context = env.context;
+	cl_command_queue commandQueue = env.commandQueue;
+	cl_int status = CL_SUCCESS;
 
 /*Step 5: Create program object */
 	const char *filename = "Kernel.cl";
@@ -195,10 +262,19 @@ int MatMul_svm(){
 /*Step 6: Build program. */
 	const char options[] = "-cl-std=CL2.0";
 	status = clBuildProgram(program, 1,devices, options,NULL,NULL);
+	if (status != CL_SUCCESS)
+	{
+		cout << "Error: building " << filename << " failed, status: " << status << endl;
+		clReleaseProgram(program);
+		releaseCL(env);
+		return FAILURE;
+	}
 
 /*Step 7: Create kernel object */
 	cl_kernel kernel = clCreateKernel(program, "MatMul", NULL);
 	
+	phases.next("inputs", commandQueue);
+
 /*Step 8: Initial input,output for the host and create SVM buffer*/
   int szA = Mdim * Ndim;
   int szB = Ndim * Pdim;
@@ -206,11 +282,23 @@ int MatMul_svm(){
 
   int *c = (int *)malloc(szC * sizeof(int));
 	
-  
-  int *A = (int *)clSVMAlloc( context, CL_MEM_READ_WRITE, szA * sizeof(int), 0 );
-  int *B = (int *)clSVMAlloc( context, CL_MEM_READ_WRITE, szB * sizeof(int), 0 );
+  int *A;
+  int *B;
+  bool zeroCopyA = false;
+  bool zeroCopyB = false;
 	int *C = (int *)clSVMAlloc( context, CL_MEM_READ_WRITE, szC * sizeof(int), 0 );
 
+  if (inputA.loaded())
+  {
+    // Stream (or, with fine-grained system SVM, alias) the mapped files
+    A = (int *)loadIntoSVM(context, commandQueue, devices[0], inputA, ELEM_INT32, zeroCopyA);
+    B = (int *)loadIntoSVM(context, commandQueue, devices[0], inputB, ELEM_INT32, zeroCopyB);
+  }
+  else
+  {
+  A = (int *)clSVMAlloc( context, CL_MEM_READ_WRITE, szA * sizeof(int), 0 );
+  B = (int *)clSVMAlloc( context, CL_MEM_READ_WRITE, szB * sizeof(int), 0 );
+
 // Initialize	
   int* a = (int*)malloc(szA * sizeof(int));
   for(int i = 0; i < szA; i++){
@@ -230,7 +318,10 @@ int MatMul_svm(){
   
 	status = clEnqueueSVMUnmap(commandQueue, A, 0, NULL, NULL);
   status = clEnqueueSVMUnmap(commandQueue, B, 0, NULL, NULL);
+  }
  
+	phases.next("kernel", commandQueue);
+
 /*Step 9: Sets Kernel arguments.*/
 	status = clSetKernelArgSVMPointer(kernel, 0, A);
  	
@@ -245,14 +336,18 @@ int MatMul_svm(){
   status = clSetKernelArg(kernel, 5, sizeof(int), &Pdim);
   
 /*Step 10: Running the kernel.*/
-	size_t global_work_size[2] = {Mdim, Ndim};
+	size_t global_work_size[2] = {(size_t)Mdim, (size_t)Ndim};
   
-	status = clEnqueueNDRangeKernel(commandQueue, kernel, 2, NULL, global_work_size, NULL, 0, NULL, NULL);
+	cl_event kernelEvent;
+	status = clEnqueueNDRangeKernel(commandQueue, kernel, 2, NULL, global_work_size, NULL, 0, NULL, &kernelEvent);
+	Roofline::instance().recordEvent("GEMM", "SVM", 2.0 * Mdim * Ndim * Pdim, (szA + szB + szC) * sizeof(int), kernelEvent);
   
   status = clEnqueueSVMMap(commandQueue, CL_TRUE, CL_MAP_WRITE_INVALIDATE_REGION, C, szC * sizeof(int), 0, NULL, NULL);
  
   memcpy(c, C, szC * sizeof(int));
 
+	phases.next("readback", commandQueue);
+
 /*Step 11: Test if kernel works and char. are all assign to outputBuffer*/
 /*	
 	cout << "\nA :" << endl;
@@ -287,14 +382,15 @@ int MatMul_svm(){
 */
   status = clEnqueueSVMUnmap(commandQueue, C, 0, NULL, NULL);
 
+	phases.next("cleanup", commandQueue);
+
 /*Step 12: Clean the resources.*/
-	clSVMFree(context, A);  
-  clSVMFree(context, B); 
+	releaseSVMInput(context, A, zeroCopyA);
+  releaseSVMInput(context, B, zeroCopyB);
 	clSVMFree(context, C);  
 	status = clReleaseKernel(kernel);				//Release kernel.
 	status = clReleaseProgram(program);				//Release the program object.
-	status = clReleaseCommandQueue(commandQueue);	//Release  Command queue.
-	status = clReleaseContext(context);				//Release context.
+	releaseCL(env);
 
 	if (c != NULL)
 	{
@@ -302,11 +398,7 @@ int MatMul_svm(){
 		c = NULL;
 	}
 
-	if (devices != NULL)
-	{
-		free(devices);
-		devices = NULL;
-	}
+	phases.report();
 
 	cout<<"Program passed!\n";
   return SUCCESS;
@@ -316,50 +408,17 @@ int MatMul_svm(){
 
 int MatMul_non_svm(){
 
-/*Step1: Getting platforms and choose an available one.*/
-	cl_uint numPlatforms; //the NO. of platforms
-	cl_platform_id platform = NULL; //the chosen platform
-	cl_int status = clGetPlatformIDs(0, NULL, &numPlatforms);
-	if (status != CL_SUCCESS)
-	{
-		cout << "Error: Getting platforms!" << endl;
-		return FAILURE;
-	}
-
-	/*For clarity, choose the first available platform. */
-	if (numPlatforms > 0)
-	{
-		cl_platform_id* platforms = 
-                     (cl_platform_id*)malloc(numPlatforms * sizeof(cl_platform_id));
-		status = clGetPlatformIDs(numPlatforms, platforms, NULL);
-		platform = platforms[0];
-		free(platforms);
-	}
-
-	/*Step 2:Query the platform and choose the first GPU device if has one.Otherwise use the CPU as device.*/
-	cl_uint numDevices = 0;
-	cl_device_id        *devices;
-	status = clGetDeviceIDs(platform, CL_DEVICE_TYPE_GPU, 0, NULL, &numDevices);
-	if (numDevices == 0) //no GPU available.
-	{
-		cout << "No GPU device available." << endl;
-		cout << "Choose CPU as default device." << endl;
-		status = clGetDeviceIDs(platform, CL_DEVICE_TYPE_CPU, 0, NULL, &numDevices);
-		devices = (cl_device_id*)malloc(numDevices * sizeof(cl_device_id));
-		status = clGetDeviceIDs(platform, CL_DEVICE_TYPE_CPU, numDevices, devices, NULL);
-	}
-	else
-	{
-		devices = (cl_device_id*)malloc(numDevices * sizeof(cl_device_id));
-		status = clGetDeviceIDs(platform, CL_DEVICE_TYPE_GPU, numDevices, devices, NULL);
-	}
+	PhaseProfiler phases("GEMM Non-SVM");
+	phases.next("setup");
 
-
-	/*Step 3: Create context.*/
-	cl_context context = clCreateContext(NULL, 1, devices, NULL, NULL, NULL);
-
-	/*Step 4: Creating command queue associate with the context.*/
-	cl_command_queue commandQueue = clCreateCommandQueue(context, devices[0], CL_QUEUE_PROFILING_ENABLE, NULL);
+/*Step1-4: Platform, device, context and command queue.*/
+	CLEnv env;
+	if (setupCL(env) != SUCCESS)
+		return FAILURE;
+	cl_device_id *devices = env.devices;
+	cl_context context = env.context;
+	cl_command_queue commandQueue = env.commandQueue;
+	cl_int status = CL_SUCCESS;
 
 	/*Step 5: Create program object */
 	const char *filename = "Kernel.cl";
@@ -371,6 +430,15 @@ int MatMul_non_svm(){
 
 	/*Step 6: Build program. */
 	status = clBuildProgram(program, 1, devices, NULL, NULL, NULL);
+	if (status != CL_SUCCESS)
+	{
+		cout << "Error: building " << filename << " failed, status: " << status << endl;
+		clReleaseProgram(program);
+		releaseCL(env);
+		return FAILURE;
+	}
+
+	phases.next("inputs", commandQueue);
 
 	/*Step 7: Initial input,output for the host and create memory objects for the kernel*/
 	int szA = Mdim * Ndim;
@@ -381,15 +449,27 @@ int MatMul_non_svm(){
   int *B;
   int *C;
 
-  A = (int *)malloc(szA * sizeof(int));
-  B = (int *)malloc(szB * sizeof(int));
+  bool ownsA = true;
+  bool ownsB = true;
+
   C = (int *)malloc(szC * sizeof(int));
   
+  if (inputA.loaded())
+  {
+    A = (int *)loadIntoHost(inputA, ELEM_INT32, ownsA);
+    B = (int *)loadIntoHost(inputB, ELEM_INT32, ownsB);
+  }
+  else
+  {
+  A = (int *)malloc(szA * sizeof(int));
+  B = (int *)malloc(szB * sizeof(int));
+
   for(int i = 0; i < szA; i++){
     A[i] = i;
   }
   for(int i = 0; i < szB; i++){
     B[i] = 1;
+  }
   }
   
 	cl_mem Buffer_A = clCreateBuffer(context, CL_MEM_READ_ONLY | CL_MEM_COPY_HOST_PTR, 
@@ -404,6 +484,8 @@ int MatMul_non_svm(){
 	/*Step 8: Create kernel object */
 	cl_kernel kernel = clCreateKernel(program, "MatMul", NULL);
 
+	phases.next("kernel", commandQueue);
+
 	/*Step 9: Sets Kernel arguments.*/
 	status = clSetKernelArg(kernel, 0, sizeof(cl_mem), &Buffer_A);
 	status = clSetKernelArg(kernel, 1, sizeof(cl_mem), &Buffer_B);
@@ -413,11 +495,15 @@ int MatMul_non_svm(){
   status = clSetKernelArg(kernel, 5, sizeof(int), &Pdim);
   
 	/*Step 10: Running the kernel.*/
-	size_t global_work_size[2] = { Mdim, Ndim };
+	size_t global_work_size[2] = { (size_t)Mdim, (size_t)Ndim };
  
 
+	cl_event kernelEvent;
 	status = clEnqueueNDRangeKernel(commandQueue, kernel, 2, NULL, 
-                                        global_work_size, NULL, 0, NULL, NULL);
+                                        global_work_size, NULL, 0, NULL, &kernelEvent);
+	Roofline::instance().recordEvent("GEMM", "Non-SVM", 2.0 * Mdim * Ndim * Pdim, (szA + szB + szC) * sizeof(int), kernelEvent);
+
+	phases.next("readback", commandQueue);
 
 	/*Step 11: Read the cout put back to host memory.*/
   
@@ -455,14 +541,15 @@ int MatMul_non_svm(){
   }
 */  
 
+	phases.next("cleanup", commandQueue);
+
 	/*Step 12: Clean the resources.*/
 	status = clReleaseKernel(kernel); //Release kernel.
 	status = clReleaseProgram(program); //Release the program object.
 	status = clReleaseMemObject(Buffer_A); //Release mem object.
   status = clReleaseMemObject(Buffer_B);
 	status = clReleaseMemObject(Buffer_C);
-	status = clReleaseCommandQueue(commandQueue); //Release  Command queue.
-	status = clReleaseContext(context); //Release context.
+	releaseCL(env);
 
 	if (C != NULL)
 	{
@@ -470,13 +557,731 @@ int MatMul_non_svm(){
 		C = NULL;
 	}
 
-	if (devices != NULL)
+	if (ownsA) free(A);  // file inputs used in place are not ours to free
+	if (ownsB) free(B);
+
+	phases.report();
+
+	std::cout << "Passed!\n";
+	return SUCCESS;
+ 
+}
+
+
+
+int MatMul_host_ptr(){
+	PhaseProfiler phases("GEMM Host-Ptr");
+	phases.next("setup");
+
+/*Step1-4: Platform, device, context and command queue.*/
+	CLEnv env;
+	if (setupCL(env) != SUCCESS)
+		return FAILURE;
+
+/*Step 5-6: Create and build program. */
+	cl_program program = buildProgramFromFile(env, "Kernel.cl", NULL);
+	if (program == NULL)
+		return FAILURE;
+
+/*Step 7: Create kernel object */
+	cl_int status;
+	cl_kernel kernel = clCreateKernel(program, "MatMul", NULL);
+
+	phases.next("inputs", env.commandQueue);
+
+/*Step 8: Zero-copy buffers. A and B wrap our own page-aligned allocations
+  (CL_MEM_USE_HOST_PTR), C is runtime-allocated host memory (CL_MEM_ALLOC_HOST_PTR).
+  Inputs are written through a map so no copy is made on unified-memory devices.*/
+  int szA = Mdim * Ndim;
+  int szB = Ndim * Pdim;
+  int szC = Mdim * Pdim;
+
+  int *c = (int *)malloc(szC * sizeof(int));
+  int *a = (int *)alignedHostAlloc(szA * sizeof(int));
+  int *b = (int *)alignedHostAlloc(szB * sizeof(int));
+
+  cl_mem Buffer_A = clCreateBuffer(env.context, CL_MEM_READ_ONLY | CL_MEM_USE_HOST_PTR, 
+                             szA * sizeof(int), a, NULL);
+  cl_mem Buffer_B = clCreateBuffer(env.context, CL_MEM_READ_ONLY | CL_MEM_USE_HOST_PTR, 
+                             szB * sizeof(int), b, NULL);
+  cl_mem Buffer_C = clCreateBuffer(env.context, CL_MEM_WRITE_ONLY | CL_MEM_ALLOC_HOST_PTR, 
+                             szC * sizeof(int), NULL, NULL);
+
+  int *A = (int *)clEnqueueMapBuffer(env.commandQueue, Buffer_A, CL_TRUE, CL_MAP_WRITE_INVALIDATE_REGION, 
+                             0, szA * sizeof(int), 0, NULL, NULL, &status);
+  int *B = (int *)clEnqueueMapBuffer(env.commandQueue, Buffer_B, CL_TRUE, CL_MAP_WRITE_INVALIDATE_REGION, 
+                             0, szB * sizeof(int), 0, NULL, NULL, &status);
+  if (A != a || B != b)
+    cout << "Note: runtime did not map the host pointer in place (copying buffers)" << endl;
+
+  if (inputA.loaded())
+  {
+    copyMatrixTo(inputA, ELEM_INT32, A);
+    copyMatrixTo(inputB, ELEM_INT32, B);
+  }
+  else
+  {
+    /* first touch under SVM_NUMA_POLICY (default: this thread writes all) */
+    NumaTopology topo = NumaTopology::detect();
+    NumaPolicy policy = numaPolicyFromEnv();
+    if (policy != NUMA_SINGLE)
+      cout << "NUMA policy: " << numaPolicyName(policy) << " over " << topo.size() << " node(s)" << endl;
+    numaFirstTouch(policy, topo, szA, std::vector<std::pair<void *, size_t> >(1, std::make_pair((void *)A, szA * sizeof(int))),
+                   [&](size_t begin, size_t end) {
+      for(size_t i = begin; i < end; i++){
+        A[i] = (int)i;
+      }
+    });
+    numaFirstTouch(policy, topo, szB, std::vector<std::pair<void *, size_t> >(1, std::make_pair((void *)B, szB * sizeof(int))),
+                   [&](size_t begin, size_t end) {
+      for(size_t i = begin; i < end; i++){
+        B[i] = 1;
+      }
+    });
+  }
+
+  status = clEnqueueUnmapMemObject(env.commandQueue, Buffer_A, A, 0, NULL, NULL);
+  status = clEnqueueUnmapMemObject(env.commandQueue, Buffer_B, B, 0, NULL, NULL);
+
+	phases.next("kernel", env.commandQueue);
+
+/*Step 9: Sets Kernel arguments.*/
+	status = clSetKernelArg(kernel, 0, sizeof(cl_mem), &Buffer_A);
+	status = clSetKernelArg(kernel, 1, sizeof(cl_mem), &Buffer_B);
+  status = clSetKernelArg(kernel, 2, sizeof(cl_mem), &Buffer_C);
+  status = clSetKernelArg(kernel, 3, sizeof(int), &Mdim);
+  status = clSetKernelArg(kernel, 4, sizeof(int), &Ndim);
+  status = clSetKernelArg(kernel, 5, sizeof(int), &Pdim);
+
+/*Step 10: Running the kernel.*/
+	size_t global_work_size[2] = { (size_t)Mdim, (size_t)Ndim };
+
+	cl_event kernelEvent;
+	status = clEnqueueNDRangeKernel(env.commandQueue, kernel, 2, NULL, 
+                                        global_work_size, NULL, 0, NULL, &kernelEvent);
+	Roofline::instance().recordEvent("GEMM", "Host-Ptr", 2.0 * Mdim * Ndim * Pdim, (szA + szB + szC) * sizeof(int), kernelEvent);
+
+	phases.next("readback", env.commandQueue);
+
+/*Step 11: Map the result instead of reading it back.*/
+  int *C = (int *)clEnqueueMapBuffer(env.commandQueue, Buffer_C, CL_TRUE, CL_MAP_READ, 
+                             0, szC * sizeof(int), 0, NULL, NULL, &status);
+
+  memcpy(c, C, szC * sizeof(int));
+
+  status = clEnqueueUnmapMemObject(env.commandQueue, Buffer_C, C, 0, NULL, NULL);
+  clFinish(env.commandQueue);
+
+	phases.next("cleanup", env.commandQueue);
+
+/*Step 12: Clean the resources.*/
+	status = clReleaseKernel(kernel); //Release kernel.
+	status = clReleaseProgram(program); //Release the program object.
+	status = clReleaseMemObject(Buffer_A); //Release mem object.
+  status = clReleaseMemObject(Buffer_B);
+	status = clReleaseMemObject(Buffer_C);
+	releaseCL(env);
+
+  free(a);
+  free(b);
+  free(c);
+
+	phases.report();
+
+	std::cout << "Passed!\n";
+	return SUCCESS;
+}
+
+
+
+/* B through the texture path: MatMul_image (Image_Kernel.cl) samples B
+   from a CL_R / CL_SIGNED_INT32 image2d, A and C stay buffers. Creating
+   the objects and uploading into them are separate phases and are timed
+   on their own, so the cost of getting data into an image can be set
+   against the kernel time it saves. Skipped when the device has no image
+   support or B exceeds its image2d limits. */
+int MatMul_image(){
+	PhaseProfiler phases("GEMM Image");
+	phases.next("setup");
+
+/*Step1-4: Platform, device, context and command queue.*/
+	CLEnv env;
+	if (setupCL(env) != SUCCESS)
+		return FAILURE;
+
+/*Step 5-6: Check image support, then create and build program. */
+	if (!imageSupport(env, Pdim, Ndim))
+	{
+		cout << "Skipped" << endl;
+		releaseCL(env);
+		return SUCCESS;
+	}
+	cl_program program = buildProgramFromFile(env, "Image_Kernel.cl", NULL);
+	if (program == NULL)
+	{
+		releaseCL(env);
+		return FAILURE;
+	}
+
+/*Step 7: Create kernel object */
+	cl_int status;
+	cl_kernel kernel = clCreateKernel(program, "MatMul_image", NULL);
+
+	phases.next("inputs", env.commandQueue);
+
+/*Step 8: Host inputs.*/
+  int szA = Mdim * Ndim;
+  int szB = Ndim * Pdim;
+  int szC = Mdim * Pdim;
+
+  bool ownsA = true;
+  bool ownsB = true;
+  int *A;
+  int *B;
+  int *C = (int *)malloc(szC * sizeof(int));
+
+  if (inputA.loaded())
+  {
+    A = (int *)loadIntoHost(inputA, ELEM_INT32, ownsA);
+    B = (int *)loadIntoHost(inputB, ELEM_INT32, ownsB);
+  }
+  else
+  {
+    A = (int *)malloc(szA * sizeof(int));
+    B = (int *)malloc(szB * sizeof(int));
+    for(int i = 0; i < szA; i++){
+      A[i] = i;
+    }
+    for(int i = 0; i < szB; i++){
+      B[i] = 1;
+    }
+  }
+
+	phases.next("image create", env.commandQueue);
+
+/*Step 9: Create the buffers and the image (no data yet).*/
+	chrono::steady_clock::time_point createStart = chrono::steady_clock::now();
+	cl_mem Buffer_A = clCreateBuffer(env.context, CL_MEM_READ_ONLY, szA * sizeof(int), NULL, NULL);
+	cl_mem Buffer_C = clCreateBuffer(env.context, CL_MEM_WRITE_ONLY, szC * sizeof(int), NULL, NULL);
+	cl_mem Image_B = createIntImage2D(env, CL_MEM_READ_ONLY, Pdim, Ndim, &status);
+	double createSeconds = chrono::duration<double>(chrono::steady_clock::now() - createStart).count();
+	if (Image_B == NULL)
 	{
-		free(devices);
-		devices = NULL;
+		clReleaseMemObject(Buffer_A);
+		clReleaseMemObject(Buffer_C);
+		clReleaseKernel(kernel);
+		clReleaseProgram(program);
+		releaseCL(env);
+		if (ownsA) free(A);
+		if (ownsB) free(B);
+		free(C);
+		return FAILURE;
 	}
 
+	phases.next("upload", env.commandQueue);
+
+/*Step 10: Upload A into its buffer and B into the image.*/
+	size_t origin[3] = { 0, 0, 0 };
+	size_t region[3] = { (size_t)Pdim, (size_t)Ndim, 1 };
+	cl_event writeEvent, imageEvent;
+	status = clEnqueueWriteBuffer(env.commandQueue, Buffer_A, CL_FALSE, 0, szA * sizeof(int), A, 0, NULL, &writeEvent);
+	status = clEnqueueWriteImage(env.commandQueue, Image_B, CL_FALSE, origin, region, 0, 0, B, 0, NULL, &imageEvent);
+	clFinish(env.commandQueue);
+
+	phases.next("kernel", env.commandQueue);
+
+/*Step 11: Sets Kernel arguments and run the kernel.*/
+	status = clSetKernelArg(kernel, 0, sizeof(cl_mem), &Buffer_A);
+	status = clSetKernelArg(kernel, 1, sizeof(cl_mem), &Image_B);
+  status = clSetKernelArg(kernel, 2, sizeof(cl_mem), &Buffer_C);
+  status = clSetKernelArg(kernel, 3, sizeof(int), &Mdim);
+  status = clSetKernelArg(kernel, 4, sizeof(int), &Ndim);
+  status = clSetKernelArg(kernel, 5, sizeof(int), &Pdim);
+
+	size_t global_work_size[2] = { (size_t)Mdim, (size_t)Ndim };
+
+	cl_event kernelEvent;
+	status = clEnqueueNDRangeKernel(env.commandQueue, kernel, 2, NULL, 
+                                        global_work_size, NULL, 0, NULL, &kernelEvent);
+	clWaitForEvents(1, &kernelEvent);
+	double kernelSeconds = eventSeconds(kernelEvent);
+	Roofline::instance().recordEvent("GEMM", "Image", 2.0 * Mdim * Ndim * Pdim, (szA + szB + szC) * sizeof(int), kernelEvent);
+
+	phases.next("readback", env.commandQueue);
+
+/*Step 12: Read the output back to host memory.*/
+	status = clEnqueueReadBuffer(env.commandQueue, Buffer_C, CL_TRUE, 0, szC * sizeof(int), C, 0, NULL, NULL);
+
+	cout << fixed << setprecision(3) << "image create " << createSeconds * 1e3 << " ms, image upload "
+	     << eventSeconds(imageEvent) * 1e3 << " ms (A buffer upload " << eventSeconds(writeEvent) * 1e3
+	     << " ms), kernel " << kernelSeconds * 1e3 << " ms" << endl;
+	cout.unsetf(ios::fixed);
+	clReleaseEvent(writeEvent);
+	clReleaseEvent(imageEvent);
+
+	phases.next("cleanup", env.commandQueue);
+
+/*Step 13: Clean the resources.*/
+	status = clReleaseKernel(kernel); //Release kernel.
+	status = clReleaseProgram(program); //Release the program object.
+	status = clReleaseMemObject(Buffer_A); //Release mem object.
+  status = clReleaseMemObject(Image_B);
+	status = clReleaseMemObject(Buffer_C);
+	releaseCL(env);
+
+  if (ownsA) free(A);
+  if (ownsB) free(B);
+  free(C);
+
+	phases.report();
+
 	std::cout << "Passed!\n";
 	return SUCCESS;
- 
-}
\ No newline at end of file
+}
+
+
+
+/* Generic MatMul (sizes as kernel arguments) against MatMul_spec from
+   Specialized_Kernel.cl, built per shape with the sizes, tile size and
+   element type as -D options and kept in a ProgramCache. Shapes are
+   square because the generic kernel's indexing assumes it; the running
+   size is added to the fixed list. If a specialised build fails the
+   generic kernel is used and reported as such. */
+int MatMul_specialized(){
+	const int NRUNS = 5;
+
+/*Step1-4: Platform, device, context and command queue.*/
+	CLEnv env;
+	if (setupCL(env) != SUCCESS)
+		return FAILURE;
+
+/*Step 5-6: Generic program once, specialised ones through the cache. */
+	cl_program generic = buildProgramFromFile(env, "Kernel.cl", "-cl-std=CL2.0");
+	if (generic == NULL)
+	{
+		releaseCL(env);
+		return FAILURE;
+	}
+	ProgramCache cache(env);
+
+	size_t maxGroup = 1;
+	clGetDeviceInfo(env.device(), CL_DEVICE_MAX_WORK_GROUP_SIZE, sizeof(maxGroup), &maxGroup, NULL);
+
+	vector<int> shapes;
+	shapes.push_back(256);
+	shapes.push_back(512);
+	shapes.push_back(1024);
+	if (Mdim == Ndim && Ndim == Pdim && Mdim != 256 && Mdim != 512 && Mdim != 1024)
+		shapes.push_back(Mdim);
+
+	int isSuccess = SUCCESS;
+	cout << setw(6) << "n" << setw(5) << "TS" << setw(14) << "generic ms" << setw(14) << "special ms"
+	     << setw(10) << "speedup" << endl;
+
+	for (size_t s = 0; s < shapes.size(); s++)
+	{
+		int n = shapes[s];
+		size_t bytes = (size_t)n * n * sizeof(int);
+
+	/*Step 7: Inputs in SVM.*/
+		int *A = (int *)clSVMAlloc(env.context, CL_MEM_READ_ONLY, bytes, 0);
+		int *B = (int *)clSVMAlloc(env.context, CL_MEM_READ_ONLY, bytes, 0);
+		int *C1 = (int *)clSVMAlloc(env.context, CL_MEM_READ_WRITE, bytes, 0);
+		int *C2 = (int *)clSVMAlloc(env.context, CL_MEM_READ_WRITE, bytes, 0);
+		clEnqueueSVMMap(env.commandQueue, CL_TRUE, CL_MAP_WRITE_INVALIDATE_REGION, A, bytes, 0, NULL, NULL);
+		clEnqueueSVMMap(env.commandQueue, CL_TRUE, CL_MAP_WRITE_INVALIDATE_REGION, B, bytes, 0, NULL, NULL);
+		for (int i = 0; i < n * n; i++)
+		{
+			A[i] = i % 17;
+			B[i] = i % 13;
+		}
+		clEnqueueSVMUnmap(env.commandQueue, A, 0, NULL, NULL);
+		clEnqueueSVMUnmap(env.commandQueue, B, 0, NULL, NULL);
+
+	/*Step 8: Generic kernel.*/
+		size_t global_work_size[2] = { (size_t)n, (size_t)n };
+		cl_kernel kernel = clCreateKernel(generic, "MatMul", NULL);
+		clSetKernelArgSVMPointer(kernel, 0, A);
+		clSetKernelArgSVMPointer(kernel, 1, B);
+		clSetKernelArgSVMPointer(kernel, 2, C1);
+		clSetKernelArg(kernel, 3, sizeof(int), &n);
+		clSetKernelArg(kernel, 4, sizeof(int), &n);
+		clSetKernelArg(kernel, 5, sizeof(int), &n);
+		double genericTime = timeKernel(env.commandQueue, kernel, 2, global_work_size, NULL, NRUNS);
+		clReleaseKernel(kernel);
+
+	/*Step 9: Specialised kernel: largest tile that divides n and fits a work-group.*/
+		int ts = 1;
+		for (int t = 16; t > 1 && ts == 1; t /= 2)
+			if (n % t == 0 && (size_t)(t * t) <= maxGroup)
+				ts = t;
+		char options[128];
+		sprintf(options, "-cl-std=CL2.0 -DM=%d -DN=%d -DK=%d -DTS=%d -DT=int", n, n, n, ts);
+
+		double specialTime = genericTime;
+		bool specialised = false;
+		cl_program program = cache.get("Specialized_Kernel.cl", options);
+		if (program != NULL)
+		{
+			kernel = clCreateKernel(program, "MatMul_spec", NULL);
+			clSetKernelArgSVMPointer(kernel, 0, A);
+			clSetKernelArgSVMPointer(kernel, 1, B);
+			clSetKernelArgSVMPointer(kernel, 2, C2);
+			size_t local_work_size[2] = { (size_t)ts, (size_t)ts };
+			specialTime = timeKernel(env.commandQueue, kernel, 2, global_work_size, ts > 1 ? local_work_size : NULL, NRUNS);
+			clReleaseKernel(kernel);
+			specialised = true;
+		}
+
+	/*Step 10: Same result from both.*/
+		bool correct = true;
+		if (specialised)
+		{
+			clEnqueueSVMMap(env.commandQueue, CL_TRUE, CL_MAP_READ, C1, bytes, 0, NULL, NULL);
+			clEnqueueSVMMap(env.commandQueue, CL_TRUE, CL_MAP_READ, C2, bytes, 0, NULL, NULL);
+			correct = memcmp(C1, C2, bytes) == 0;
+			clEnqueueSVMUnmap(env.commandQueue, C1, 0, NULL, NULL);
+			clEnqueueSVMUnmap(env.commandQueue, C2, 0, NULL, NULL);
+		}
+		if (!correct)
+			isSuccess = FAILURE;
+
+		cout << setw(6) << n << setw(5) << ts << fixed << setprecision(3)
+		     << setw(14) << genericTime * 1e3 << setw(14) << specialTime * 1e3
+		     << setw(9) << genericTime / specialTime << "x"
+		     << (specialised ? "" : "  (build failed, generic fallback)")
+		     << (correct ? "" : "  MISMATCH") << endl;
+		cout.unsetf(ios::fixed);
+
+	/*Step 11: Clean the per-shape resources.*/
+		clFinish(env.commandQueue);
+		clSVMFree(env.context, A);
+		clSVMFree(env.context, B);
+		clSVMFree(env.context, C1);
+		clSVMFree(env.context, C2);
+	}
+
+	cout << "specialised builds: " << cache.misses() << ", " << cache.buildSeconds() << " s total" << endl;
+
+/*Step 12: Clean the resources.*/
+	clReleaseProgram(generic);
+	releaseCL(env);
+	return isSuccess;
+}
+
+
+
+/* Many small n x n products per launch (Batched_Kernel.cl), one
+   work-group per matrix with local-memory tiles. The same batch is
+   described three ways: arrays of SVM pointers to separately allocated
+   matrices, one packed SVM allocation per operand, and packed cl_mem
+   buffers. Reported in matrices per second of kernel time; the last
+   matrix of every batch is checked against the host. */
+int MatMul_batched(){
+	const int NRUNS = 5;
+	const size_t MAX_ELEMENTS = 16 << 20;   // per operand, whole batch
+	const int TILE = 16;
+
+/*Step1-4: Platform, device, context and command queue.*/
+	CLEnv env;
+	if (setupCL(env) != SUCCESS)
+		return FAILURE;
+
+/*Step 5-7: Program and both batched kernels.*/
+	cl_program program = buildProgramFromFile(env, "Batched_Kernel.cl", "-cl-std=CL2.0 -DTS=16");
+	if (program == NULL)
+	{
+		releaseCL(env);
+		return FAILURE;
+	}
+	cl_kernel ptrKernel = clCreateKernel(program, "MatMul_batched_ptr", NULL);
+	cl_kernel stridedKernel = clCreateKernel(program, "MatMul_batched_strided", NULL);
+
+	const int sizes[] = { 16, 32, 64, 128 };
+	const int batches[] = { 16, 256, 1024, 4096 };
+
+	int isSuccess = SUCCESS;
+	cout << setw(5) << "n" << setw(7) << "batch" << setw(15) << "SVM ptr-array" << setw(14) << "SVM packed"
+	     << setw(14) << "cl_mem packed" << setw(10) << "GOP/s" << "  (matrices/s)" << endl;
+
+	for (int si = 0; si < 4; si++)
+	{
+		for (int bi = 0; bi < 4; bi++)
+		{
+			int n = sizes[si];
+			size_t batch = batches[bi];
+			size_t count = (size_t)n * n;
+			size_t bytes = count * sizeof(int);
+			if (count * batch > MAX_ELEMENTS)
+				continue;
+
+			auto valueA = [](size_t m, size_t i) { return (int)((m + i) % 7) - 3; };
+			auto valueB = [](size_t m, size_t i) { return (int)((3 * m + i) % 5) - 2; };
+
+			/* host reference for the last matrix */
+			size_t last = batch - 1;
+			vector<int> ref(count, 0);
+			for (int i = 0; i < n; i++)
+				for (int k = 0; k < n; k++)
+					for (int j = 0; j < n; j++)
+						ref[i * n + j] += valueA(last, i * n + k) * valueB(last, k * n + j);
+
+			size_t global_work_size[3] = { (size_t)TILE, (size_t)TILE, batch };
+			size_t local_work_size[3] = { (size_t)TILE, (size_t)TILE, 1 };
+
+		/*Step 8: Pointer arrays: one SVM allocation per matrix, addresses in SVM arrays.*/
+			vector<int *> mats(3 * batch);
+			cl_ulong *ptrs[3];
+			for (int op = 0; op < 3; op++)
+			{
+				ptrs[op] = (cl_ulong *)clSVMAlloc(env.context, CL_MEM_READ_ONLY, batch * sizeof(cl_ulong), 0);
+				clEnqueueSVMMap(env.commandQueue, CL_TRUE, CL_MAP_WRITE_INVALIDATE_REGION, ptrs[op], batch * sizeof(cl_ulong), 0, NULL, NULL);
+				for (size_t m = 0; m < batch; m++)
+				{
+					int *mat = (int *)clSVMAlloc(env.context, op == 2 ? CL_MEM_WRITE_ONLY : CL_MEM_READ_ONLY, bytes, 0);
+					mats[op * batch + m] = mat;
+					ptrs[op][m] = (cl_ulong)(uintptr_t)mat;
+					if (op == 2)
+						continue;
+					clEnqueueSVMMap(env.commandQueue, CL_TRUE, CL_MAP_WRITE_INVALIDATE_REGION, mat, bytes, 0, NULL, NULL);
+					for (size_t i = 0; i < count; i++)
+						mat[i] = op == 0 ? valueA(m, i) : valueB(m, i);
+					clEnqueueSVMUnmap(env.commandQueue, mat, 0, NULL, NULL);
+				}
+				clEnqueueSVMUnmap(env.commandQueue, ptrs[op], 0, NULL, NULL);
+			}
+			for (int op = 0; op < 3; op++)
+				clSetKernelArgSVMPointer(ptrKernel, op, ptrs[op]);
+			clSetKernelArg(ptrKernel, 3, sizeof(int), &n);
+			clSetKernelExecInfo(ptrKernel, CL_KERNEL_EXEC_INFO_SVM_PTRS, mats.size() * sizeof(void *), &mats[0]);
+			double ptrTime = timeKernel(env.commandQueue, ptrKernel, 3, global_work_size, local_work_size, NRUNS);
+
+			int *C = mats[2 * batch + last];
+			clEnqueueSVMMap(env.commandQueue, CL_TRUE, CL_MAP_READ, C, bytes, 0, NULL, NULL);
+			bool correct = memcmp(C, &ref[0], bytes) == 0;
+			clEnqueueSVMUnmap(env.commandQueue, C, 0, NULL, NULL);
+			clFinish(env.commandQueue);
+			for (size_t i = 0; i < mats.size(); i++)
+				clSVMFree(env.context, mats[i]);
+			for (int op = 0; op < 3; op++)
+				clSVMFree(env.context, ptrs[op]);
+
+		/*Step 9: Packed SVM: one allocation per operand, matrices n * n apart.*/
+			int *packed[3];
+			for (int op = 0; op < 3; op++)
+			{
+				packed[op] = (int *)clSVMAlloc(env.context, op == 2 ? CL_MEM_WRITE_ONLY : CL_MEM_READ_ONLY, batch * bytes, 0);
+				if (op == 2)
+					continue;
+				clEnqueueSVMMap(env.commandQueue, CL_TRUE, CL_MAP_WRITE_INVALIDATE_REGION, packed[op], batch * bytes, 0, NULL, NULL);
+				for (size_t m = 0; m < batch; m++)
+					for (size_t i = 0; i < count; i++)
+						packed[op][m * count + i] = op == 0 ? valueA(m, i) : valueB(m, i);
+				clEnqueueSVMUnmap(env.commandQueue, packed[op], 0, NULL, NULL);
+			}
+			for (int op = 0; op < 3; op++)
+				clSetKernelArgSVMPointer(stridedKernel, op, packed[op]);
+			clSetKernelArg(stridedKernel, 3, sizeof(int), &n);
+			double packedTime = timeKernel(env.commandQueue, stridedKernel, 3, global_work_size, local_work_size, NRUNS);
+
+			clEnqueueSVMMap(env.commandQueue, CL_TRUE, CL_MAP_READ, packed[2], batch * bytes, 0, NULL, NULL);
+			correct = correct && memcmp(packed[2] + last * count, &ref[0], bytes) == 0;
+			clEnqueueSVMUnmap(env.commandQueue, packed[2], 0, NULL, NULL);
+
+		/*Step 10: Packed cl_mem buffers with the same strided kernel (inputs copied from the packed SVM data).*/
+			clEnqueueSVMMap(env.commandQueue, CL_TRUE, CL_MAP_READ, packed[0], batch * bytes, 0, NULL, NULL);
+			clEnqueueSVMMap(env.commandQueue, CL_TRUE, CL_MAP_READ, packed[1], batch * bytes, 0, NULL, NULL);
+			cl_mem Buffer_A = clCreateBuffer(env.context, CL_MEM_READ_ONLY | CL_MEM_COPY_HOST_PTR, batch * bytes, packed[0], NULL);
+			cl_mem Buffer_B = clCreateBuffer(env.context, CL_MEM_READ_ONLY | CL_MEM_COPY_HOST_PTR, batch * bytes, packed[1], NULL);
+			cl_mem Buffer_C = clCreateBuffer(env.context, CL_MEM_WRITE_ONLY, batch * bytes, NULL, NULL);
+			clEnqueueSVMUnmap(env.commandQueue, packed[0], 0, NULL, NULL);
+			clEnqueueSVMUnmap(env.commandQueue, packed[1], 0, NULL, NULL);
+			clSetKernelArg(stridedKernel, 0, sizeof(cl_mem), &Buffer_A);
+			clSetKernelArg(stridedKernel, 1, sizeof(cl_mem), &Buffer_B);
+			clSetKernelArg(stridedKernel, 2, sizeof(cl_mem), &Buffer_C);
+			double bufferTime = timeKernel(env.commandQueue, stridedKernel, 3, global_work_size, local_work_size, NRUNS);
+
+			vector<int> c(count);
+			clEnqueueReadBuffer(env.commandQueue, Buffer_C, CL_TRUE, last * bytes, bytes, &c[0], 0, NULL, NULL);
+			correct = correct && c == ref;
+			if (!correct)
+				isSuccess = FAILURE;
+
+			double best = min(ptrTime, min(packedTime, bufferTime));
+			cout << setw(5) << n << setw(7) << batch << fixed << setprecision(0)
+			     << setw(15) << batch / ptrTime << setw(14) << batch / packedTime << setw(14) << batch / bufferTime
+			     << setprecision(2) << setw(10) << 2.0 * n * n * n * batch / best * 1e-9
+			     << (correct ? "" : "  MISMATCH") << endl;
+			cout.unsetf(ios::fixed);
+
+		/*Step 11: Clean the per-batch resources.*/
+			clReleaseMemObject(Buffer_A);
+			clReleaseMemObject(Buffer_B);
+			clReleaseMemObject(Buffer_C);
+			for (int op = 0; op < 3; op++)
+				clSVMFree(env.context, packed[op]);
+		}
+	}
+
+/*Step 12: Clean the resources.*/
+	clReleaseKernel(ptrKernel);
+	clReleaseKernel(stridedKernel);
+	clReleaseProgram(program);
+	releaseCL(env);
+	return isSuccess;
+}
+
+
+
+/* int8 x int8 -> int32 and fp16 x fp16 -> fp32 MatMul against the same
+   kernel in int32 (MixedPrecision_Kernel.cl, B passed transposed so all
+   three load packed vectors along K). The float inputs are quantized
+   per tensor with common/Quantize.hpp; the int32 baseline runs on the
+   same quantized values, so its result must match int8 exactly. Errors
+   of the dequantized int8 and of the fp16 results are against a double
+   host reference on the original floats. */
+int MatMul_mixed(){
+	const int NRUNS = 5;
+
+/*Step1-4: Platform, device, context and command queue.*/
+	CLEnv env;
+	if (setupCL(env) != SUCCESS)
+		return FAILURE;
+
+/*Step 5-7: Program and the three kernels.*/
+	cl_program program = buildProgramFromFile(env, "MixedPrecision_Kernel.cl", "-cl-std=CL2.0");
+	if (program == NULL)
+	{
+		releaseCL(env);
+		return FAILURE;
+	}
+	cl_kernel kernels[3];
+	const char *names[3] = { "MatMul_int32", "MatMul_int8", "MatMul_fp16" };
+	for (int k = 0; k < 3; k++)
+		kernels[k] = clCreateKernel(program, names[k], NULL);
+
+	char extensions[8192] = "";
+	clGetDeviceInfo(env.device(), CL_DEVICE_EXTENSIONS, sizeof(extensions), extensions, NULL);
+	cout << "int8 dot product: " << (strstr(extensions, "cl_khr_integer_dot_product") ? "cl_khr_integer_dot_product" : "emulated")
+	     << ", cl_khr_fp16: " << (strstr(extensions, "cl_khr_fp16") ? "yes" : "no (storage only)") << endl;
+
+	const int sizes[] = { 256, 512, 1024 };
+
+	int isSuccess = SUCCESS;
+	cout << setw(6) << "n" << setw(11) << "int32 ms" << setw(10) << "int8 ms" << setw(8) << "gain"
+	     << setw(10) << "fp16 ms" << setw(8) << "gain" << setw(12) << "int8 err" << setw(12) << "fp16 err"
+	     << "  (max error / max |C|)" << endl;
+
+	for (int si = 0; si < 3; si++)
+	{
+		int n = sizes[si];
+		size_t count = (size_t)n * n;
+
+	/*Step 8: Float inputs, B transposed, and the host reference in double.*/
+		vector<float> a(count), bt(count);
+		for (size_t i = 0; i < count; i++)
+		{
+			a[i] = (float)((int)((i * 37) % 201) - 100) / 100.0f;
+			bt[i] = (float)((int)((i * 53) % 199) - 99) / 99.0f;
+		}
+		vector<double> ref(count);
+		for (int i = 0; i < n; i++)
+			for (int j = 0; j < n; j++)
+			{
+				double sum = 0.0;
+				for (int k = 0; k < n; k++)
+					sum += (double)a[(size_t)i * n + k] * bt[(size_t)j * n + k];
+				ref[(size_t)i * n + j] = sum;
+			}
+
+	/*Step 9: Quantized copies in SVM: int8, the same values widened to int32, fp16.*/
+		float scaleA = int8Scale(&a[0], count), scaleB = int8Scale(&bt[0], count);
+		int8_t *A8 = (int8_t *)clSVMAlloc(env.context, CL_MEM_READ_ONLY, count, 0);
+		int8_t *B8 = (int8_t *)clSVMAlloc(env.context, CL_MEM_READ_ONLY, count, 0);
+		int *A32 = (int *)clSVMAlloc(env.context, CL_MEM_READ_ONLY, count * sizeof(int), 0);
+		int *B32 = (int *)clSVMAlloc(env.context, CL_MEM_READ_ONLY, count * sizeof(int), 0);
+		uint16_t *A16 = (uint16_t *)clSVMAlloc(env.context, CL_MEM_READ_ONLY, count * sizeof(uint16_t), 0);
+		uint16_t *B16 = (uint16_t *)clSVMAlloc(env.context, CL_MEM_READ_ONLY, count * sizeof(uint16_t), 0);
+		int *C32 = (int *)clSVMAlloc(env.context, CL_MEM_WRITE_ONLY, count * sizeof(int), 0);
+		int *C8 = (int *)clSVMAlloc(env.context, CL_MEM_WRITE_ONLY, count * sizeof(int), 0);
+		float *C16 = (float *)clSVMAlloc(env.context, CL_MEM_WRITE_ONLY, count * sizeof(float), 0);
+
+		clEnqueueSVMMap(env.commandQueue, CL_TRUE, CL_MAP_WRITE_INVALIDATE_REGION, A8, count, 0, NULL, NULL);
+		clEnqueueSVMMap(env.commandQueue, CL_TRUE, CL_MAP_WRITE_INVALIDATE_REGION, B8, count, 0, NULL, NULL);
+		clEnqueueSVMMap(env.commandQueue, CL_TRUE, CL_MAP_WRITE_INVALIDATE_REGION, A32, count * sizeof(int), 0, NULL, NULL);
+		clEnqueueSVMMap(env.commandQueue, CL_TRUE, CL_MAP_WRITE_INVALIDATE_REGION, B32, count * sizeof(int), 0, NULL, NULL);
+		clEnqueueSVMMap(env.commandQueue, CL_TRUE, CL_MAP_WRITE_INVALIDATE_REGION, A16, count * sizeof(uint16_t), 0, NULL, NULL);
+		clEnqueueSVMMap(env.commandQueue, CL_TRUE, CL_MAP_WRITE_INVALIDATE_REGION, B16, count * sizeof(uint16_t), 0, NULL, NULL);
+		quantizeInt8(&a[0], count, scaleA, A8);
+		quantizeInt8(&bt[0], count, scaleB, B8);
+		for (size_t i = 0; i < count; i++)
+		{
+			A32[i] = A8[i];
+			B32[i] = B8[i];
+		}
+		toHalf(&a[0], count, A16);
+		toHalf(&bt[0], count, B16);
+		clEnqueueSVMUnmap(env.commandQueue, A8, 0, NULL, NULL);
+		clEnqueueSVMUnmap(env.commandQueue, B8, 0, NULL, NULL);
+		clEnqueueSVMUnmap(env.commandQueue, A32, 0, NULL, NULL);
+		clEnqueueSVMUnmap(env.commandQueue, B32, 0, NULL, NULL);
+		clEnqueueSVMUnmap(env.commandQueue, A16, 0, NULL, NULL);
+		clEnqueueSVMUnmap(env.commandQueue, B16, 0, NULL, NULL);
+
+	/*Step 10: Time the three kernels on the same shape.*/
+		void *args[3][3] = { { A32, B32, C32 }, { A8, B8, C8 }, { A16, B16, C16 } };
+		size_t elementBytes[3] = { sizeof(int), 1, sizeof(uint16_t) };
+		size_t global_work_size[2] = { (size_t)n, (size_t)n };
+		double seconds[3];
+		for (int k = 0; k < 3; k++)
+		{
+			for (int arg = 0; arg < 3; arg++)
+				clSetKernelArgSVMPointer(kernels[k], arg, args[k][arg]);
+			clSetKernelArg(kernels[k], 3, sizeof(int), &n);
+			clSetKernelArg(kernels[k], 4, sizeof(int), &n);
+			clSetKernelArg(kernels[k], 5, sizeof(int), &n);
+			seconds[k] = timeKernel(env.commandQueue, kernels[k], 2, global_work_size, NULL, NRUNS);
+			Roofline::instance().record("GEMM", names[k] + 7, 2.0 * n * n * n,
+			                            2.0 * count * elementBytes[k] + count * 4.0, seconds[k]);
+		}
+
+	/*Step 11: int8 must equal int32 exactly; dequantize and compare both narrow results.*/
+		clEnqueueSVMMap(env.commandQueue, CL_TRUE, CL_MAP_READ, C32, count * sizeof(int), 0, NULL, NULL);
+		clEnqueueSVMMap(env.commandQueue, CL_TRUE, CL_MAP_READ, C8, count * sizeof(int), 0, NULL, NULL);
+		clEnqueueSVMMap(env.commandQueue, CL_TRUE, CL_MAP_READ, C16, count * sizeof(float), 0, NULL, NULL);
+		bool exact = memcmp(C32, C8, count * sizeof(int)) == 0;
+		vector<float> c8(count);
+		dequantizeInt32(C8, count, scaleA * scaleB, &c8[0]);
+		QuantError int8Error = compareToReference(&c8[0], &ref[0], count);
+		QuantError fp16Error = compareToReference(C16, &ref[0], count);
+		clEnqueueSVMUnmap(env.commandQueue, C32, 0, NULL, NULL);
+		clEnqueueSVMUnmap(env.commandQueue, C8, 0, NULL, NULL);
+		clEnqueueSVMUnmap(env.commandQueue, C16, 0, NULL, NULL);
+		clFinish(env.commandQueue);
+
+		bool correct = exact && fp16Error.relative < 1e-2;
+		if (!correct)
+			isSuccess = FAILURE;
+
+		cout << setw(6) << n << fixed << setprecision(3)
+		     << setw(11) << seconds[0] * 1e3 << setw(10) << seconds[1] * 1e3 << setw(7) << setprecision(2) << seconds[0] / seconds[1] << "x"
+		     << setprecision(3) << setw(10) << seconds[2] * 1e3 << setw(7) << setprecision(2) << seconds[0] / seconds[2] << "x"
+		     << scientific << setprecision(2) << setw(12) << int8Error.relative << setw(12) << fp16Error.relative
+		     << (exact ? "" : "  int8 != int32") << (fp16Error.relative < 1e-2 ? "" : "  fp16 error too large") << endl;
+		cout.unsetf(ios::floatfield);
+
+	/*Step 12: Clean the per-shape resources.*/
+		void *ptrs[9] = { A8, B8, A32, B32, A16, B16, C32, C8, C16 };
+		for (int i = 0; i < 9; i++)
+			clSVMFree(env.context, ptrs[i]);
+	}
+
+/*Step 13: Clean the resources.*/
+	for (int k = 0; k < 3; k++)
+		clReleaseKernel(kernels[k]);
+	clReleaseProgram(program);
+	releaseCL(env);
+	return isSuccess;
+}
+
+SVM_BENCH_NAMESPACE_END
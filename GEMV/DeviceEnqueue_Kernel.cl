@@ -0,0 +1,43 @@
+// Power iteration with device-side enqueue (OpenCL 2.0). Kernel.cl is
+// prepended by the host, so GEMV_row_float() and normalize_into() are
+// available here.
+
+// Launched by the host as a single work-item: enqueues every iteration
+// (GEMV over M rows, then normalize) on the default device queue, each
+// child waiting on the event of the previous one, so the host submits
+// once and waits once. *status receives the first failing enqueue_kernel
+// code, or 0.
+__kernel void power_iteration_device( const __global float* A,
+                                      __global float* x,
+                                      __global float* y,
+                                      __global float* norm,
+                                      __global int* status,
+                                      const int M, const int N,
+                                      const int iterations
+                                      ) {
+  queue_t queue = get_default_queue();
+  ndrange_t rows = ndrange_1D(M);
+  ndrange_t single = ndrange_1D(1);
+  clk_event_t previous, gemvDone, normDone;
+  int err = CLK_SUCCESS;
+
+  for (int it = 0; it < iterations && err == CLK_SUCCESS; it++) {
+    err = enqueue_kernel(queue, CLK_ENQUEUE_FLAGS_NO_WAIT, rows,
+                         it == 0 ? 0 : 1, it == 0 ? NULL : &previous, &gemvDone,
+                         ^{ int r = get_global_id(0);
+                            y[r] = GEMV_row_float(A, x, N, r); });
+    if (it > 0)
+      release_event(previous);
+    if (err != CLK_SUCCESS)
+      break;
+
+    err = enqueue_kernel(queue, CLK_ENQUEUE_FLAGS_NO_WAIT, single,
+                         1, &gemvDone, &normDone,
+                         ^{ normalize_into(y, x, norm, M); });
+    release_event(gemvDone);
+    previous = normDone;
+  }
+  if (err == CLK_SUCCESS && iterations > 0)
+    release_event(previous);
+  *status = err;
+}
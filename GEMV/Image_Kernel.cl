@@ -0,0 +1,24 @@
+// GEMV with the matrix read through the texture path: A is a CL_R /
+// CL_SIGNED_INT32 image2d of width N and height M, so A[globalRow * N + k]
+// becomes the texel (k, globalRow). Kept out of Kernel.cl so devices
+// without image support still build it.
+
+__constant sampler_t texels = CLK_NORMALIZED_COORDS_FALSE | CLK_ADDRESS_NONE | CLK_FILTER_NEAREST;
+
+__kernel void GEMV_image( __read_only image2d_t A,
+                          const __global int* B,
+                          __global int* C,
+                          const int M, const int N
+                          ) {
+
+  const int globalRow = get_global_id(0); // Row ID of C (0..M)
+
+  // Compute a single element (loop over K)
+  int temp = 0;
+  for (int k = 0; k < N; k++) {
+    temp += read_imagei(A, texels, (int2)(k, globalRow)).x * B[k];
+  }
+
+  // Store the result
+  C[globalRow] = temp;
+}
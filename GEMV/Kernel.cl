@@ -15,3 +15,47 @@ __kernel void GEMV( const __global int* A,
   // Store the result
   C[globalRow] = temp;
 }
+
+// Single-precision variant for iterative workloads (power iteration); the
+// row product is a plain function so device-enqueued blocks can reuse it.
+float GEMV_row_float( const __global float* A,
+                      const __global float* x,
+                      const int N, const int row
+                      ) {
+  float temp = 0.0f;
+  for (int k = 0; k < N; k++) {
+    temp += A[row * N + k] * x[k];
+  }
+  return temp;
+}
+
+__kernel void GEMV_float( const __global float* A,
+                          const __global float* x,
+                          __global float* y,
+                          const int M, const int N
+                          ) {
+  const int globalRow = get_global_id(0);
+  y[globalRow] = GEMV_row_float(A, x, N, globalRow);
+}
+
+// x = y / ||y||, norm = ||y||. One work-item; M is small next to the GEMV.
+void normalize_into(const __global float* y, __global float* x,
+                    __global float* norm, const int M) {
+  float sum = 0.0f;
+  for (int i = 0; i < M; i++) {
+    sum += y[i] * y[i];
+  }
+  float n = sqrt(sum);
+  for (int i = 0; i < M; i++) {
+    x[i] = y[i] / n;
+  }
+  *norm = n;
+}
+
+__kernel void normalize_vector( const __global float* y,
+                                __global float* x,
+                                __global float* norm,
+                                const int M
+                                ) {
+  normalize_into(y, x, norm, M);
+}
@@ -0,0 +1,35 @@
+// GEMV with the shape fixed at build time: -DM=.. -DN=.. (A is MxN,
+// row-major), -DT=.. element type (int by default). When N is a multiple
+// of 4 the row is read with vload4.
+
+#ifndef T
+#define T int
+#endif
+
+#define T4 CONCAT(T, 4)
+#define CONCAT(a, b) CONCAT_(a, b)
+#define CONCAT_(a, b) a ## b
+
+__kernel void GEMV_spec( const __global T* A,
+                         const __global T* x,
+                         __global T* y
+                         ) {
+  const int globalRow = get_global_id(0);
+  const __global T* row = A + globalRow * N;
+
+#if N % 4 == 0
+  T4 acc = 0;
+  #pragma unroll 4
+  for (int k = 0; k < N / 4; k++) {
+    acc += vload4(k, row) * vload4(k, x);
+  }
+  y[globalRow] = acc.s0 + acc.s1 + acc.s2 + acc.s3;
+#else
+  T temp = 0;
+  #pragma unroll 8
+  for (int k = 0; k < N; k++) {
+    temp += row[k] * x[k];
+  }
+  y[globalRow] = temp;
+#endif
+}
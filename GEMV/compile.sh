@@ -1,3 +1,3 @@
 #!bin/bash
 
-  g++ -std=c++11 prog.c -lOpenCL -Wno-deprecated-declarations -o prog
\ No newline at end of file
+  g++ -std=c++11 -O2 -I${VIENNACL_DIR:-/home/ctchao/ViennaCLPP} prog.cpp -lOpenCL -Wno-deprecated-declarations -o prog
\ No newline at end of file
@@ -0,0 +1,1311 @@
+/**********************************************************************
+Copyright ©2014 Advanced Micro Devices, Inc. All rights reserved.
+
+Redistribution and use in source and binary forms, with or without modification, are permitted provided that the following conditions are met:
+
+	Redistributions of source code must retain the above copyright notice, this list of conditions and the following disclaimer.
+	Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the following disclaimer in the documentation and/or
+ other materials provided with the distribution.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY
+ DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS
+ OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+ NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+********************************************************************/
+
+// For clarity,error checking has been omitted.
+
+#include <CL/cl.h>
+#include <string.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <math.h>
+#include <iostream>
+#include <string>
+#include <fstream>
+#include <iomanip>
+#include <chrono>
+
+#include "viennacl/tools/timer.hpp"
+#include "../common/MatrixLoader.hpp"
+#include "../common/CLSetup.hpp"
+#include "../common/PerfCounters.hpp"
+#include "../common/LaunchPlan.hpp"
+#include "../common/Histogram.hpp"
+#include "../common/ProgramCache.hpp"
+#include "../common/Roofline.hpp"
+#include "../common/BenchmarkRegistry.hpp"
+
+#define SUCCESS 0
+#define FAILURE 1
+
+SVM_BENCH_NAMESPACE_BEGIN(gemv)
+
+using namespace std;
+
+int Ndim = 3840;
+int Mdim = 3840;
+
+/* optional on-disk inputs: prog [A-file x-file], see common/MatrixLoader.hpp */
+MappedMatrix inputA;
+MappedMatrix inputB;
+
+/* high-frequency small GEMV calls, see GEMV_small_calls() */
+const int SMALL_DIM = 64;
+const int SMALL_CALLS = 10000;
+const int SMALL_VECTORS = 16;
+
+/* power iteration, see GEMV_power_iteration() */
+const int PI_DIM = 1024;
+const int PI_ITERATIONS = 100;
+    
+/* convert the kernel file into a string */
+int convertToString(const char *filename, std::string& s)
+{
+	size_t size;
+	char*  str;
+	std::fstream f(filename, (std::fstream::in | std::fstream::binary));
+
+	if(f.is_open())
+	{
+		size_t fileSize;
+		f.seekg(0, std::fstream::end);
+		size = fileSize = (size_t)f.tellg();
+		f.seekg(0, std::fstream::beg);
+		str = new char[size+1];
+		if(!str)
+		{
+			f.close();
+			return 0;
+		}
+
+		f.read(str, fileSize);
+		f.close();
+		str[size] = '\0';
+		s = str;
+		delete[] str;
+		return 0;
+	}
+	cout<<"Error: failed to open file\n:"<<filename<<endl;
+	return FAILURE;
+}
+
+int GEMV_svm();
+int GEMV_non_svm();
+int GEMV_host_ptr();
+int GEMV_image();
+int GEMV_small_calls();
+int GEMV_power_iteration();
+int GEMV_specialized();
+
+
+#ifdef SVM_BENCH_DRIVER
+static BenchmarkRegistrar registrar(Benchmark("GEMV", "GEMV")
+	.param("M", "rows of A", &Mdim)
+	.param("N", "columns of A", &Ndim)
+	.mode("svm", GEMV_svm)
+	.mode("non_svm", GEMV_non_svm)
+	.mode("host_ptr", GEMV_host_ptr)
+	.mode("image", GEMV_image)
+	.mode("small_calls", GEMV_small_calls)
+	.mode("power_iteration", GEMV_power_iteration)
+	.mode("specialized", GEMV_specialized));
+#else
+int main(int argc, char* argv[])
+{
+  PerfCounters::instance();  // SVM_PERF_COUNTERS=1: open before the runtime starts threads
+
+  int isSuccess;
+
+  if (argc == 3)
+  {
+    if (mapMatrixFile(argv[1], ELEM_INT32, inputA) != SUCCESS ||
+        mapMatrixFile(argv[2], ELEM_INT32, inputB) != SUCCESS)
+      return FAILURE;
+    if (inputB.count() != inputA.cols)
+    {
+      cout << "Error: x has " << inputB.count() << " elements, A has " << inputA.cols << " columns" << endl;
+      return FAILURE;
+    }
+    Mdim = inputA.rows;
+    Ndim = inputA.cols;
+    cout << "Inputs: " << argv[1] << " (" << Mdim << "x" << Ndim << "), " << argv[2] << endl;
+  }
+
+  std::cout << "SVM \n------------------------------ \n" << std::endl;
+  {
+    viennacl::tools::timer timer;
+    double time_previous, time_spent;
+    size_t Nruns;
+    double time_per_benchmark = 1;
+    
+    timer.start(); 
+    Nruns = 0; 
+    time_spent = 0; 
+    
+    isSuccess = GEMV_svm();
+    
+    while (Nruns < 1){ 
+      time_previous = timer.get(); 
+      isSuccess = GEMV_svm();
+      time_spent += timer.get() - time_previous; 
+      Nruns+=1; 
+    } 
+    time_spent/=(double)Nruns; 
+    std::cout << "OpenCl SVM GEMV Execution time is: " << time_spent << " s, Nruns:" << Nruns << std::endl;  
+  }
+  
+  
+  std::cout << "\n\n" << "Non-SVM \n------------------------------ " << std::endl;
+  {
+    viennacl::tools::timer timer;
+    double time_previous, time_spent;
+    size_t Nruns;
+    double time_per_benchmark = 1;
+    
+    timer.start(); 
+    Nruns = 0; 
+    time_spent = 0; 
+    
+    isSuccess = GEMV_non_svm();
+    
+    while (Nruns < 1){ 
+      time_previous = timer.get(); 
+      isSuccess = GEMV_non_svm();
+      time_spent += timer.get() - time_previous; 
+      Nruns+=1; 
+    } 
+    time_spent/=(double)Nruns; 
+    std::cout << "OpenCl Non-SVM GEMV Execution time is: " << time_spent << " s, Nruns:" << Nruns << std::endl;
+  }
+  
+  
+  std::cout << "\n\n" << "Host-Ptr \n------------------------------ " << std::endl;
+  {
+    viennacl::tools::timer timer;
+    double time_previous, time_spent;
+    size_t Nruns;
+    
+    timer.start(); 
+    Nruns = 0; 
+    time_spent = 0; 
+    
+    isSuccess = GEMV_host_ptr();
+    
+    while (Nruns < 1){ 
+      time_previous = timer.get(); 
+      isSuccess = GEMV_host_ptr();
+      time_spent += timer.get() - time_previous; 
+      Nruns+=1; 
+    } 
+    time_spent/=(double)Nruns; 
+    std::cout << "OpenCl Host-Ptr GEMV Execution time is: " << time_spent << " s, Nruns:" << Nruns << std::endl;
+  }
+
+  std::cout << "\n\n" << "Image \n------------------------------ " << std::endl;
+  {
+    viennacl::tools::timer timer;
+    double time_previous, time_spent;
+    size_t Nruns;
+    
+    timer.start(); 
+    Nruns = 0; 
+    time_spent = 0; 
+    
+    isSuccess = GEMV_image();
+    
+    while (Nruns < 1){ 
+      time_previous = timer.get(); 
+      isSuccess = GEMV_image();
+      time_spent += timer.get() - time_previous; 
+      Nruns+=1; 
+    } 
+    time_spent/=(double)Nruns; 
+    std::cout << "OpenCl Image GEMV Execution time is: " << time_spent << " s, Nruns:" << Nruns << std::endl;
+  }
+
+  std::cout << "\n\n" << "Small calls \n------------------------------ " << std::endl;
+  isSuccess = GEMV_small_calls();
+
+  std::cout << "\n\n" << "Power iteration \n------------------------------ " << std::endl;
+  isSuccess = GEMV_power_iteration();
+
+  std::cout << "\n\n" << "Specialized \n------------------------------ " << std::endl;
+  isSuccess = GEMV_specialized();
+
+  Roofline::instance().report();
+  Roofline::instance().exportCsv("roofline.csv");
+
+  unmapMatrixFile(inputA);
+  unmapMatrixFile(inputB);
+}
+#endif
+
+
+
+int GEMV_svm(){
+	PhaseProfiler phases("GEMV SVM");
+	phases.next("setup");
+
+/*Step1-4: Platform, device, context and command queue.*/
+	CLEnv env;
+	if (setupCL(env) != SUCCESS)
+		return FAILURE;
+	cl_device_id *devices = env.devices;
+	cl_context context = env.context;
+	cl_command_queue commandQueue = env.commandQueue;
+	cl_int status = CL_SUCCESS;
+
+/*Step 5: Create program object */
+	const char *filename = "Kernel.cl";
+	string sourceStr;
+	status = convertToString(filename, sourceStr);
+	const char *source = sourceStr.c_str();
+	size_t sourceSize[] = {strlen(source)};
+	cl_program program = clCreateProgramWithSource(context, 1, &source, sourceSize, NULL);
+	
+/*Step 6: Build program. */
+	const char options[] = "-cl-std=CL2.0";
+	status = clBuildProgram(program, 1,devices, options,NULL,NULL);
+	if (status != CL_SUCCESS)
+	{
+		cout << "Error: building " << filename << " failed, status: " << status << endl;
+		clReleaseProgram(program);
+		releaseCL(env);
+		return FAILURE;
+	}
+
+/*Step 7: Create kernel object */
+	cl_kernel kernel = clCreateKernel(program, "GEMV", NULL);
+	
+	phases.next("inputs", commandQueue);
+
+/*Step 8: Initial input,output for the host and create SVM buffer*/
+  int szA = Mdim * Ndim;
+  int szB = Ndim;
+  int szC = Mdim;
+
+  int *c = (int *)malloc(szC * sizeof(int));
+	
+  int *A;
+  int *B;
+  bool zeroCopyA = false;
+  bool zeroCopyB = false;
+	int *C = (int *)clSVMAlloc( context, CL_MEM_READ_WRITE, szC * sizeof(int), 0 );
+
+  if (inputA.loaded())
+  {
+    // Stream (or, with fine-grained system SVM, alias) the mapped files
+    A = (int *)loadIntoSVM(context, commandQueue, devices[0], inputA, ELEM_INT32, zeroCopyA);
+    B = (int *)loadIntoSVM(context, commandQueue, devices[0], inputB, ELEM_INT32, zeroCopyB);
+  }
+  else
+  {
+  A = (int *)clSVMAlloc( context, CL_MEM_READ_WRITE, szA * sizeof(int), 0 );
+  B = (int *)clSVMAlloc( context, CL_MEM_READ_WRITE, szB * sizeof(int), 0 );
+
+// Initialize	
+  int* a = (int*)malloc(szA * sizeof(int));
+  for(int i = 0; i < szA; i++){
+    a[i] = i;
+  }
+  
+  int* b = (int*)malloc(szB * sizeof(int));
+  for(int i = 0; i < szB; i++){
+    b[i] = 1;
+  }
+  
+  memcpy(A, a, szA * sizeof(int));
+  memcpy(B, b, szB * sizeof(int));
+ 
+	status = clEnqueueSVMMap(commandQueue, CL_TRUE, CL_MAP_WRITE_INVALIDATE_REGION, A, szA * sizeof(int), 0, NULL, NULL);
+  status = clEnqueueSVMMap(commandQueue, CL_TRUE, CL_MAP_WRITE_INVALIDATE_REGION, B, szB * sizeof(int), 0, NULL, NULL);
+  
+	status = clEnqueueSVMUnmap(commandQueue, A, 0, NULL, NULL);
+  status = clEnqueueSVMUnmap(commandQueue, B, 0, NULL, NULL);
+  }
+ 
+	phases.next("kernel", commandQueue);
+
+/*Step 9: Sets Kernel arguments.*/
+	status = clSetKernelArgSVMPointer(kernel, 0, A);
+ 	
+  status = clSetKernelArgSVMPointer(kernel, 1, B);
+
+  status = clSetKernelArgSVMPointer(kernel, 2, C);
+ 	
+  status = clSetKernelArg(kernel, 3, sizeof(int), &Mdim);
+   
+  status = clSetKernelArg(kernel, 4, sizeof(int), &Ndim);
+  
+ 
+/*Step 10: Running the kernel.*/
+	size_t global_work_size[1] = {(size_t)Mdim};
+  
+	cl_event kernelEvent;
+	status = clEnqueueNDRangeKernel(commandQueue, kernel, 1, NULL, global_work_size, NULL, 0, NULL, &kernelEvent);
+	Roofline::instance().recordEvent("GEMV", "SVM", 2.0 * Mdim * Ndim, (szA + szB + szC) * sizeof(int), kernelEvent);
+  
+  status = clEnqueueSVMMap(commandQueue, CL_TRUE, CL_MAP_WRITE_INVALIDATE_REGION, C, szC * sizeof(int), 0, NULL, NULL);
+ 
+  memcpy(c, C, szC * sizeof(int));
+
+	phases.next("readback", commandQueue);
+
+/*Step 11: Test if kernel works and char. are all assign to outputBuffer*/
+/*	
+	cout << "\nA :" << endl;
+  for(int i = 0; i < szA; i++){
+
+    cout << setw(4) << (int)A[i] << " ";
+    if( ((i+1) % Ndim) == 0 ){
+      cout << endl;
+    }
+    
+  }
+    
+  cout << "\nB :" << endl;
+  for(int i = 0; i < szB; i++){
+
+    cout << setw(4) << (int)B[i] << " ";
+    if( ((i+1) % Pdim) == 0 ){
+      cout << endl;
+    }
+    
+  }
+
+	cout << "\nC :" << endl;
+  for(int i = 0; i < szC; i++){
+
+    cout << setw(4) << c[i] << " ";
+    if( ((i+1) % Pdim) == 0 ){
+      cout << endl;
+    }
+    
+  }
+*/
+  status = clEnqueueSVMUnmap(commandQueue, C, 0, NULL, NULL);
+
+	phases.next("cleanup", commandQueue);
+
+/*Step 12: Clean the resources.*/
+	releaseSVMInput(context, A, zeroCopyA);
+  releaseSVMInput(context, B, zeroCopyB);
+	clSVMFree(context, C);  
+	status = clReleaseKernel(kernel);				//Release kernel.
+	status = clReleaseProgram(program);				//Release the program object.
+	releaseCL(env);
+
+	if (c != NULL)
+	{
+		free(c);
+		c = NULL;
+	}
+
+	phases.report();
+
+	cout<<"Program passed!\n";
+  return SUCCESS;
+}
+
+
+
+int GEMV_non_svm(){
+
+	PhaseProfiler phases("GEMV Non-SVM");
+	phases.next("setup");
+
+/*Step1-4: Platform, device, context and command queue.*/
+	CLEnv env;
+	if (setupCL(env) != SUCCESS)
+		return FAILURE;
+	cl_device_id *devices = env.devices;
+	cl_context context = env.context;
+	cl_command_queue commandQueue = env.commandQueue;
+	cl_int status = CL_SUCCESS;
+
+	/*Step 5: Create program object */
+	const char *filename = "Kernel.cl";
+	string sourceStr;
+	status = convertToString(filename, sourceStr);
+	const char *source = sourceStr.c_str();
+	size_t sourceSize[] = { strlen(source) };
+	cl_program program = clCreateProgramWithSource(context, 1, &source, sourceSize, NULL);
+
+	/*Step 6: Build program. */
+	status = clBuildProgram(program, 1, devices, NULL, NULL, NULL);
+	if (status != CL_SUCCESS)
+	{
+		cout << "Error: building " << filename << " failed, status: " << status << endl;
+		clReleaseProgram(program);
+		releaseCL(env);
+		return FAILURE;
+	}
+
+	phases.next("inputs", commandQueue);
+
+	/*Step 7: Initial input,output for the host and create memory objects for the kernel*/
+	int szA = Mdim * Ndim;
+  int szB = Ndim;
+  int szC = Mdim;
+
+  int *A;
+  int *B;
+  int *C;
+
+  bool ownsA = true;
+  bool ownsB = true;
+
+  C = (int *)malloc(szC * sizeof(int));
+  
+  if (inputA.loaded())
+  {
+    A = (int *)loadIntoHost(inputA, ELEM_INT32, ownsA);
+    B = (int *)loadIntoHost(inputB, ELEM_INT32, ownsB);
+  }
+  else
+  {
+  A = (int *)malloc(szA * sizeof(int));
+  B = (int *)malloc(szB * sizeof(int));
+
+  for(int i = 0; i < szA; i++){
+    A[i] = i;
+  }
+  for(int i = 0; i < szB; i++){
+    B[i] = 1;
+  }
+  }
+  
+	cl_mem Buffer_A = clCreateBuffer(context, CL_MEM_READ_ONLY | CL_MEM_COPY_HOST_PTR, 
+                             szA * sizeof(int), A, NULL);
+  
+  cl_mem Buffer_B = clCreateBuffer(context, CL_MEM_READ_ONLY | CL_MEM_COPY_HOST_PTR, 
+                             szB * sizeof(int), B, NULL);
+                             
+	cl_mem Buffer_C = clCreateBuffer(context, CL_MEM_READ_WRITE | CL_MEM_COPY_HOST_PTR, 
+                             szC * sizeof(int), C, NULL);
+
+	/*Step 8: Create kernel object */
+	cl_kernel kernel = clCreateKernel(program, "GEMV", NULL);
+
+	phases.next("kernel", commandQueue);
+
+	/*Step 9: Sets Kernel arguments.*/
+	status = clSetKernelArg(kernel, 0, sizeof(cl_mem), &Buffer_A);
+	status = clSetKernelArg(kernel, 1, sizeof(cl_mem), &Buffer_B);
+  status = clSetKernelArg(kernel, 2, sizeof(cl_mem), &Buffer_C);
+  status = clSetKernelArg(kernel, 3, sizeof(int), &Mdim);
+  status = clSetKernelArg(kernel, 4, sizeof(int), &Ndim);
+
+  
+	/*Step 10: Running the kernel.*/
+	size_t global_work_size[1] = { (size_t)Mdim };
+ 
+	cl_event kernelEvent;
+	status = clEnqueueNDRangeKernel(commandQueue, kernel, 1, NULL, 
+                                        global_work_size, NULL, 0, NULL, &kernelEvent);
+	Roofline::instance().recordEvent("GEMV", "Non-SVM", 2.0 * Mdim * Ndim, (szA + szB + szC) * sizeof(int), kernelEvent);
+  
+	phases.next("readback", commandQueue);
+
+	/*Step 11: Read the cout put back to host memory.*/
+  
+	status = clEnqueueReadBuffer(commandQueue, Buffer_C, CL_TRUE, 0, 
+                 szC * sizeof(int), C, 0, NULL, NULL);
+/*
+  cout << "\nA :" << endl;
+  for(int i = 0; i < szA; i++){
+
+    cout << setw(4) << A[i] << " ";
+    if( ((i+1) % Ndim) == 0 ){
+      cout << endl;
+    }
+    
+  }
+    
+  cout << "\nB :" << endl;
+  for(int i = 0; i < szB; i++){
+
+    cout << setw(4) << B[i] << " ";
+    if( ((i+1) % Pdim) == 0 ){
+      cout << endl;
+    }
+    
+  }
+
+	cout << "\nC :" << endl;
+  for(int i = 0; i < szC; i++){
+
+    cout << setw(4) << C[i] << " ";
+    if( ((i+1) % Pdim) == 0 ){
+      cout << endl;
+    }
+    
+  }
+*/  
+
+	phases.next("cleanup", commandQueue);
+
+	/*Step 12: Clean the resources.*/
+	status = clReleaseKernel(kernel); //Release kernel.
+	status = clReleaseProgram(program); //Release the program object.
+	status = clReleaseMemObject(Buffer_A); //Release mem object.
+  status = clReleaseMemObject(Buffer_B);
+	status = clReleaseMemObject(Buffer_C);
+	releaseCL(env);
+
+	if (C != NULL)
+	{
+		free(C);
+		C = NULL;
+	}
+
+	if (ownsA) free(A);  // file inputs used in place are not ours to free
+	if (ownsB) free(B);
+
+	phases.report();
+
+	std::cout << "\nPassed!\n";
+	return SUCCESS;
+ 
+}
+
+
+
+int GEMV_host_ptr(){
+	PhaseProfiler phases("GEMV Host-Ptr");
+	phases.next("setup");
+
+/*Step1-4: Platform, device, context and command queue.*/
+	CLEnv env;
+	if (setupCL(env) != SUCCESS)
+		return FAILURE;
+
+/*Step 5-6: Create and build program. */
+	cl_program program = buildProgramFromFile(env, "Kernel.cl", NULL);
+	if (program == NULL)
+		return FAILURE;
+
+/*Step 7: Create kernel object */
+	cl_int status;
+	cl_kernel kernel = clCreateKernel(program, "GEMV", NULL);
+
+	phases.next("inputs", env.commandQueue);
+
+/*Step 8: Zero-copy buffers. A and B wrap our own page-aligned allocations
+  (CL_MEM_USE_HOST_PTR), C is runtime-allocated host memory (CL_MEM_ALLOC_HOST_PTR).
+  Inputs are written through a map so no copy is made on unified-memory devices.*/
+  int szA = Mdim * Ndim;
+  int szB = Ndim;
+  int szC = Mdim;
+
+  int *c = (int *)malloc(szC * sizeof(int));
+  int *a = (int *)alignedHostAlloc(szA * sizeof(int));
+  int *b = (int *)alignedHostAlloc(szB * sizeof(int));
+
+  cl_mem Buffer_A = clCreateBuffer(env.context, CL_MEM_READ_ONLY | CL_MEM_USE_HOST_PTR, 
+                             szA * sizeof(int), a, NULL);
+  cl_mem Buffer_B = clCreateBuffer(env.context, CL_MEM_READ_ONLY | CL_MEM_USE_HOST_PTR, 
+                             szB * sizeof(int), b, NULL);
+  cl_mem Buffer_C = clCreateBuffer(env.context, CL_MEM_WRITE_ONLY | CL_MEM_ALLOC_HOST_PTR, 
+                             szC * sizeof(int), NULL, NULL);
+
+  int *A = (int *)clEnqueueMapBuffer(env.commandQueue, Buffer_A, CL_TRUE, CL_MAP_WRITE_INVALIDATE_REGION, 
+                             0, szA * sizeof(int), 0, NULL, NULL, &status);
+  int *B = (int *)clEnqueueMapBuffer(env.commandQueue, Buffer_B, CL_TRUE, CL_MAP_WRITE_INVALIDATE_REGION, 
+                             0, szB * sizeof(int), 0, NULL, NULL, &status);
+  if (A != a || B != b)
+    cout << "Note: runtime did not map the host pointer in place (copying buffers)" << endl;
+
+  if (inputA.loaded())
+  {
+    copyMatrixTo(inputA, ELEM_INT32, A);
+    copyMatrixTo(inputB, ELEM_INT32, B);
+  }
+  else
+  {
+    for(int i = 0; i < szA; i++){
+      A[i] = i;
+    }
+    for(int i = 0; i < szB; i++){
+      B[i] = 1;
+    }
+  }
+
+  status = clEnqueueUnmapMemObject(env.commandQueue, Buffer_A, A, 0, NULL, NULL);
+  status = clEnqueueUnmapMemObject(env.commandQueue, Buffer_B, B, 0, NULL, NULL);
+
+	phases.next("kernel", env.commandQueue);
+
+/*Step 9: Sets Kernel arguments.*/
+	status = clSetKernelArg(kernel, 0, sizeof(cl_mem), &Buffer_A);
+	status = clSetKernelArg(kernel, 1, sizeof(cl_mem), &Buffer_B);
+  status = clSetKernelArg(kernel, 2, sizeof(cl_mem), &Buffer_C);
+  status = clSetKernelArg(kernel, 3, sizeof(int), &Mdim);
+  status = clSetKernelArg(kernel, 4, sizeof(int), &Ndim);
+
+/*Step 10: Running the kernel.*/
+	size_t global_work_size[1] = { (size_t)Mdim };
+
+	cl_event kernelEvent;
+	status = clEnqueueNDRangeKernel(env.commandQueue, kernel, 1, NULL, 
+                                        global_work_size, NULL, 0, NULL, &kernelEvent);
+	Roofline::instance().recordEvent("GEMV", "Host-Ptr", 2.0 * Mdim * Ndim, (szA + szB + szC) * sizeof(int), kernelEvent);
+
+	phases.next("readback", env.commandQueue);
+
+/*Step 11: Map the result instead of reading it back.*/
+  int *C = (int *)clEnqueueMapBuffer(env.commandQueue, Buffer_C, CL_TRUE, CL_MAP_READ, 
+                             0, szC * sizeof(int), 0, NULL, NULL, &status);
+
+  memcpy(c, C, szC * sizeof(int));
+
+  status = clEnqueueUnmapMemObject(env.commandQueue, Buffer_C, C, 0, NULL, NULL);
+  clFinish(env.commandQueue);
+
+	phases.next("cleanup", env.commandQueue);
+
+/*Step 12: Clean the resources.*/
+	status = clReleaseKernel(kernel); //Release kernel.
+	status = clReleaseProgram(program); //Release the program object.
+	status = clReleaseMemObject(Buffer_A); //Release mem object.
+  status = clReleaseMemObject(Buffer_B);
+	status = clReleaseMemObject(Buffer_C);
+	releaseCL(env);
+
+  free(a);
+  free(b);
+  free(c);
+
+	phases.report();
+
+	std::cout << "\nPassed!\n";
+	return SUCCESS;
+}
+
+
+
+/* A through the texture path: GEMV_image (Image_Kernel.cl) samples the
+   matrix from a CL_R / CL_SIGNED_INT32 image2d, x and y stay buffers.
+   Creating the objects and uploading into them are separate phases and
+   are timed on their own. Skipped when the device has no image support
+   or A exceeds its image2d limits. */
+int GEMV_image(){
+	PhaseProfiler phases("GEMV Image");
+	phases.next("setup");
+
+/*Step1-4: Platform, device, context and command queue.*/
+	CLEnv env;
+	if (setupCL(env) != SUCCESS)
+		return FAILURE;
+
+/*Step 5-6: Check image support, then create and build program. */
+	if (!imageSupport(env, Ndim, Mdim))
+	{
+		cout << "Skipped" << endl;
+		releaseCL(env);
+		return SUCCESS;
+	}
+	cl_program program = buildProgramFromFile(env, "Image_Kernel.cl", NULL);
+	if (program == NULL)
+	{
+		releaseCL(env);
+		return FAILURE;
+	}
+
+/*Step 7: Create kernel object */
+	cl_int status;
+	cl_kernel kernel = clCreateKernel(program, "GEMV_image", NULL);
+
+	phases.next("inputs", env.commandQueue);
+
+/*Step 8: Host inputs.*/
+  int szA = Mdim * Ndim;
+  int szB = Ndim;
+  int szC = Mdim;
+
+  bool ownsA = true;
+  bool ownsB = true;
+  int *A;
+  int *B;
+  int *C = (int *)malloc(szC * sizeof(int));
+
+  if (inputA.loaded())
+  {
+    A = (int *)loadIntoHost(inputA, ELEM_INT32, ownsA);
+    B = (int *)loadIntoHost(inputB, ELEM_INT32, ownsB);
+  }
+  else
+  {
+    A = (int *)malloc(szA * sizeof(int));
+    B = (int *)malloc(szB * sizeof(int));
+    for(int i = 0; i < szA; i++){
+      A[i] = i;
+    }
+    for(int i = 0; i < szB; i++){
+      B[i] = 1;
+    }
+  }
+
+	phases.next("image create", env.commandQueue);
+
+/*Step 9: Create the image and the buffers (no data yet).*/
+	chrono::steady_clock::time_point createStart = chrono::steady_clock::now();
+	cl_mem Image_A = createIntImage2D(env, CL_MEM_READ_ONLY, Ndim, Mdim, &status);
+	cl_mem Buffer_B = clCreateBuffer(env.context, CL_MEM_READ_ONLY, szB * sizeof(int), NULL, NULL);
+	cl_mem Buffer_C = clCreateBuffer(env.context, CL_MEM_WRITE_ONLY, szC * sizeof(int), NULL, NULL);
+	double createSeconds = chrono::duration<double>(chrono::steady_clock::now() - createStart).count();
+	if (Image_A == NULL)
+	{
+		clReleaseMemObject(Buffer_B);
+		clReleaseMemObject(Buffer_C);
+		clReleaseKernel(kernel);
+		clReleaseProgram(program);
+		releaseCL(env);
+		if (ownsA) free(A);
+		if (ownsB) free(B);
+		free(C);
+		return FAILURE;
+	}
+
+	phases.next("upload", env.commandQueue);
+
+/*Step 10: Upload A into the image and x into its buffer.*/
+	size_t origin[3] = { 0, 0, 0 };
+	size_t region[3] = { (size_t)Ndim, (size_t)Mdim, 1 };
+	cl_event imageEvent, writeEvent;
+	status = clEnqueueWriteImage(env.commandQueue, Image_A, CL_FALSE, origin, region, 0, 0, A, 0, NULL, &imageEvent);
+	status = clEnqueueWriteBuffer(env.commandQueue, Buffer_B, CL_FALSE, 0, szB * sizeof(int), B, 0, NULL, &writeEvent);
+	clFinish(env.commandQueue);
+
+	phases.next("kernel", env.commandQueue);
+
+/*Step 11: Sets Kernel arguments and run the kernel.*/
+	status = clSetKernelArg(kernel, 0, sizeof(cl_mem), &Image_A);
+	status = clSetKernelArg(kernel, 1, sizeof(cl_mem), &Buffer_B);
+  status = clSetKernelArg(kernel, 2, sizeof(cl_mem), &Buffer_C);
+  status = clSetKernelArg(kernel, 3, sizeof(int), &Mdim);
+  status = clSetKernelArg(kernel, 4, sizeof(int), &Ndim);
+
+	size_t global_work_size[1] = { (size_t)Mdim };
+
+	cl_event kernelEvent;
+	status = clEnqueueNDRangeKernel(env.commandQueue, kernel, 1, NULL, 
+                                        global_work_size, NULL, 0, NULL, &kernelEvent);
+	clWaitForEvents(1, &kernelEvent);
+	double kernelSeconds = eventSeconds(kernelEvent);
+	Roofline::instance().recordEvent("GEMV", "Image", 2.0 * Mdim * Ndim, (szA + szB + szC) * sizeof(int), kernelEvent);
+
+	phases.next("readback", env.commandQueue);
+
+/*Step 12: Read the output back to host memory.*/
+	status = clEnqueueReadBuffer(env.commandQueue, Buffer_C, CL_TRUE, 0, szC * sizeof(int), C, 0, NULL, NULL);
+
+	cout << fixed << setprecision(3) << "image create " << createSeconds * 1e3 << " ms, image upload "
+	     << eventSeconds(imageEvent) * 1e3 << " ms (x buffer upload " << eventSeconds(writeEvent) * 1e3
+	     << " ms), kernel " << kernelSeconds * 1e3 << " ms" << endl;
+	cout.unsetf(ios::fixed);
+	clReleaseEvent(imageEvent);
+	clReleaseEvent(writeEvent);
+
+	phases.next("cleanup", env.commandQueue);
+
+/*Step 13: Clean the resources.*/
+	status = clReleaseKernel(kernel); //Release kernel.
+	status = clReleaseProgram(program); //Release the program object.
+	status = clReleaseMemObject(Image_A); //Release mem object.
+  status = clReleaseMemObject(Buffer_B);
+	status = clReleaseMemObject(Buffer_C);
+	releaseCL(env);
+
+  if (ownsA) free(A);
+  if (ownsB) free(B);
+  free(C);
+
+	phases.report();
+
+	std::cout << "\nPassed!\n";
+	return SUCCESS;
+}
+
+
+
+/* Many small GEMVs (SMALL_DIM x SMALL_DIM) against a fixed A, cycling
+   through SMALL_VECTORS input/output vector pairs, three ways:
+     per call   clCreateKernel + every clSetKernelArg* + enqueue, as above
+     plan       one LaunchPlan, only the changed x/y pointers are re-bound
+     replay     a LaunchSequence of SMALL_VECTORS launches replayed with
+                one clFinish per sequence
+   Latency is per GEMV (host submit to result visible). */
+int GEMV_small_calls(){
+/*Step1-4: Platform, device, context and command queue.*/
+	CLEnv env;
+	if (setupCL(env, 0) != SUCCESS)
+		return FAILURE;
+
+/*Step 5-6: Create and build program. */
+	cl_program program = buildProgramFromFile(env, "Kernel.cl", "-cl-std=CL2.0");
+	if (program == NULL)
+	{
+		releaseCL(env);
+		return FAILURE;
+	}
+
+/*Step 7: Fine-grained SVM when available, so no map/unmap is needed
+  between calls; otherwise coarse-grained and the runtime synchronises
+  at kernel boundaries.*/
+	cl_device_svm_capabilities caps = 0;
+	clGetDeviceInfo(env.device(), CL_DEVICE_SVM_CAPABILITIES, sizeof(caps), &caps, NULL);
+	cl_svm_mem_flags flags = CL_MEM_READ_WRITE;
+	if (caps & CL_DEVICE_SVM_FINE_GRAIN_BUFFER)
+		flags |= CL_MEM_SVM_FINE_GRAIN_BUFFER;
+
+	int M = SMALL_DIM, N = SMALL_DIM;
+	int *A = (int *)clSVMAlloc(env.context, flags, M * N * sizeof(int), 0);
+	int *x[SMALL_VECTORS];
+	int *y[SMALL_VECTORS];
+	clEnqueueSVMMap(env.commandQueue, CL_TRUE, CL_MAP_WRITE_INVALIDATE_REGION, A, M * N * sizeof(int), 0, NULL, NULL);
+	for (int i = 0; i < M * N; i++)
+		A[i] = i % 7;
+	clEnqueueSVMUnmap(env.commandQueue, A, 0, NULL, NULL);
+	for (int v = 0; v < SMALL_VECTORS; v++)
+	{
+		x[v] = (int *)clSVMAlloc(env.context, flags, N * sizeof(int), 0);
+		y[v] = (int *)clSVMAlloc(env.context, flags, M * sizeof(int), 0);
+		clEnqueueSVMMap(env.commandQueue, CL_TRUE, CL_MAP_WRITE_INVALIDATE_REGION, x[v], N * sizeof(int), 0, NULL, NULL);
+		for (int k = 0; k < N; k++)
+			x[v][k] = v + k;
+		clEnqueueSVMUnmap(env.commandQueue, x[v], 0, NULL, NULL);
+	}
+	clFinish(env.commandQueue);
+
+	size_t global_work_size[1] = { (size_t)M };
+	LatencyHistogram perCall("per call"), planned("plan"), replayed("replay");
+	typedef std::chrono::steady_clock Clock;
+
+/*Step 8: Current pattern, kernel object and arguments rebuilt per call.*/
+	for (int c = 0; c < SMALL_CALLS; c++)
+	{
+		int v = c % SMALL_VECTORS;
+		Clock::time_point t = Clock::now();
+		cl_kernel kernel = clCreateKernel(program, "GEMV", NULL);
+		clSetKernelArgSVMPointer(kernel, 0, A);
+		clSetKernelArgSVMPointer(kernel, 1, x[v]);
+		clSetKernelArgSVMPointer(kernel, 2, y[v]);
+		clSetKernelArg(kernel, 3, sizeof(int), &M);
+		clSetKernelArg(kernel, 4, sizeof(int), &N);
+		clEnqueueNDRangeKernel(env.commandQueue, kernel, 1, NULL, global_work_size, NULL, 0, NULL, NULL);
+		clFinish(env.commandQueue);
+		clReleaseKernel(kernel);
+		perCall.add(std::chrono::duration<double, std::nano>(Clock::now() - t).count());
+	}
+
+/*Step 9: Launch plan, bound once.*/
+	size_t planSetArgCalls;
+	{
+	LaunchPlan gemv(program, "GEMV", 1, global_work_size);
+	if (!gemv.valid())
+	{
+		clSVMFree(env.context, A);
+		for (int v = 0; v < SMALL_VECTORS; v++)
+		{
+			clSVMFree(env.context, x[v]);
+			clSVMFree(env.context, y[v]);
+		}
+		clReleaseProgram(program);
+		releaseCL(env);
+		return FAILURE;
+	}
+
+	gemv.svm(0, A).scalar(3, M).scalar(4, N);
+	for (int c = 0; c < SMALL_CALLS; c++)
+	{
+		int v = c % SMALL_VECTORS;
+		Clock::time_point t = Clock::now();
+		gemv.svm(1, x[v]).svm(2, y[v]);
+		gemv.enqueue(env.commandQueue);
+		clFinish(env.commandQueue);
+		planned.add(std::chrono::duration<double, std::nano>(Clock::now() - t).count());
+	}
+
+/*Step 10: Recorded sequence over all vector pairs.*/
+	LaunchSequence sequence;
+	for (int v = 0; v < SMALL_VECTORS; v++)
+	{
+		gemv.svm(1, x[v]).svm(2, y[v]);
+		sequence.record(gemv);
+	}
+	for (int c = 0; c < SMALL_CALLS; c += SMALL_VECTORS)
+	{
+		Clock::time_point t = Clock::now();
+		sequence.replay(env.commandQueue);
+		clFinish(env.commandQueue);
+		replayed.add(std::chrono::duration<double, std::nano>(Clock::now() - t).count() / SMALL_VECTORS);
+	}
+	planSetArgCalls = gemv.setArgCalls();
+	}
+
+/*Step 11: Check every output vector against the host.*/
+	bool correct = true;
+	for (int v = 0; v < SMALL_VECTORS; v++)
+	{
+		clEnqueueSVMMap(env.commandQueue, CL_TRUE, CL_MAP_READ, y[v], M * sizeof(int), 0, NULL, NULL);
+		for (int r = 0; r < M; r++)
+		{
+			int expect = 0;
+			for (int k = 0; k < N; k++)
+				expect += ((r * N + k) % 7) * (v + k);
+			correct = correct && y[v][r] == expect;
+		}
+		clEnqueueSVMUnmap(env.commandQueue, y[v], 0, NULL, NULL);
+	}
+	clFinish(env.commandQueue);
+
+	cout << SMALL_CALLS << " GEMVs of " << M << "x" << N << ", microseconds per call" << endl;
+	cout << fixed << setprecision(2);
+	perCall.printSummary(cout);
+	planned.printSummary(cout);
+	replayed.printSummary(cout);
+	cout << "plan clSetKernelArg* calls: " << planSetArgCalls
+	     << " (per-call pattern: " << 5 * SMALL_CALLS << ")" << endl;
+	cout.unsetf(ios::fixed);
+
+/*Step 12: Clean the resources.*/
+	clSVMFree(env.context, A);
+	for (int v = 0; v < SMALL_VECTORS; v++)
+	{
+		clSVMFree(env.context, x[v]);
+		clSVMFree(env.context, y[v]);
+	}
+	clReleaseProgram(program);
+	releaseCL(env);
+
+	if (!correct)
+	{
+		cout << "Error: small GEMV results do not match the host" << endl;
+		return FAILURE;
+	}
+	std::cout << "\nPassed!\n";
+	return SUCCESS;
+}
+
+
+
+/* PI_ITERATIONS steps of power iteration (y = A x, x = y / ||y||) on a
+   PI_DIM x PI_DIM symmetric matrix, three ways:
+     host, finish    host enqueues GEMV + normalize and reads ||y|| back
+                     every iteration, as a convergence check would
+     host, queued    host enqueues every iteration, one clFinish at the end
+     device          one launcher work-item enqueues all iterations from
+                     the device with enqueue_kernel
+   The difference per iteration is the host round trip the device-side
+   variant removes. */
+int GEMV_power_iteration(){
+/*Step1-4: Platform, device, context and command queue.*/
+	CLEnv env;
+	if (setupCL(env, 0) != SUCCESS)
+		return FAILURE;
+
+/*Step 5-6: Create and build the host variants' program. */
+	cl_program program = buildProgramFromFile(env, "Kernel.cl", NULL);
+	if (program == NULL)
+	{
+		releaseCL(env);
+		return FAILURE;
+	}
+
+/*Step 7: Default on-device queue, sized for two launches per iteration,
+  and the device variant's program (Kernel.cl prepended), only when the
+  device supports on-device queues.*/
+	cl_uint maxDeviceQueue = 0;
+	clGetDeviceInfo(env.device(), CL_DEVICE_QUEUE_ON_DEVICE_MAX_SIZE, sizeof(maxDeviceQueue), &maxDeviceQueue, NULL);
+	cl_int status;
+	cl_command_queue deviceQueue = NULL;
+	if (maxDeviceQueue > 0)
+	{
+		cl_uint queueSize = maxDeviceQueue;
+		cl_queue_properties props[] = {
+			CL_QUEUE_PROPERTIES, CL_QUEUE_OUT_OF_ORDER_EXEC_MODE_ENABLE | CL_QUEUE_ON_DEVICE | CL_QUEUE_ON_DEVICE_DEFAULT,
+			CL_QUEUE_SIZE, queueSize,
+			0 };
+		deviceQueue = clCreateCommandQueueWithProperties(env.context, env.device(), props, &status);
+		if (status != CL_SUCCESS)
+			deviceQueue = NULL;
+	}
+	cl_program deviceProgram = NULL;
+	if (deviceQueue != NULL)
+	{
+		const char *files[] = { "Kernel.cl", "DeviceEnqueue_Kernel.cl" };
+		deviceProgram = buildProgramFromFiles(env, files, 2, "-cl-std=CL2.0");
+		if (deviceProgram == NULL)
+		{
+			clReleaseCommandQueue(deviceQueue);
+			clReleaseProgram(program);
+			releaseCL(env);
+			return FAILURE;
+		}
+	}
+	else
+		cout << "Device does not support on-device queues; device variant skipped." << endl;
+
+/*Step 8: Inputs in coarse-grained SVM. A[i][j] = 1 / (1 + |i - j|).*/
+	int M = PI_DIM, N = PI_DIM, iterations = PI_ITERATIONS;
+	float *A = (float *)clSVMAlloc(env.context, CL_MEM_READ_ONLY, M * N * sizeof(float), 0);
+	float *x = (float *)clSVMAlloc(env.context, CL_MEM_READ_WRITE, N * sizeof(float), 0);
+	float *y = (float *)clSVMAlloc(env.context, CL_MEM_READ_WRITE, M * sizeof(float), 0);
+	float *norm = (float *)clSVMAlloc(env.context, CL_MEM_READ_WRITE, sizeof(float), 0);
+	int *deviceStatus = (int *)clSVMAlloc(env.context, CL_MEM_READ_WRITE, sizeof(int), 0);
+
+	clEnqueueSVMMap(env.commandQueue, CL_TRUE, CL_MAP_WRITE_INVALIDATE_REGION, A, M * N * sizeof(float), 0, NULL, NULL);
+	for (int i = 0; i < M; i++)
+		for (int j = 0; j < N; j++)
+			A[i * N + j] = 1.0f / (1 + abs(i - j));
+	clEnqueueSVMUnmap(env.commandQueue, A, 0, NULL, NULL);
+
+/*Step 9: Kernel objects.*/
+	cl_kernel gemv = clCreateKernel(program, "GEMV_float", NULL);
+	cl_kernel normalize = clCreateKernel(program, "normalize_vector", NULL);
+	cl_kernel launcher = deviceProgram != NULL ? clCreateKernel(deviceProgram, "power_iteration_device", NULL) : NULL;
+	clSetKernelArgSVMPointer(gemv, 0, A);
+	clSetKernelArgSVMPointer(gemv, 1, x);
+	clSetKernelArgSVMPointer(gemv, 2, y);
+	clSetKernelArg(gemv, 3, sizeof(int), &M);
+	clSetKernelArg(gemv, 4, sizeof(int), &N);
+	clSetKernelArgSVMPointer(normalize, 0, y);
+	clSetKernelArgSVMPointer(normalize, 1, x);
+	clSetKernelArgSVMPointer(normalize, 2, norm);
+	clSetKernelArg(normalize, 3, sizeof(int), &M);
+	if (launcher != NULL)
+	{
+		clSetKernelArgSVMPointer(launcher, 0, A);
+		clSetKernelArgSVMPointer(launcher, 1, x);
+		clSetKernelArgSVMPointer(launcher, 2, y);
+		clSetKernelArgSVMPointer(launcher, 3, norm);
+		clSetKernelArgSVMPointer(launcher, 4, deviceStatus);
+		clSetKernelArg(launcher, 5, sizeof(int), &M);
+		clSetKernelArg(launcher, 6, sizeof(int), &N);
+		clSetKernelArg(launcher, 7, sizeof(int), &iterations);
+	}
+
+	size_t rows[1] = { (size_t)M };
+	size_t one[1] = { 1 };
+	const char *modes[] = { "host, finish", "host, queued", "device" };
+	double seconds[3] = { 0, 0, 0 };
+	float eigenvalue[3] = { 0, 0, 0 };
+
+/*Step 10: Run each variant from the same start vector.*/
+	for (int mode = 0; mode < 3; mode++)
+	{
+		if (mode == 2 && launcher == NULL)
+			continue;
+
+		clEnqueueSVMMap(env.commandQueue, CL_TRUE, CL_MAP_WRITE_INVALIDATE_REGION, x, N * sizeof(float), 0, NULL, NULL);
+		for (int i = 0; i < N; i++)
+			x[i] = 1.0f / sqrtf((float)N);
+		clEnqueueSVMUnmap(env.commandQueue, x, 0, NULL, NULL);
+		clFinish(env.commandQueue);
+
+		viennacl::tools::timer timer;
+		timer.start();
+		if (mode == 2)
+		{
+			clEnqueueNDRangeKernel(env.commandQueue, launcher, 1, NULL, one, one, 0, NULL, NULL);
+			clFinish(env.commandQueue);
+		}
+		else
+		{
+			for (int it = 0; it < iterations; it++)
+			{
+				clEnqueueNDRangeKernel(env.commandQueue, gemv, 1, NULL, rows, NULL, 0, NULL, NULL);
+				clEnqueueNDRangeKernel(env.commandQueue, normalize, 1, NULL, one, one, 0, NULL, NULL);
+				if (mode == 0)
+				{
+					clEnqueueSVMMap(env.commandQueue, CL_TRUE, CL_MAP_READ, norm, sizeof(float), 0, NULL, NULL);
+					eigenvalue[mode] = *norm;
+					clEnqueueSVMUnmap(env.commandQueue, norm, 0, NULL, NULL);
+				}
+			}
+			clFinish(env.commandQueue);
+		}
+		seconds[mode] = timer.get();
+
+		clEnqueueSVMMap(env.commandQueue, CL_TRUE, CL_MAP_READ, norm, sizeof(float), 0, NULL, NULL);
+		eigenvalue[mode] = *norm;
+		clEnqueueSVMUnmap(env.commandQueue, norm, 0, NULL, NULL);
+		if (mode == 2)
+		{
+			clEnqueueSVMMap(env.commandQueue, CL_TRUE, CL_MAP_READ, deviceStatus, sizeof(int), 0, NULL, NULL);
+			if (*deviceStatus != 0)
+				cout << "Error: enqueue_kernel on the device failed, status: " << *deviceStatus << endl;
+			clEnqueueSVMUnmap(env.commandQueue, deviceStatus, 0, NULL, NULL);
+		}
+		clFinish(env.commandQueue);
+	}
+
+	cout << iterations << " iterations of " << M << "x" << N << " power iteration" << endl;
+	for (int mode = 0; mode < 3; mode++)
+	{
+		if (seconds[mode] == 0)
+			continue;
+		cout << setw(14) << modes[mode] << "  " << seconds[mode] << " s, "
+		     << seconds[mode] / iterations * 1e6 << " us/iteration, eigenvalue " << eigenvalue[mode] << endl;
+	}
+	bool correct = fabs(eigenvalue[1] - eigenvalue[0]) <= 1e-3f * eigenvalue[0];
+	if (seconds[2] > 0)
+	{
+		correct = correct && fabs(eigenvalue[2] - eigenvalue[0]) <= 1e-3f * eigenvalue[0];
+		cout << "host round trip removed per iteration: "
+		     << (seconds[0] - seconds[2]) / iterations * 1e6 << " us" << endl;
+	}
+
+/*Step 11: Clean the resources.*/
+	clReleaseKernel(gemv);
+	clReleaseKernel(normalize);
+	if (launcher != NULL)
+		clReleaseKernel(launcher);
+	clSVMFree(env.context, A);
+	clSVMFree(env.context, x);
+	clSVMFree(env.context, y);
+	clSVMFree(env.context, norm);
+	clSVMFree(env.context, deviceStatus);
+	if (deviceQueue != NULL)
+		clReleaseCommandQueue(deviceQueue);
+	if (deviceProgram != NULL)
+		clReleaseProgram(deviceProgram);
+	clReleaseProgram(program);
+	releaseCL(env);
+
+	if (!correct)
+	{
+		cout << "Error: variants disagree on the eigenvalue" << endl;
+		return FAILURE;
+	}
+	std::cout << "\nPassed!\n";
+	return SUCCESS;
+}
+
+
+
+/* Generic GEMV (M, N as kernel arguments) against GEMV_spec from
+   Specialized_Kernel.cl, built per shape with -DM/-DN/-DT. Every timed
+   specialised call looks its program up in the ProgramCache, as a
+   production caller would; only the first lookup per shape builds. */
+int GEMV_specialized(){
+	const int NRUNS = 20;
+
+/*Step1-4: Platform, device, context and command queue.*/
+	CLEnv env;
+	if (setupCL(env) != SUCCESS)
+		return FAILURE;
+
+/*Step 5-6: Generic program once, specialised ones through the cache. */
+	cl_program generic = buildProgramFromFile(env, "Kernel.cl", "-cl-std=CL2.0");
+	if (generic == NULL)
+	{
+		releaseCL(env);
+		return FAILURE;
+	}
+	ProgramCache cache(env);
+
+	int shapes[][2] = { { 256, 256 }, { 1024, 4096 }, { 4096, 1024 }, { Mdim, Ndim } };
+	int numShapes = 4;
+	int isSuccess = SUCCESS;
+	cout << setw(12) << "M x N" << setw(14) << "generic us" << setw(14) << "special us" << setw(10) << "speedup" << endl;
+
+	for (int s = 0; s < numShapes; s++)
+	{
+		int M = shapes[s][0], N = shapes[s][1];
+
+	/*Step 7: Inputs in SVM.*/
+		int *A = (int *)clSVMAlloc(env.context, CL_MEM_READ_ONLY, (size_t)M * N * sizeof(int), 0);
+		int *x = (int *)clSVMAlloc(env.context, CL_MEM_READ_ONLY, N * sizeof(int), 0);
+		int *y1 = (int *)clSVMAlloc(env.context, CL_MEM_READ_WRITE, M * sizeof(int), 0);
+		int *y2 = (int *)clSVMAlloc(env.context, CL_MEM_READ_WRITE, M * sizeof(int), 0);
+		clEnqueueSVMMap(env.commandQueue, CL_TRUE, CL_MAP_WRITE_INVALIDATE_REGION, A, (size_t)M * N * sizeof(int), 0, NULL, NULL);
+		clEnqueueSVMMap(env.commandQueue, CL_TRUE, CL_MAP_WRITE_INVALIDATE_REGION, x, N * sizeof(int), 0, NULL, NULL);
+		for (size_t i = 0; i < (size_t)M * N; i++)
+			A[i] = i % 17;
+		for (int k = 0; k < N; k++)
+			x[k] = k % 5;
+		clEnqueueSVMUnmap(env.commandQueue, A, 0, NULL, NULL);
+		clEnqueueSVMUnmap(env.commandQueue, x, 0, NULL, NULL);
+		size_t global_work_size[1] = { (size_t)M };
+
+	/*Step 8: Generic kernel.*/
+		cl_kernel kernel = clCreateKernel(generic, "GEMV", NULL);
+		clSetKernelArgSVMPointer(kernel, 0, A);
+		clSetKernelArgSVMPointer(kernel, 1, x);
+		clSetKernelArgSVMPointer(kernel, 2, y1);
+		clSetKernelArg(kernel, 3, sizeof(int), &M);
+		clSetKernelArg(kernel, 4, sizeof(int), &N);
+		double genericTime = timeKernel(env.commandQueue, kernel, 1, global_work_size, NULL, NRUNS);
+		clReleaseKernel(kernel);
+
+	/*Step 9: Specialised kernel, program looked up per call.*/
+		char options[128];
+		sprintf(options, "-cl-std=CL2.0 -DM=%d -DN=%d -DT=int", M, N);
+		double specialTime = 0.0;
+		bool specialised = true;
+		for (int run = 0; run <= NRUNS && specialised; run++)
+		{
+			cl_program program = cache.get("Specialized_Kernel.cl", options);
+			if (program == NULL)
+			{
+				specialised = false;
+				break;
+			}
+			kernel = clCreateKernel(program, "GEMV_spec", NULL);
+			clSetKernelArgSVMPointer(kernel, 0, A);
+			clSetKernelArgSVMPointer(kernel, 1, x);
+			clSetKernelArgSVMPointer(kernel, 2, y2);
+			cl_event event;
+			clEnqueueNDRangeKernel(env.commandQueue, kernel, 1, NULL, global_work_size, NULL, 0, NULL, &event);
+			clWaitForEvents(1, &event);
+			if (run > 0)
+				specialTime += eventSeconds(event);
+			clReleaseEvent(event);
+			clReleaseKernel(kernel);
+		}
+		specialTime = specialised ? specialTime / NRUNS : genericTime;
+
+	/*Step 10: Same result from both.*/
+		bool correct = true;
+		if (specialised)
+		{
+			clEnqueueSVMMap(env.commandQueue, CL_TRUE, CL_MAP_READ, y1, M * sizeof(int), 0, NULL, NULL);
+			clEnqueueSVMMap(env.commandQueue, CL_TRUE, CL_MAP_READ, y2, M * sizeof(int), 0, NULL, NULL);
+			correct = memcmp(y1, y2, M * sizeof(int)) == 0;
+			clEnqueueSVMUnmap(env.commandQueue, y1, 0, NULL, NULL);
+			clEnqueueSVMUnmap(env.commandQueue, y2, 0, NULL, NULL);
+		}
+		if (!correct)
+			isSuccess = FAILURE;
+
+		char shape[32];
+		sprintf(shape, "%dx%d", M, N);
+		cout << setw(12) << shape << fixed << setprecision(2)
+		     << setw(14) << genericTime * 1e6 << setw(14) << specialTime * 1e6
+		     << setw(9) << genericTime / specialTime << "x"
+		     << (specialised ? "" : "  (build failed, generic fallback)")
+		     << (correct ? "" : "  MISMATCH") << endl;
+		cout.unsetf(ios::fixed);
+
+	/*Step 11: Clean the per-shape resources.*/
+		clFinish(env.commandQueue);
+		clSVMFree(env.context, A);
+		clSVMFree(env.context, x);
+		clSVMFree(env.context, y1);
+		clSVMFree(env.context, y2);
+	}
+
+	cout << "program cache: " << cache.misses() << " builds (" << cache.buildSeconds() << " s), "
+	     << cache.hits() << " hits" << endl;
+
+/*Step 12: Clean the resources.*/
+	clReleaseProgram(generic);
+	releaseCL(env);
+	return isSuccess;
+}
+
+SVM_BENCH_NAMESPACE_END
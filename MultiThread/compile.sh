@@ -0,0 +1,3 @@
+#!bin/bash
+
+  g++ -std=c++11 -O2 prog.cpp -lOpenCL -pthread -Wno-deprecated-declarations -o prog
\ No newline at end of file
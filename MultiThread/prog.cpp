@@ -0,0 +1,292 @@
+/**********************************************************************
+Concurrent host submission against one context.
+
+N host threads, each with its own command queue and kernel objects on a
+single shared context, submit a mix of vector_add (../VectorAdd) and
+GEMV_float (../GEMV) launches as fast as they complete. Two placements:
+	shared    all threads read the same SVM inputs and write their own
+	          slice of one shared SVM output allocation
+	private   every thread allocates and fills its own SVM inputs and
+	          outputs
+
+Each submission is timed twice: the API part (setArg + enqueue, where
+runtime and ICD locks show up as N grows) and the whole round trip to
+clFinish. Reported per N: throughput and its scaling against one thread,
+API time, and the round-trip percentiles.
+
+Usage: prog [max-threads [submissions-per-thread]]
+********************************************************************/
+
+#include <CL/cl.h>
+#include <string.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <iostream>
+#include <iomanip>
+#include <vector>
+#include <thread>
+#include <atomic>
+#include <chrono>
+
+#include "../common/CLSetup.hpp"
+#include "../common/Histogram.hpp"
+
+#define SUCCESS 0
+#define FAILURE 1
+
+using namespace std;
+
+int MaxThreads = 8;
+int Submissions = 500;
+
+const int VEC = 1 << 18;   // vector_add elements
+const int DIM = 256;       // GEMV_float is DIM x DIM
+
+enum Placement { SHARED, PRIVATE };
+const char *placementNames[] = { "shared", "private" };
+
+typedef chrono::steady_clock Clock;
+
+double nsSince(Clock::time_point start)
+{
+	return chrono::duration<double, nano>(Clock::now() - start).count();
+}
+
+/* The SVM arrays one thread works on; in the shared placement the inputs
+   (and the output allocations) are common to all threads. */
+struct Operands
+{
+	float *a, *b, *c;        // vector_add: c = a + b
+	float *A, *x, *y;        // GEMV_float: y = A x
+};
+
+/* fill through a map on the given queue (coarse-grained SVM) */
+void fillSVM(cl_command_queue queue, float *ptr, size_t count, float value)
+{
+	clEnqueueSVMMap(queue, CL_TRUE, CL_MAP_WRITE_INVALIDATE_REGION, ptr, count * sizeof(float), 0, NULL, NULL);
+	for (size_t i = 0; i < count; i++)
+		ptr[i] = value;
+	clEnqueueSVMUnmap(queue, ptr, 0, NULL, NULL);
+}
+
+int allocOperands(CLEnv &env, cl_command_queue queue, Operands &ops, int outputs)
+{
+	ops.a = (float *)clSVMAlloc(env.context, CL_MEM_READ_ONLY, VEC * sizeof(float), 0);
+	ops.b = (float *)clSVMAlloc(env.context, CL_MEM_READ_ONLY, VEC * sizeof(float), 0);
+	ops.c = (float *)clSVMAlloc(env.context, CL_MEM_WRITE_ONLY, (size_t)outputs * VEC * sizeof(float), 0);
+	ops.A = (float *)clSVMAlloc(env.context, CL_MEM_READ_ONLY, DIM * DIM * sizeof(float), 0);
+	ops.x = (float *)clSVMAlloc(env.context, CL_MEM_READ_ONLY, DIM * sizeof(float), 0);
+	ops.y = (float *)clSVMAlloc(env.context, CL_MEM_WRITE_ONLY, (size_t)outputs * DIM * sizeof(float), 0);
+	if (ops.a == NULL || ops.b == NULL || ops.c == NULL || ops.A == NULL || ops.x == NULL || ops.y == NULL)
+	{
+		cout << "Error: clSVMAlloc failed" << endl;
+		return FAILURE;
+	}
+	fillSVM(queue, ops.a, VEC, 1.0f);
+	fillSVM(queue, ops.b, VEC, 2.0f);
+	fillSVM(queue, ops.A, DIM * DIM, 1.0f);
+	fillSVM(queue, ops.x, DIM, 1.0f);
+	clFinish(queue);
+	return SUCCESS;
+}
+
+void freeOperands(CLEnv &env, Operands &ops)
+{
+	float *ptrs[] = { ops.a, ops.b, ops.c, ops.A, ops.x, ops.y };
+	for (int i = 0; i < 6; i++)
+		if (ptrs[i] != NULL)
+			clSVMFree(env.context, ptrs[i]);
+}
+
+struct ThreadResult
+{
+	vector<double> apiNs;
+	vector<double> roundTripNs;
+	bool correct;
+	int status;
+};
+
+/* One submitting thread: own queue and kernels, then Submissions
+   launches alternating vector_add and GEMV_float once go is set. */
+void submitter(CLEnv *env, cl_program program, Placement placement, const Operands *shared, int index,
+               atomic<int> *ready, atomic<bool> *go, ThreadResult *result)
+{
+	cl_int status;
+	cl_command_queue queue = clCreateCommandQueue(env->context, env->device(), 0, &status);
+	cl_kernel add = clCreateKernel(program, "vector_add", NULL);
+	cl_kernel gemv = clCreateKernel(program, "GEMV_float", NULL);
+
+	Operands own = Operands();
+	const Operands *ops = shared;
+	result->status = status == CL_SUCCESS ? SUCCESS : FAILURE;
+	result->correct = false;
+	if (placement == PRIVATE && result->status == SUCCESS)
+	{
+		result->status = allocOperands(*env, queue, own, 1);
+		ops = &own;
+	}
+	float *c = placement == PRIVATE ? own.c : shared->c + (size_t)index * VEC;
+	float *y = placement == PRIVATE ? own.y : shared->y + (size_t)index * DIM;
+
+	cl_uint n = VEC;
+	int dim = DIM;
+	size_t addGlobal[1] = { VEC };
+	size_t gemvGlobal[1] = { DIM };
+	result->apiNs.reserve(Submissions);
+	result->roundTripNs.reserve(Submissions);
+
+	ready->fetch_add(1);
+	while (!go->load())
+		this_thread::yield();
+
+	for (int s = 0; s < Submissions && result->status == SUCCESS; s++)
+	{
+		Clock::time_point start = Clock::now();
+		if (s % 2 == 0)
+		{
+			clSetKernelArgSVMPointer(add, 0, ops->a);
+			clSetKernelArgSVMPointer(add, 1, ops->b);
+			clSetKernelArgSVMPointer(add, 2, c);
+			clSetKernelArg(add, 3, sizeof(cl_uint), &n);
+			status = clEnqueueNDRangeKernel(queue, add, 1, NULL, addGlobal, NULL, 0, NULL, NULL);
+		}
+		else
+		{
+			clSetKernelArgSVMPointer(gemv, 0, ops->A);
+			clSetKernelArgSVMPointer(gemv, 1, ops->x);
+			clSetKernelArgSVMPointer(gemv, 2, y);
+			clSetKernelArg(gemv, 3, sizeof(int), &dim);
+			clSetKernelArg(gemv, 4, sizeof(int), &dim);
+			status = clEnqueueNDRangeKernel(queue, gemv, 1, NULL, gemvGlobal, NULL, 0, NULL, NULL);
+		}
+		result->apiNs.push_back(nsSince(start));
+		clFinish(queue);
+		result->roundTripNs.push_back(nsSince(start));
+		if (status != CL_SUCCESS)
+		{
+			cout << "Error: clEnqueueNDRangeKernel, status: " << status << endl;
+			result->status = FAILURE;
+		}
+	}
+
+/*Check this thread's outputs: a + b = 3, every row of A x = DIM.*/
+	if (result->status == SUCCESS)
+	{
+		clEnqueueSVMMap(queue, CL_TRUE, CL_MAP_READ, c, VEC * sizeof(float), 0, NULL, NULL);
+		clEnqueueSVMMap(queue, CL_TRUE, CL_MAP_READ, y, DIM * sizeof(float), 0, NULL, NULL);
+		result->correct = c[0] == 3.0f && c[VEC - 1] == 3.0f && y[0] == (float)DIM && y[DIM - 1] == (float)DIM;
+		clEnqueueSVMUnmap(queue, c, 0, NULL, NULL);
+		clEnqueueSVMUnmap(queue, y, 0, NULL, NULL);
+		clFinish(queue);
+	}
+
+	if (placement == PRIVATE)
+		freeOperands(*env, own);
+	clReleaseKernel(add);
+	clReleaseKernel(gemv);
+	clReleaseCommandQueue(queue);
+}
+
+
+int main(int argc, char* argv[])
+{
+	if (argc > 1)
+		MaxThreads = max(1, atoi(argv[1]));
+	if (argc > 2)
+		Submissions = atoi(argv[2]);
+
+/*Step 1-4: One context; every thread creates its own queue on it.*/
+	CLEnv env;
+	if (setupCL(env, 0) != SUCCESS)
+		return FAILURE;
+
+/*Step 5-6: One program with both kernels, shared by all threads.*/
+	const char *files[] = { "../VectorAdd/Kernel.cl", "../GEMV/Kernel.cl" };
+	cl_program program = buildProgramFromFiles(env, files, 2, "-cl-std=CL2.0");
+	if (program == NULL)
+		return FAILURE;
+
+	vector<int> counts;
+	for (int n = 1; n < MaxThreads; n *= 2)
+		counts.push_back(n);
+	counts.push_back(MaxThreads);
+
+	cout << "vector_add " << VEC << " elements / GEMV_float " << DIM << "x" << DIM
+	     << ", " << Submissions << " submissions per thread" << endl;
+	cout << setw(8) << "threads" << setw(12) << "launch/s" << setw(9) << "scaling"
+	     << setw(11) << "api mean" << setw(10) << "api p99"
+	     << setw(10) << "rt p50" << setw(10) << "rt p99" << setw(10) << "rt max" << "  (us)" << endl;
+
+	int isSuccess = SUCCESS;
+	for (int p = 0; p < 2; p++)
+	{
+		Placement placement = (Placement)p;
+		cout << placementNames[p] << ":" << endl;
+
+/*Step 7: Shared operands, sized for the largest thread count.*/
+		Operands shared = Operands();
+		if (placement == SHARED && allocOperands(env, env.commandQueue, shared, MaxThreads) != SUCCESS)
+			return FAILURE;
+
+		double baseline = 0.0;
+		for (size_t t = 0; t < counts.size(); t++)
+		{
+			int threads = counts[t];
+			vector<ThreadResult> results(threads);
+			vector<thread> workers;
+			atomic<int> ready(0);
+			atomic<bool> go(false);
+
+/*Step 8: Start all threads together once their queues exist.*/
+			for (int i = 0; i < threads; i++)
+				workers.push_back(thread(submitter, &env, program, placement, &shared, i, &ready, &go, &results[i]));
+			while (ready.load() < threads)
+				this_thread::yield();
+			Clock::time_point start = Clock::now();
+			go.store(true);
+			for (int i = 0; i < threads; i++)
+				workers[i].join();
+			double seconds = nsSince(start) * 1e-9;
+
+/*Step 9: Merge the per-thread samples.*/
+			LatencyHistogram api("api"), roundTrip("round trip");
+			bool correct = true;
+			size_t launches = 0;
+			for (int i = 0; i < threads; i++)
+			{
+				for (size_t s = 0; s < results[i].apiNs.size(); s++)
+				{
+					api.add(results[i].apiNs[s]);
+					roundTrip.add(results[i].roundTripNs[s]);
+				}
+				launches += results[i].apiNs.size();
+				correct = correct && results[i].correct;
+				if (results[i].status != SUCCESS)
+					isSuccess = FAILURE;
+			}
+
+			double rate = launches / seconds;
+			if (t == 0)
+				baseline = rate;
+			cout << fixed << setprecision(1)
+			     << setw(8) << threads << setw(12) << rate << setw(8) << setprecision(2) << rate / baseline << "x"
+			     << setprecision(1) << setw(11) << api.mean() * 1e-3 << setw(10) << api.percentile(99) * 1e-3
+			     << setw(10) << roundTrip.percentile(50) * 1e-3 << setw(10) << roundTrip.percentile(99) * 1e-3
+			     << setw(10) << roundTrip.max() * 1e-3 << (correct ? "" : "  MISMATCH") << endl;
+			cout.unsetf(ios::fixed);
+			if (!correct)
+				isSuccess = FAILURE;
+		}
+
+		if (placement == SHARED)
+			freeOperands(env, shared);
+	}
+
+/*Step 10: Clean the resources.*/
+	clReleaseProgram(program);
+	releaseCL(env);
+
+	if (isSuccess == SUCCESS)
+		std::cout << "\nPassed!\n";
+	return isSuccess;
+}
@@ -0,0 +1,36 @@
+// res = alpha * x + b as a producer/consumer pair connected by an OpenCL
+// 2.0 pipe instead of an intermediate array:
+//   scale_to_pipe   producer, the scale of av_cpu / VectorAdd's scale
+//   add_from_pipe   consumer, VectorAdd's vector_add
+// Pipes do not keep packet order across work-items, so every packet
+// carries the element index it belongs to. The host enqueues the pair
+// per chunk of at most the pipe's capacity, so the producer never finds
+// the pipe full and the consumer never finds it empty; a failed
+// write_pipe / read_pipe is counted in *failed.
+
+typedef struct {
+    uint index;
+    float value;
+} Packet;
+
+kernel void scale_to_pipe(__global const float *x, float alpha, uint offset, uint count,
+                          __write_only pipe Packet out, __global int *failed){
+    for ( uint i = get_global_id(0); i < count; i += get_global_size(0)) {
+        Packet p;
+        p.index = offset + i;
+        p.value = alpha * x[offset + i];
+        if (write_pipe(out, &p) != 0)
+            atomic_inc(failed);
+    }
+}
+
+kernel void add_from_pipe(__read_only pipe Packet in, __global const float *b, __global float *res,
+                          uint count, __global int *failed){
+    for ( uint i = get_global_id(0); i < count; i += get_global_size(0)) {
+        Packet p;
+        if (read_pipe(in, &p) == 0)
+            res[p.index] = p.value + b[p.index];
+        else
+            atomic_inc(failed);
+    }
+}
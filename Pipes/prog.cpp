@@ -0,0 +1,336 @@
+/**********************************************************************
+Producer/consumer kernel chaining through an OpenCL 2.0 pipe.
+
+res = alpha * x + b computed as a scale followed by a vector_add, three
+ways:
+	two-pass     scale into an SVM intermediate of all N elements, then
+	             vector_add from it (both from ../VectorAdd/Kernel.cl)
+	chunked SVM  the same two kernels chunk by chunk, through an SVM
+	             intermediate of one chunk
+	pipe         scale_to_pipe / add_from_pipe (Kernel.cl) chunk by
+	             chunk, through a pipe holding one chunk of packets
+
+Reported per variant and chunk size: total time, latency to the first
+finished results (start of the first producer to the end of the first
+consumer), the intermediate's size and its traffic (written once, read
+once) on top of the 12 bytes per element that x, b and res need. With
+SVM_PERF_COUNTERS=1 every run is also a phase of the counter report, so
+the cache misses can be set against that traffic model.
+
+Usage: prog [elements]
+********************************************************************/
+
+#include <CL/cl.h>
+#include <string.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <iostream>
+#include <iomanip>
+#include <string>
+#include <vector>
+#include <chrono>
+#include <algorithm>
+
+#include "../common/CLSetup.hpp"
+#include "../common/PerfCounters.hpp"
+
+#define SUCCESS 0
+#define FAILURE 1
+
+using namespace std;
+
+int Elements = 1 << 24;
+
+const int NRUNS = 5;
+const float ALPHA = 2.0f;
+const size_t MAX_GLOBAL = 1 << 20;   // the kernels are grid-stride loops
+
+enum Variant { TWO_PASS, CHUNKED_SVM, PIPE };
+const char *variantNames[] = { "two-pass", "chunked SVM", "pipe" };
+
+/* one pipe packet, as Packet in Kernel.cl */
+struct Packet
+{
+	cl_uint index;
+	cl_float value;
+};
+
+typedef chrono::steady_clock Clock;
+
+/* Kernels and operands shared by every variant. */
+struct Chain
+{
+	CLEnv *env;
+	cl_kernel scale, add;          // ../VectorAdd/Kernel.cl
+	cl_kernel produce, consume;    // Kernel.cl; NULL without pipe support
+	float *x, *b, *res;
+	int *failed;
+	cl_uint n;
+};
+
+struct ChainResult
+{
+	double seconds;         // whole chain, host wall clock
+	double firstSeconds;    // first producer start to first consumer end
+	size_t intermediateBytes;
+	double trafficBytes;    // intermediate written and read back
+	bool correct;
+};
+
+double eventSpan(cl_event first, cl_event last)
+{
+	cl_ulong start, end;
+	clGetEventProfilingInfo(first, CL_PROFILING_COMMAND_START, sizeof(cl_ulong), &start, NULL);
+	clGetEventProfilingInfo(last, CL_PROFILING_COMMAND_END, sizeof(cl_ulong), &end, NULL);
+	return (end - start) * 1e-9;
+}
+
+/* scale + vector_add over [offset, offset + count) through tmp */
+void enqueueTwoPass(Chain &c, float *tmp, cl_uint offset, cl_uint count, cl_event *first, cl_event *last)
+{
+	size_t global[1] = { min((size_t)count, MAX_GLOBAL) };
+	clSetKernelArgSVMPointer(c.scale, 0, tmp);
+	clSetKernelArgSVMPointer(c.scale, 1, c.x + offset);
+	clSetKernelArg(c.scale, 2, sizeof(float), &ALPHA);
+	clSetKernelArg(c.scale, 3, sizeof(cl_uint), &count);
+	clEnqueueNDRangeKernel(c.env->commandQueue, c.scale, 1, NULL, global, NULL, 0, NULL, first);
+
+	clSetKernelArgSVMPointer(c.add, 0, tmp);
+	clSetKernelArgSVMPointer(c.add, 1, c.b + offset);
+	clSetKernelArgSVMPointer(c.add, 2, c.res + offset);
+	clSetKernelArg(c.add, 3, sizeof(cl_uint), &count);
+	clEnqueueNDRangeKernel(c.env->commandQueue, c.add, 1, NULL, global, NULL, 0, NULL, last);
+}
+
+/* scale_to_pipe + add_from_pipe over [offset, offset + count); the pipe
+   arguments are set once by the caller */
+void enqueuePiped(Chain &c, cl_uint offset, cl_uint count, cl_event *first, cl_event *last)
+{
+	size_t global[1] = { min((size_t)count, MAX_GLOBAL) };
+	clSetKernelArg(c.produce, 2, sizeof(cl_uint), &offset);
+	clSetKernelArg(c.produce, 3, sizeof(cl_uint), &count);
+	clEnqueueNDRangeKernel(c.env->commandQueue, c.produce, 1, NULL, global, NULL, 0, NULL, first);
+
+	clSetKernelArg(c.consume, 3, sizeof(cl_uint), &count);
+	clEnqueueNDRangeKernel(c.env->commandQueue, c.consume, 1, NULL, global, NULL, 0, NULL, last);
+}
+
+/* Best of NRUNS (after one warm-up) of one variant; chunk is ignored for
+   TWO_PASS. The result is checked against x and b. */
+int runChain(Chain &c, Variant variant, cl_uint chunk, const vector<float> &x, const vector<float> &b, ChainResult &r)
+{
+	CLEnv &env = *c.env;
+	cl_uint step = variant == TWO_PASS ? c.n : chunk;
+	cl_int status = CL_SUCCESS;
+
+/*Intermediate: an SVM array of one step, or a pipe of one chunk.*/
+	float *tmp = NULL;
+	cl_mem pipe = NULL;
+	if (variant == PIPE)
+	{
+		pipe = clCreatePipe(env.context, CL_MEM_READ_WRITE | CL_MEM_HOST_NO_ACCESS, sizeof(Packet), chunk, NULL, &status);
+		if (status != CL_SUCCESS)
+		{
+			cout << "Error: clCreatePipe, status: " << status << endl;
+			return FAILURE;
+		}
+		clSetKernelArgSVMPointer(c.produce, 0, c.x);
+		clSetKernelArg(c.produce, 1, sizeof(float), &ALPHA);
+		clSetKernelArg(c.produce, 4, sizeof(cl_mem), &pipe);
+		clSetKernelArgSVMPointer(c.produce, 5, c.failed);
+		clSetKernelArg(c.consume, 0, sizeof(cl_mem), &pipe);
+		clSetKernelArgSVMPointer(c.consume, 1, c.b);
+		clSetKernelArgSVMPointer(c.consume, 2, c.res);
+		clSetKernelArgSVMPointer(c.consume, 4, c.failed);
+		r.intermediateBytes = (size_t)chunk * sizeof(Packet);
+		r.trafficBytes = 2.0 * c.n * sizeof(Packet);
+	}
+	else
+	{
+		tmp = (float *)clSVMAlloc(env.context, CL_MEM_READ_WRITE, (size_t)step * sizeof(float), 0);
+		if (tmp == NULL)
+		{
+			cout << "Error: clSVMAlloc failed" << endl;
+			return FAILURE;
+		}
+		r.intermediateBytes = (size_t)step * sizeof(float);
+		r.trafficBytes = 2.0 * c.n * sizeof(float);
+	}
+
+	for (int run = 0; run <= NRUNS; run++)
+	{
+		float zero = 0.0f;
+		int none = 0;
+		clEnqueueSVMMemFill(env.commandQueue, c.res, &zero, sizeof(zero), (size_t)c.n * sizeof(float), 0, NULL, NULL);
+		clEnqueueSVMMemFill(env.commandQueue, c.failed, &none, sizeof(none), sizeof(int), 0, NULL, NULL);
+		clFinish(env.commandQueue);
+
+		Clock::time_point start = Clock::now();
+		cl_event first = NULL, firstDone = NULL;
+		for (cl_uint offset = 0; offset < c.n; offset += step)
+		{
+			cl_uint count = min(step, c.n - offset);
+			bool head = offset == 0;
+			if (variant == PIPE)
+				enqueuePiped(c, offset, count, head ? &first : NULL, head ? &firstDone : NULL);
+			else
+				enqueueTwoPass(c, tmp, offset, count, head ? &first : NULL, head ? &firstDone : NULL);
+		}
+		clFinish(env.commandQueue);
+		double seconds = chrono::duration<double>(Clock::now() - start).count();
+		double firstSeconds = eventSpan(first, firstDone);
+		clReleaseEvent(first);
+		clReleaseEvent(firstDone);
+
+		if (run == 1 || (run > 1 && seconds < r.seconds))
+			r.seconds = seconds;
+		if (run == 1 || (run > 1 && firstSeconds < r.firstSeconds))
+			r.firstSeconds = firstSeconds;
+	}
+
+/*Check the last run.*/
+	clEnqueueSVMMap(env.commandQueue, CL_TRUE, CL_MAP_READ, c.res, (size_t)c.n * sizeof(float), 0, NULL, NULL);
+	clEnqueueSVMMap(env.commandQueue, CL_TRUE, CL_MAP_READ, c.failed, sizeof(int), 0, NULL, NULL);
+	r.correct = *c.failed == 0;
+	for (cl_uint i = 0; i < c.n && r.correct; i++)
+		r.correct = c.res[i] == ALPHA * x[i] + b[i];
+	clEnqueueSVMUnmap(env.commandQueue, c.res, 0, NULL, NULL);
+	clEnqueueSVMUnmap(env.commandQueue, c.failed, 0, NULL, NULL);
+	clFinish(env.commandQueue);
+
+	if (tmp != NULL)
+		clSVMFree(env.context, tmp);
+	if (pipe != NULL)
+		clReleaseMemObject(pipe);
+	return SUCCESS;
+}
+
+void printRow(Variant variant, cl_uint chunk, cl_uint n, const ChainResult &r)
+{
+	cout << setw(12) << variantNames[variant];
+	if (variant == TWO_PASS)
+		cout << setw(9) << "-";
+	else
+		cout << setw(9) << chunk;
+	cout << fixed << setprecision(3)
+	     << setw(11) << r.seconds * 1e3 << setw(11) << r.firstSeconds * 1e3
+	     << setprecision(2) << setw(9) << 12.0 * n / r.seconds * 1e-9
+	     << setprecision(1) << setw(12) << r.intermediateBytes / 1024.0 << setw(11) << r.trafficBytes / (1 << 20)
+	     << (r.correct ? "" : "  MISMATCH") << endl;
+	cout.unsetf(ios::fixed);
+}
+
+
+int main(int argc, char* argv[])
+{
+	PerfCounters::instance();  // SVM_PERF_COUNTERS=1: open before the runtime starts threads
+
+	if (argc > 1)
+		Elements = atoi(argv[1]);
+
+/*Step 1-4: Platform, device, context and command queue.*/
+	CLEnv env;
+	if (setupCL(env) != SUCCESS)
+		return FAILURE;
+
+/*Step 5-6: The two-pass kernels, and the pipe kernels if the device has pipes.*/
+	cl_program twoPass = buildProgramFromFile(env, "../VectorAdd/Kernel.cl", "-cl-std=CL2.0");
+	if (twoPass == NULL)
+		return FAILURE;
+	cl_program piped = buildProgramFromFile(env, "Kernel.cl", "-cl-std=CL2.0");
+	if (piped == NULL)
+		cout << "No pipe support: the pipe variant is skipped" << endl;
+
+/*Step 7: Kernels and SVM operands.*/
+	Chain c;
+	c.env = &env;
+	c.n = Elements;
+	c.scale = clCreateKernel(twoPass, "scale", NULL);
+	c.add = clCreateKernel(twoPass, "vector_add", NULL);
+	c.produce = piped != NULL ? clCreateKernel(piped, "scale_to_pipe", NULL) : NULL;
+	c.consume = piped != NULL ? clCreateKernel(piped, "add_from_pipe", NULL) : NULL;
+
+	size_t bytes = (size_t)c.n * sizeof(float);
+	c.x = (float *)clSVMAlloc(env.context, CL_MEM_READ_ONLY, bytes, 0);
+	c.b = (float *)clSVMAlloc(env.context, CL_MEM_READ_ONLY, bytes, 0);
+	c.res = (float *)clSVMAlloc(env.context, CL_MEM_READ_WRITE, bytes, 0);
+	c.failed = (int *)clSVMAlloc(env.context, CL_MEM_READ_WRITE, sizeof(int), 0);
+	if (c.x == NULL || c.b == NULL || c.res == NULL || c.failed == NULL)
+	{
+		cout << "Error: clSVMAlloc failed" << endl;
+		return FAILURE;
+	}
+
+	vector<float> x(c.n), b(c.n);
+	for (cl_uint i = 0; i < c.n; i++)
+	{
+		x[i] = (float)(i % 1000) * 0.25f;
+		b[i] = 1.0f;
+	}
+	clEnqueueSVMMap(env.commandQueue, CL_TRUE, CL_MAP_WRITE_INVALIDATE_REGION, c.x, bytes, 0, NULL, NULL);
+	clEnqueueSVMMap(env.commandQueue, CL_TRUE, CL_MAP_WRITE_INVALIDATE_REGION, c.b, bytes, 0, NULL, NULL);
+	memcpy(c.x, &x[0], bytes);
+	memcpy(c.b, &b[0], bytes);
+	clEnqueueSVMUnmap(env.commandQueue, c.x, 0, NULL, NULL);
+	clEnqueueSVMUnmap(env.commandQueue, c.b, 0, NULL, NULL);
+	clFinish(env.commandQueue);
+
+/*Step 8: Two-pass baseline, then both chunked variants per chunk size.*/
+	PhaseProfiler phases("Pipes");
+	cout << "res = " << ALPHA << " * x + b, " << c.n << " elements" << endl;
+	cout << setw(12) << "variant" << setw(9) << "chunk" << setw(11) << "total ms" << setw(11) << "first ms"
+	     << setw(9) << "GB/s" << setw(12) << "interm. KiB" << setw(11) << "interm. MB" << "  (traffic)" << endl;
+
+	int isSuccess = SUCCESS;
+	ChainResult r;
+	phases.next("two-pass", env.commandQueue);
+	if (runChain(c, TWO_PASS, c.n, x, b, r) != SUCCESS)
+		return FAILURE;
+	printRow(TWO_PASS, c.n, c.n, r);
+	if (!r.correct)
+		isSuccess = FAILURE;
+
+	const cl_uint chunks[] = { 1 << 14, 1 << 16, 1 << 18, 1 << 20 };
+	for (int k = 0; k < 4; k++)
+	{
+		if (chunks[k] >= c.n)
+			break;
+		for (int v = CHUNKED_SVM; v <= PIPE; v++)
+		{
+			Variant variant = (Variant)v;
+			if (variant == PIPE && piped == NULL)
+				continue;
+			phases.next((string(variantNames[v]) + " " + to_string(chunks[k])).c_str(), env.commandQueue);
+			if (runChain(c, variant, chunks[k], x, b, r) != SUCCESS)
+			{
+				isSuccess = FAILURE;
+				continue;
+			}
+			printRow(variant, chunks[k], c.n, r);
+			if (!r.correct)
+				isSuccess = FAILURE;
+		}
+	}
+	phases.end(env.commandQueue);
+	phases.report();
+
+/*Step 9: Clean the resources.*/
+	clSVMFree(env.context, c.x);
+	clSVMFree(env.context, c.b);
+	clSVMFree(env.context, c.res);
+	clSVMFree(env.context, c.failed);
+	clReleaseKernel(c.scale);
+	clReleaseKernel(c.add);
+	clReleaseProgram(twoPass);
+	if (piped != NULL)
+	{
+		clReleaseKernel(c.produce);
+		clReleaseKernel(c.consume);
+		clReleaseProgram(piped);
+	}
+	releaseCL(env);
+
+	if (isSuccess == SUCCESS)
+		std::cout << "\nPassed!\n";
+	return isSuccess;
+}
@@ -0,0 +1,89 @@
+// Structures.h is prepended by the host when the program is built.
+
+// ---- SVM: follow the host's pointers directly --------------------------
+
+__kernel void list_sum_svm( SVM_PTR(ListNode) __global const* heads,
+                            __global long* sums
+                            ) {
+
+  long sum = 0;
+  for (SVM_PTR(ListNode) node = heads[get_global_id(0)]; node != 0; node = node->next) {
+    sum += node->value;
+  }
+  sums[get_global_id(0)] = sum;
+}
+
+__kernel void tree_lookup_svm( SVM_PTR(TreeNode) root,
+                               const __global int* keys,
+                               __global int* results
+                               ) {
+
+  const int key = keys[get_global_id(0)];
+  SVM_PTR(TreeNode) node = root;
+  while (node != 0 && node->key != key) {
+    node = key < node->key ? node->left : node->right;
+  }
+  results[get_global_id(0)] = node != 0 ? node->value : -1;
+}
+
+__kernel void hash_lookup_svm( SVM_PTR(HashEntry) __global const* buckets,
+                               const uint numBuckets,
+                               const __global int* keys,
+                               __global int* results
+                               ) {
+
+  const int key = keys[get_global_id(0)];
+  SVM_PTR(HashEntry) entry = buckets[HASH_KEY(key, numBuckets)];
+  while (entry != 0 && entry->key != key) {
+    entry = entry->next;
+  }
+  results[get_global_id(0)] = entry != 0 ? entry->value : -1;
+}
+
+// ---- Flattened: the same structures as index arrays, -1 is null --------
+
+__kernel void list_sum_flat( const __global int* heads,
+                             const __global int* next,
+                             const __global int* value,
+                             __global long* sums
+                             ) {
+
+  long sum = 0;
+  for (int node = heads[get_global_id(0)]; node >= 0; node = next[node]) {
+    sum += value[node];
+  }
+  sums[get_global_id(0)] = sum;
+}
+
+__kernel void tree_lookup_flat( const __global int* left,
+                                const __global int* right,
+                                const __global int* nodeKey,
+                                const __global int* nodeValue,
+                                const __global int* keys,
+                                __global int* results
+                                ) {
+
+  const int key = keys[get_global_id(0)];
+  int node = 0;
+  while (node >= 0 && nodeKey[node] != key) {
+    node = key < nodeKey[node] ? left[node] : right[node];
+  }
+  results[get_global_id(0)] = node >= 0 ? nodeValue[node] : -1;
+}
+
+__kernel void hash_lookup_flat( const __global int* bucketHeads,
+                                const uint numBuckets,
+                                const __global int* next,
+                                const __global int* entryKey,
+                                const __global int* entryValue,
+                                const __global int* keys,
+                                __global int* results
+                                ) {
+
+  const int key = keys[get_global_id(0)];
+  int entry = bucketHeads[HASH_KEY(key, numBuckets)];
+  while (entry >= 0 && entryKey[entry] != key) {
+    entry = next[entry];
+  }
+  results[get_global_id(0)] = entry >= 0 ? entryValue[entry] : -1;
+}
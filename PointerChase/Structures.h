@@ -0,0 +1,36 @@
+/* Pointer-based structures shared by the host (prog.cpp) and the kernels.
+   The host builds them inside clSVMAlloc memory; Kernel.cl is compiled with
+   this file prepended, so both sides see the same layout. Requires a device
+   with 64-bit addresses (checked by the host). */
+
+#ifndef POINTER_CHASE_STRUCTURES_H
+#define POINTER_CHASE_STRUCTURES_H
+
+#ifdef __OPENCL_VERSION__
+#define SVM_PTR(T) __global T *
+#else
+#define SVM_PTR(T) T *
+#endif
+
+typedef struct ListNode {
+  SVM_PTR(struct ListNode) next;
+  int value;
+  int pad;
+} ListNode;
+
+typedef struct TreeNode {
+  SVM_PTR(struct TreeNode) left;
+  SVM_PTR(struct TreeNode) right;
+  int key;
+  int value;
+} TreeNode;
+
+typedef struct HashEntry {
+  SVM_PTR(struct HashEntry) next;
+  int key;
+  int value;
+} HashEntry;
+
+#define HASH_KEY(k, numBuckets) ((((unsigned int)(k)) * 2654435761u) % (numBuckets))
+
+#endif
@@ -0,0 +1,518 @@
+/**********************************************************************
+Pointer chasing through structures shared via SVM.
+
+Linked lists, a binary search tree and a chained hash table are built on
+the host directly inside clSVMAlloc memory, with ordinary pointers. The
+SVM arm hands them to the kernels as they are. The Non-SVM arm first has
+to flatten each structure into index-based arrays and upload those as
+cl_mem buffers; the flatten + upload time is exactly what SVM removes.
+
+Usage: prog
+********************************************************************/
+
+#include <CL/cl.h>
+#include <string.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <iostream>
+#include <iomanip>
+#include <string>
+#include <vector>
+#include <random>
+#include <algorithm>
+#include <chrono>
+
+#include "../common/CLSetup.hpp"
+#include "Structures.h"
+
+#define SUCCESS 0
+#define FAILURE 1
+
+using namespace std;
+
+const int NUM_LISTS = 4096;
+const int LIST_LENGTH = 256;
+const int TREE_NODES = 1 << 20;
+const int HASH_ENTRIES = 1 << 20;
+const unsigned int HASH_BUCKETS = 1 << 18;
+const int NUM_LOOKUPS = 1 << 20;
+
+typedef chrono::high_resolution_clock Clock;
+
+double secondsSince(Clock::time_point start)
+{
+	return chrono::duration<double>(Clock::now() - start).count();
+}
+
+/* Bump allocator over one coarse-grained SVM allocation. The region stays
+   mapped for host writes until unmap(); every pointer the kernels follow
+   lies inside it, so it is the only entry in CL_KERNEL_EXEC_INFO_SVM_PTRS. */
+struct SVMArena
+{
+	CLEnv *env;
+	char *base;
+	size_t size, used;
+
+	int create(CLEnv &e, size_t bytes)
+	{
+		env = &e;
+		size = bytes;
+		used = 0;
+		base = (char *)clSVMAlloc(env->context, CL_MEM_READ_WRITE, size, 0);
+		if (base == NULL)
+		{
+			cout << "Error: clSVMAlloc of " << size << " bytes failed" << endl;
+			return FAILURE;
+		}
+		clEnqueueSVMMap(env->commandQueue, CL_TRUE, CL_MAP_WRITE_INVALIDATE_REGION, base, size, 0, NULL, NULL);
+		return SUCCESS;
+	}
+
+	template <typename T>
+	T *alloc(size_t count)
+	{
+		used = (used + 15) & ~(size_t)15;
+		T *ptr = (T *)(base + used);
+		used += count * sizeof(T);
+		return used <= size ? ptr : NULL;
+	}
+
+	void unmap() { clEnqueueSVMUnmap(env->commandQueue, base, 0, NULL, NULL); }
+	void release() { clSVMFree(env->context, base); }
+};
+
+template <typename T>
+T *svmFromVector(CLEnv &env, const vector<T> &v)
+{
+	size_t bytes = v.size() * sizeof(T);
+	T *ptr = (T *)clSVMAlloc(env.context, CL_MEM_READ_WRITE, bytes, 0);
+	clEnqueueSVMMap(env.commandQueue, CL_TRUE, CL_MAP_WRITE_INVALIDATE_REGION, ptr, bytes, 0, NULL, NULL);
+	memcpy(ptr, &v[0], bytes);
+	clEnqueueSVMUnmap(env.commandQueue, ptr, 0, NULL, NULL);
+	return ptr;
+}
+
+template <typename T>
+cl_mem bufferFromVector(CLEnv &env, const vector<T> &v)
+{
+	return clCreateBuffer(env.context, CL_MEM_READ_ONLY | CL_MEM_COPY_HOST_PTR,
+	                      v.size() * sizeof(T), (void *)&v[0], NULL);
+}
+
+/* Enqueue a 1-D kernel, wait, return its device time in seconds. */
+double runKernel(CLEnv &env, cl_kernel kernel, size_t global)
+{
+	cl_event event;
+	clEnqueueNDRangeKernel(env.commandQueue, kernel, 1, NULL, &global, NULL, 0, NULL, &event);
+	clWaitForEvents(1, &event);
+	cl_ulong start, end;
+	clGetEventProfilingInfo(event, CL_PROFILING_COMMAND_START, sizeof(cl_ulong), &start, NULL);
+	clGetEventProfilingInfo(event, CL_PROFILING_COMMAND_END, sizeof(cl_ulong), &end, NULL);
+	clReleaseEvent(event);
+	return (end - start) * 1e-9;
+}
+
+struct Timing
+{
+	double flatten, upload, kernel, total;
+	bool correct;
+};
+
+void printTiming(const char *structure, const char *mode, const Timing &t)
+{
+	cout << setw(6) << structure << "  " << setw(8) << mode
+	     << "  flatten " << setw(9) << t.flatten * 1e3 << " ms"
+	     << "  upload " << setw(9) << t.upload * 1e3 << " ms"
+	     << "  kernel " << setw(9) << t.kernel * 1e3 << " ms"
+	     << "  end-to-end " << setw(9) << t.total * 1e3 << " ms"
+	     << (t.correct ? "" : "  MISMATCH") << endl;
+}
+
+/* Lookup keys: half of them present (even keys), half missing (odd keys). */
+vector<int> makeLookupKeys(int maxKey, mt19937 &rng)
+{
+	vector<int> keys(NUM_LOOKUPS);
+	uniform_int_distribution<int> dist(0, maxKey - 1);
+	for (int i = 0; i < NUM_LOOKUPS; i++)
+		keys[i] = dist(rng);
+	return keys;
+}
+
+
+int list_benchmark(CLEnv &env, cl_program program)
+{
+	mt19937 rng(1);
+	int totalNodes = NUM_LISTS * LIST_LENGTH;
+
+/*Step 1: Build the lists in SVM, nodes scattered in random order.*/
+	SVMArena arena;
+	if (arena.create(env, NUM_LISTS * sizeof(ListNode *) + totalNodes * sizeof(ListNode) + 64) != SUCCESS)
+		return FAILURE;
+	ListNode **heads = arena.alloc<ListNode *>(NUM_LISTS);
+	ListNode *nodes = arena.alloc<ListNode>(totalNodes);
+
+	vector<int> order(totalNodes);
+	for (int i = 0; i < totalNodes; i++)
+		order[i] = i;
+	shuffle(order.begin(), order.end(), rng);
+
+	vector<int64_t> reference(NUM_LISTS, 0);
+	for (int l = 0; l < NUM_LISTS; l++)
+	{
+		ListNode *prev = NULL;
+		for (int k = LIST_LENGTH - 1; k >= 0; k--)
+		{
+			ListNode *node = &nodes[order[l * LIST_LENGTH + k]];
+			node->value = l + k;
+			node->next = prev;
+			prev = node;
+			reference[l] += node->value;
+		}
+		heads[l] = prev;
+	}
+
+	cl_kernel flatKernel = clCreateKernel(program, "list_sum_flat", NULL);
+	cl_kernel svmKernel = clCreateKernel(program, "list_sum_svm", NULL);
+
+/*Step 2: Non-SVM: flatten to index arrays, upload, run.*/
+	Timing flat;
+	Clock::time_point start = Clock::now();
+	vector<int> fheads(NUM_LISTS), fnext, fvalue;
+	fnext.reserve(totalNodes);
+	fvalue.reserve(totalNodes);
+	for (int l = 0; l < NUM_LISTS; l++)
+	{
+		fheads[l] = heads[l] ? (int)fnext.size() : -1;
+		for (ListNode *node = heads[l]; node != NULL; node = node->next)
+		{
+			fvalue.push_back(node->value);
+			fnext.push_back(node->next ? (int)fnext.size() + 1 : -1);
+		}
+	}
+	flat.flatten = secondsSince(start);
+
+	Clock::time_point upload = Clock::now();
+	cl_mem Buffer_heads = bufferFromVector(env, fheads);
+	cl_mem Buffer_next = bufferFromVector(env, fnext);
+	cl_mem Buffer_value = bufferFromVector(env, fvalue);
+	cl_mem Buffer_sums = clCreateBuffer(env.context, CL_MEM_WRITE_ONLY, NUM_LISTS * sizeof(cl_long), NULL, NULL);
+	clFinish(env.commandQueue);
+	flat.upload = secondsSince(upload);
+
+	clSetKernelArg(flatKernel, 0, sizeof(cl_mem), &Buffer_heads);
+	clSetKernelArg(flatKernel, 1, sizeof(cl_mem), &Buffer_next);
+	clSetKernelArg(flatKernel, 2, sizeof(cl_mem), &Buffer_value);
+	clSetKernelArg(flatKernel, 3, sizeof(cl_mem), &Buffer_sums);
+	flat.kernel = runKernel(env, flatKernel, NUM_LISTS);
+
+	vector<int64_t> sums(NUM_LISTS);
+	clEnqueueReadBuffer(env.commandQueue, Buffer_sums, CL_TRUE, 0, NUM_LISTS * sizeof(cl_long), &sums[0], 0, NULL, NULL);
+	flat.total = secondsSince(start);
+	flat.correct = sums == reference;
+	clReleaseKernel(flatKernel);
+	clReleaseMemObject(Buffer_heads);
+	clReleaseMemObject(Buffer_next);
+	clReleaseMemObject(Buffer_value);
+	clReleaseMemObject(Buffer_sums);
+
+/*Step 3: SVM: hand over the pointers as they are.*/
+	Timing svm = { 0.0, 0.0, 0.0, 0.0, false };
+	start = Clock::now();
+	arena.unmap();
+	int64_t *svmSums = (int64_t *)clSVMAlloc(env.context, CL_MEM_READ_WRITE, NUM_LISTS * sizeof(int64_t), 0);
+	clSetKernelExecInfo(svmKernel, CL_KERNEL_EXEC_INFO_SVM_PTRS, sizeof(void *), &arena.base);
+	clSetKernelArgSVMPointer(svmKernel, 0, heads);
+	clSetKernelArgSVMPointer(svmKernel, 1, svmSums);
+	clFinish(env.commandQueue);
+	svm.upload = secondsSince(start);
+	svm.kernel = runKernel(env, svmKernel, NUM_LISTS);
+
+	clEnqueueSVMMap(env.commandQueue, CL_TRUE, CL_MAP_READ, svmSums, NUM_LISTS * sizeof(int64_t), 0, NULL, NULL);
+	svm.total = secondsSince(start);
+	svm.correct = equal(reference.begin(), reference.end(), svmSums);
+	clEnqueueSVMUnmap(env.commandQueue, svmSums, 0, NULL, NULL);
+	clFinish(env.commandQueue);
+
+	printTiming("list", "SVM", svm);
+	printTiming("list", "Non-SVM", flat);
+
+	clReleaseKernel(svmKernel);
+	clSVMFree(env.context, svmSums);
+	arena.release();
+	return svm.correct && flat.correct ? SUCCESS : FAILURE;
+}
+
+
+int tree_benchmark(CLEnv &env, cl_program program)
+{
+	mt19937 rng(2);
+
+/*Step 1: Build an (unbalanced) BST in SVM by inserting even keys in random order.*/
+	SVMArena arena;
+	if (arena.create(env, TREE_NODES * sizeof(TreeNode) + 64) != SUCCESS)
+		return FAILURE;
+
+	vector<int> insertKeys(TREE_NODES);
+	for (int i = 0; i < TREE_NODES; i++)
+		insertKeys[i] = 2 * i;
+	shuffle(insertKeys.begin(), insertKeys.end(), rng);
+
+	TreeNode *root = NULL;
+	for (int i = 0; i < TREE_NODES; i++)
+	{
+		TreeNode *node = arena.alloc<TreeNode>(1);
+		node->key = insertKeys[i];
+		node->value = insertKeys[i] * 3;
+		node->left = node->right = NULL;
+
+		TreeNode **link = &root;
+		while (*link != NULL)
+			link = node->key < (*link)->key ? &(*link)->left : &(*link)->right;
+		*link = node;
+	}
+
+	vector<int> keys = makeLookupKeys(2 * TREE_NODES, rng);
+	vector<int> reference(NUM_LOOKUPS);
+	for (int i = 0; i < NUM_LOOKUPS; i++)
+		reference[i] = keys[i] % 2 == 0 ? keys[i] * 3 : -1;
+
+	cl_kernel flatKernel = clCreateKernel(program, "tree_lookup_flat", NULL);
+	cl_kernel svmKernel = clCreateKernel(program, "tree_lookup_svm", NULL);
+
+/*Step 2: Non-SVM: flatten breadth-first (root is index 0), upload, run.*/
+	Timing flat;
+	Clock::time_point start = Clock::now();
+	vector<int> left(TREE_NODES), right(TREE_NODES), nodeKey(TREE_NODES), nodeValue(TREE_NODES);
+	vector<TreeNode *> queue(1, root);
+	queue.reserve(TREE_NODES);
+	for (size_t i = 0; i < queue.size(); i++)
+	{
+		TreeNode *node = queue[i];
+		nodeKey[i] = node->key;
+		nodeValue[i] = node->value;
+		left[i] = node->left ? (int)queue.size() : -1;
+		if (node->left)
+			queue.push_back(node->left);
+		right[i] = node->right ? (int)queue.size() : -1;
+		if (node->right)
+			queue.push_back(node->right);
+	}
+	flat.flatten = secondsSince(start);
+
+	Clock::time_point upload = Clock::now();
+	cl_mem Buffer_left = bufferFromVector(env, left);
+	cl_mem Buffer_right = bufferFromVector(env, right);
+	cl_mem Buffer_key = bufferFromVector(env, nodeKey);
+	cl_mem Buffer_value = bufferFromVector(env, nodeValue);
+	cl_mem Buffer_keys = bufferFromVector(env, keys);
+	cl_mem Buffer_results = clCreateBuffer(env.context, CL_MEM_WRITE_ONLY, NUM_LOOKUPS * sizeof(int), NULL, NULL);
+	clFinish(env.commandQueue);
+	flat.upload = secondsSince(upload);
+
+	clSetKernelArg(flatKernel, 0, sizeof(cl_mem), &Buffer_left);
+	clSetKernelArg(flatKernel, 1, sizeof(cl_mem), &Buffer_right);
+	clSetKernelArg(flatKernel, 2, sizeof(cl_mem), &Buffer_key);
+	clSetKernelArg(flatKernel, 3, sizeof(cl_mem), &Buffer_value);
+	clSetKernelArg(flatKernel, 4, sizeof(cl_mem), &Buffer_keys);
+	clSetKernelArg(flatKernel, 5, sizeof(cl_mem), &Buffer_results);
+	flat.kernel = runKernel(env, flatKernel, NUM_LOOKUPS);
+
+	vector<int> results(NUM_LOOKUPS);
+	clEnqueueReadBuffer(env.commandQueue, Buffer_results, CL_TRUE, 0, NUM_LOOKUPS * sizeof(int), &results[0], 0, NULL, NULL);
+	flat.total = secondsSince(start);
+	flat.correct = results == reference;
+	clReleaseKernel(flatKernel);
+	clReleaseMemObject(Buffer_left);
+	clReleaseMemObject(Buffer_right);
+	clReleaseMemObject(Buffer_key);
+	clReleaseMemObject(Buffer_value);
+	clReleaseMemObject(Buffer_keys);
+	clReleaseMemObject(Buffer_results);
+
+/*Step 3: SVM: hand over the root pointer.*/
+	Timing svm = { 0.0, 0.0, 0.0, 0.0, false };
+	start = Clock::now();
+	arena.unmap();
+	int *svmKeys = svmFromVector(env, keys);
+	int *svmResults = (int *)clSVMAlloc(env.context, CL_MEM_READ_WRITE, NUM_LOOKUPS * sizeof(int), 0);
+	clSetKernelExecInfo(svmKernel, CL_KERNEL_EXEC_INFO_SVM_PTRS, sizeof(void *), &arena.base);
+	clSetKernelArgSVMPointer(svmKernel, 0, root);
+	clSetKernelArgSVMPointer(svmKernel, 1, svmKeys);
+	clSetKernelArgSVMPointer(svmKernel, 2, svmResults);
+	clFinish(env.commandQueue);
+	svm.upload = secondsSince(start);
+	svm.kernel = runKernel(env, svmKernel, NUM_LOOKUPS);
+
+	clEnqueueSVMMap(env.commandQueue, CL_TRUE, CL_MAP_READ, svmResults, NUM_LOOKUPS * sizeof(int), 0, NULL, NULL);
+	svm.total = secondsSince(start);
+	svm.correct = equal(reference.begin(), reference.end(), svmResults);
+	clEnqueueSVMUnmap(env.commandQueue, svmResults, 0, NULL, NULL);
+	clFinish(env.commandQueue);
+
+	printTiming("tree", "SVM", svm);
+	printTiming("tree", "Non-SVM", flat);
+
+	clReleaseKernel(svmKernel);
+	clSVMFree(env.context, svmKeys);
+	clSVMFree(env.context, svmResults);
+	arena.release();
+	return svm.correct && flat.correct ? SUCCESS : FAILURE;
+}
+
+
+int hash_benchmark(CLEnv &env, cl_program program)
+{
+	mt19937 rng(3);
+
+/*Step 1: Build a chained hash table in SVM (even keys, head insertion).*/
+	SVMArena arena;
+	if (arena.create(env, HASH_BUCKETS * sizeof(HashEntry *) + HASH_ENTRIES * sizeof(HashEntry) + 64) != SUCCESS)
+		return FAILURE;
+	HashEntry **buckets = arena.alloc<HashEntry *>(HASH_BUCKETS);
+	HashEntry *entries = arena.alloc<HashEntry>(HASH_ENTRIES);
+	memset(buckets, 0, HASH_BUCKETS * sizeof(HashEntry *));
+
+	vector<int> insertKeys(HASH_ENTRIES);
+	for (int i = 0; i < HASH_ENTRIES; i++)
+		insertKeys[i] = 2 * i;
+	shuffle(insertKeys.begin(), insertKeys.end(), rng);
+
+	for (int i = 0; i < HASH_ENTRIES; i++)
+	{
+		HashEntry *entry = &entries[i];
+		unsigned int b = HASH_KEY(insertKeys[i], HASH_BUCKETS);
+		entry->key = insertKeys[i];
+		entry->value = insertKeys[i] * 3;
+		entry->next = buckets[b];
+		buckets[b] = entry;
+	}
+
+	vector<int> keys = makeLookupKeys(2 * HASH_ENTRIES, rng);
+	vector<int> reference(NUM_LOOKUPS);
+	for (int i = 0; i < NUM_LOOKUPS; i++)
+		reference[i] = keys[i] % 2 == 0 ? keys[i] * 3 : -1;
+
+	cl_kernel flatKernel = clCreateKernel(program, "hash_lookup_flat", NULL);
+	cl_kernel svmKernel = clCreateKernel(program, "hash_lookup_svm", NULL);
+
+/*Step 2: Non-SVM: flatten bucket by bucket, upload, run.*/
+	Timing flat;
+	Clock::time_point start = Clock::now();
+	vector<int> bucketHeads(HASH_BUCKETS), next, entryKey, entryValue;
+	next.reserve(HASH_ENTRIES);
+	entryKey.reserve(HASH_ENTRIES);
+	entryValue.reserve(HASH_ENTRIES);
+	for (unsigned int b = 0; b < HASH_BUCKETS; b++)
+	{
+		bucketHeads[b] = buckets[b] ? (int)next.size() : -1;
+		for (HashEntry *entry = buckets[b]; entry != NULL; entry = entry->next)
+		{
+			entryKey.push_back(entry->key);
+			entryValue.push_back(entry->value);
+			next.push_back(entry->next ? (int)next.size() + 1 : -1);
+		}
+	}
+	flat.flatten = secondsSince(start);
+
+	Clock::time_point upload = Clock::now();
+	cl_mem Buffer_heads = bufferFromVector(env, bucketHeads);
+	cl_mem Buffer_next = bufferFromVector(env, next);
+	cl_mem Buffer_key = bufferFromVector(env, entryKey);
+	cl_mem Buffer_value = bufferFromVector(env, entryValue);
+	cl_mem Buffer_keys = bufferFromVector(env, keys);
+	cl_mem Buffer_results = clCreateBuffer(env.context, CL_MEM_WRITE_ONLY, NUM_LOOKUPS * sizeof(int), NULL, NULL);
+	clFinish(env.commandQueue);
+	flat.upload = secondsSince(upload);
+
+	clSetKernelArg(flatKernel, 0, sizeof(cl_mem), &Buffer_heads);
+	clSetKernelArg(flatKernel, 1, sizeof(cl_uint), &HASH_BUCKETS);
+	clSetKernelArg(flatKernel, 2, sizeof(cl_mem), &Buffer_next);
+	clSetKernelArg(flatKernel, 3, sizeof(cl_mem), &Buffer_key);
+	clSetKernelArg(flatKernel, 4, sizeof(cl_mem), &Buffer_value);
+	clSetKernelArg(flatKernel, 5, sizeof(cl_mem), &Buffer_keys);
+	clSetKernelArg(flatKernel, 6, sizeof(cl_mem), &Buffer_results);
+	flat.kernel = runKernel(env, flatKernel, NUM_LOOKUPS);
+
+	vector<int> results(NUM_LOOKUPS);
+	clEnqueueReadBuffer(env.commandQueue, Buffer_results, CL_TRUE, 0, NUM_LOOKUPS * sizeof(int), &results[0], 0, NULL, NULL);
+	flat.total = secondsSince(start);
+	flat.correct = results == reference;
+	clReleaseKernel(flatKernel);
+	clReleaseMemObject(Buffer_heads);
+	clReleaseMemObject(Buffer_next);
+	clReleaseMemObject(Buffer_key);
+	clReleaseMemObject(Buffer_value);
+	clReleaseMemObject(Buffer_keys);
+	clReleaseMemObject(Buffer_results);
+
+/*Step 3: SVM: hand over the bucket array.*/
+	Timing svm = { 0.0, 0.0, 0.0, 0.0, false };
+	start = Clock::now();
+	arena.unmap();
+	int *svmKeys = svmFromVector(env, keys);
+	int *svmResults = (int *)clSVMAlloc(env.context, CL_MEM_READ_WRITE, NUM_LOOKUPS * sizeof(int), 0);
+	clSetKernelExecInfo(svmKernel, CL_KERNEL_EXEC_INFO_SVM_PTRS, sizeof(void *), &arena.base);
+	clSetKernelArgSVMPointer(svmKernel, 0, buckets);
+	clSetKernelArg(svmKernel, 1, sizeof(cl_uint), &HASH_BUCKETS);
+	clSetKernelArgSVMPointer(svmKernel, 2, svmKeys);
+	clSetKernelArgSVMPointer(svmKernel, 3, svmResults);
+	clFinish(env.commandQueue);
+	svm.upload = secondsSince(start);
+	svm.kernel = runKernel(env, svmKernel, NUM_LOOKUPS);
+
+	clEnqueueSVMMap(env.commandQueue, CL_TRUE, CL_MAP_READ, svmResults, NUM_LOOKUPS * sizeof(int), 0, NULL, NULL);
+	svm.total = secondsSince(start);
+	svm.correct = equal(reference.begin(), reference.end(), svmResults);
+	clEnqueueSVMUnmap(env.commandQueue, svmResults, 0, NULL, NULL);
+	clFinish(env.commandQueue);
+
+	printTiming("hash", "SVM", svm);
+	printTiming("hash", "Non-SVM", flat);
+
+	clReleaseKernel(svmKernel);
+	clSVMFree(env.context, svmKeys);
+	clSVMFree(env.context, svmResults);
+	arena.release();
+	return svm.correct && flat.correct ? SUCCESS : FAILURE;
+}
+
+
+int main()
+{
+	CLEnv env;
+	if (setupCL(env) != SUCCESS)
+		return FAILURE;
+
+	cl_uint addressBits = 0;
+	clGetDeviceInfo(env.device(), CL_DEVICE_ADDRESS_BITS, sizeof(addressBits), &addressBits, NULL);
+	if (addressBits != sizeof(void *) * 8)
+	{
+		cout << "Error: device pointers are " << addressBits << " bits, host pointers "
+		     << sizeof(void *) * 8 << "; structures cannot be shared" << endl;
+		releaseCL(env);
+		return FAILURE;
+	}
+
+	const char *files[] = { "Structures.h", "Kernel.cl" };
+	cl_program program = buildProgramFromFiles(env, files, 2, "-cl-std=CL2.0");
+	if (program == NULL)
+	{
+		releaseCL(env);
+		return FAILURE;
+	}
+
+	cout << fixed << setprecision(3);
+	cout << "SVM vs Non-SVM (flattened) \n------------------------------ " << endl;
+	int isSuccess = SUCCESS;
+	if (list_benchmark(env, program) != SUCCESS)
+		isSuccess = FAILURE;
+	if (tree_benchmark(env, program) != SUCCESS)
+		isSuccess = FAILURE;
+	if (hash_benchmark(env, program) != SUCCESS)
+		isSuccess = FAILURE;
+
+	clReleaseProgram(program);
+	releaseCL(env);
+	return isSuccess;
+}
@@ -0,0 +1,34 @@
+// ../GEMV/Kernel.cl is prepended by the host; y = A x uses GEMV_float.
+
+// Per-group partial sums of y[i]^2, grid-stride over M. The host adds the
+// get_num_groups(0) partials to get ||y||^2; local size is a power of two.
+__kernel void sum_squares( const __global float* y,
+                           __global float* partials,
+                           __local float* scratch,
+                           const int M
+                           ) {
+  const int lid = get_local_id(0);
+  float sum = 0.0f;
+  for (int i = get_global_id(0); i < M; i += get_global_size(0)) {
+    sum += y[i] * y[i];
+  }
+  scratch[lid] = sum;
+  barrier(CLK_LOCAL_MEM_FENCE);
+
+  for (int offset = get_local_size(0) / 2; offset > 0; offset /= 2) {
+    if (lid < offset)
+      scratch[lid] += scratch[lid + offset];
+    barrier(CLK_LOCAL_MEM_FENCE);
+  }
+  if (lid == 0)
+    partials[get_group_id(0)] = scratch[0];
+}
+
+// x = y * factor, factor = 1 / ||y|| computed on the host.
+__kernel void scale( const __global float* y,
+                     __global float* x,
+                     const float factor
+                     ) {
+  const int i = get_global_id(0);
+  x[i] = y[i] * factor;
+}
@@ -0,0 +1,293 @@
+/**********************************************************************
+Power iteration with the operands resident on the device.
+
+A (N x N), x and y are allocated and uploaded once; every iteration runs
+y = A x (GEMV_float from ../GEMV/Kernel.cl), a work-group sum of squares
+into a small partials array, and x = y / ||y||. The norm is finished on
+the host, so each iteration has one small device-to-host sync, done
+three ways:
+	coarse SVM   blocking clEnqueueSVMMap / clEnqueueSVMUnmap of the partials
+	fine SVM     CL_MEM_SVM_FINE_GRAIN_BUFFER, clFinish then a plain read
+	buffer       blocking clEnqueueReadBuffer of the partials
+
+Reported: one-off setup time, time per iteration, and the distribution
+of the sync step alone.
+
+Usage: prog [n [iterations]]
+********************************************************************/
+
+#include <CL/cl.h>
+#include <string.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <math.h>
+#include <iostream>
+#include <iomanip>
+#include <vector>
+#include <chrono>
+
+#include "../common/CLSetup.hpp"
+#include "../common/Histogram.hpp"
+
+#define SUCCESS 0
+#define FAILURE 1
+
+using namespace std;
+
+int Ndim = 2048;
+int Iterations = 200;
+
+const int LOCAL_SIZE = 128;
+const int NUM_GROUPS = 64;
+
+enum SyncMode { COARSE_SVM, FINE_SVM, BUFFER };
+const char *modeNames[] = { "coarse SVM", "fine SVM", "buffer" };
+
+typedef chrono::steady_clock Clock;
+
+double secondsSince(Clock::time_point start)
+{
+	return chrono::duration<double>(Clock::now() - start).count();
+}
+
+float matrixEntry(int i, int j)
+{
+	return 1.0f / (1 + abs(i - j));
+}
+
+/* Same iteration on the host, in double, for the reference eigenvalue. */
+double hostEigenvalue(int n, int iterations)
+{
+	vector<double> x(n, 1.0 / sqrt((double)n)), y(n);
+	double norm = 0.0;
+	for (int it = 0; it < iterations; it++)
+	{
+		norm = 0.0;
+		for (int i = 0; i < n; i++)
+		{
+			double sum = 0.0;
+			for (int j = 0; j < n; j++)
+				sum += matrixEntry(i, j) * x[j];
+			y[i] = sum;
+			norm += sum * sum;
+		}
+		norm = sqrt(norm);
+		for (int i = 0; i < n; i++)
+			x[i] = y[i] / norm;
+	}
+	return norm;
+}
+
+struct Result
+{
+	double setup;
+	double loop;
+	float eigenvalue;
+	LatencyHistogram sync;
+};
+
+
+int powerIteration(CLEnv &env, cl_program program, SyncMode mode, Result &result)
+{
+	int n = Ndim;
+	size_t bytesA = (size_t)n * n * sizeof(float);
+	size_t bytesV = n * sizeof(float);
+	size_t bytesP = NUM_GROUPS * sizeof(float);
+
+	Clock::time_point setupStart = Clock::now();
+
+/*Step 7: Allocate and upload A and x once.*/
+	vector<float> hostA(bytesA / sizeof(float));
+	for (int i = 0; i < n; i++)
+		for (int j = 0; j < n; j++)
+			hostA[(size_t)i * n + j] = matrixEntry(i, j);
+	vector<float> hostX(n, 1.0f / sqrtf((float)n));
+	vector<float> hostPartials(NUM_GROUPS);
+
+	float *A = NULL, *x = NULL, *y = NULL, *partials = NULL;
+	cl_mem bufA = NULL, bufX = NULL, bufY = NULL, bufPartials = NULL;
+
+	if (mode == BUFFER)
+	{
+		bufA = clCreateBuffer(env.context, CL_MEM_READ_ONLY | CL_MEM_COPY_HOST_PTR, bytesA, &hostA[0], NULL);
+		bufX = clCreateBuffer(env.context, CL_MEM_READ_WRITE | CL_MEM_COPY_HOST_PTR, bytesV, &hostX[0], NULL);
+		bufY = clCreateBuffer(env.context, CL_MEM_READ_WRITE, bytesV, NULL, NULL);
+		bufPartials = clCreateBuffer(env.context, CL_MEM_WRITE_ONLY, bytesP, NULL, NULL);
+	}
+	else
+	{
+		cl_svm_mem_flags flags = CL_MEM_READ_WRITE;
+		if (mode == FINE_SVM)
+			flags |= CL_MEM_SVM_FINE_GRAIN_BUFFER;
+		A = (float *)clSVMAlloc(env.context, flags, bytesA, 0);
+		x = (float *)clSVMAlloc(env.context, flags, bytesV, 0);
+		y = (float *)clSVMAlloc(env.context, flags, bytesV, 0);
+		partials = (float *)clSVMAlloc(env.context, flags, bytesP, 0);
+		if (A == NULL || x == NULL || y == NULL || partials == NULL)
+		{
+			cout << "Error: clSVMAlloc failed" << endl;
+			return FAILURE;
+		}
+
+		if (mode == COARSE_SVM)
+		{
+			clEnqueueSVMMap(env.commandQueue, CL_TRUE, CL_MAP_WRITE_INVALIDATE_REGION, A, bytesA, 0, NULL, NULL);
+			clEnqueueSVMMap(env.commandQueue, CL_TRUE, CL_MAP_WRITE_INVALIDATE_REGION, x, bytesV, 0, NULL, NULL);
+		}
+		memcpy(A, &hostA[0], bytesA);
+		memcpy(x, &hostX[0], bytesV);
+		if (mode == COARSE_SVM)
+		{
+			clEnqueueSVMUnmap(env.commandQueue, A, 0, NULL, NULL);
+			clEnqueueSVMUnmap(env.commandQueue, x, 0, NULL, NULL);
+		}
+	}
+
+/*Step 8: Kernel objects, bound once for the whole run.*/
+	cl_kernel gemv = clCreateKernel(program, "GEMV_float", NULL);
+	cl_kernel sumSquares = clCreateKernel(program, "sum_squares", NULL);
+	cl_kernel scale = clCreateKernel(program, "scale", NULL);
+	if (mode == BUFFER)
+	{
+		clSetKernelArg(gemv, 0, sizeof(cl_mem), &bufA);
+		clSetKernelArg(gemv, 1, sizeof(cl_mem), &bufX);
+		clSetKernelArg(gemv, 2, sizeof(cl_mem), &bufY);
+		clSetKernelArg(sumSquares, 0, sizeof(cl_mem), &bufY);
+		clSetKernelArg(sumSquares, 1, sizeof(cl_mem), &bufPartials);
+		clSetKernelArg(scale, 0, sizeof(cl_mem), &bufY);
+		clSetKernelArg(scale, 1, sizeof(cl_mem), &bufX);
+	}
+	else
+	{
+		clSetKernelArgSVMPointer(gemv, 0, A);
+		clSetKernelArgSVMPointer(gemv, 1, x);
+		clSetKernelArgSVMPointer(gemv, 2, y);
+		clSetKernelArgSVMPointer(sumSquares, 0, y);
+		clSetKernelArgSVMPointer(sumSquares, 1, partials);
+		clSetKernelArgSVMPointer(scale, 0, y);
+		clSetKernelArgSVMPointer(scale, 1, x);
+	}
+	clSetKernelArg(gemv, 3, sizeof(int), &n);
+	clSetKernelArg(gemv, 4, sizeof(int), &n);
+	clSetKernelArg(sumSquares, 2, LOCAL_SIZE * sizeof(float), NULL);
+	clSetKernelArg(sumSquares, 3, sizeof(int), &n);
+	clFinish(env.commandQueue);
+	result.setup = secondsSince(setupStart);
+
+/*Step 9: Iterate; the only host traffic is the partial sums.*/
+	size_t rows[1] = { (size_t)n };
+	size_t reduceGlobal[1] = { (size_t)NUM_GROUPS * LOCAL_SIZE };
+	size_t reduceLocal[1] = { (size_t)LOCAL_SIZE };
+	float norm = 0.0f;
+
+	Clock::time_point loopStart = Clock::now();
+	for (int it = 0; it < Iterations; it++)
+	{
+		clEnqueueNDRangeKernel(env.commandQueue, gemv, 1, NULL, rows, NULL, 0, NULL, NULL);
+		clEnqueueNDRangeKernel(env.commandQueue, sumSquares, 1, NULL, reduceGlobal, reduceLocal, 0, NULL, NULL);
+
+		Clock::time_point syncStart = Clock::now();
+		const float *p = partials;
+		if (mode == COARSE_SVM)
+			clEnqueueSVMMap(env.commandQueue, CL_TRUE, CL_MAP_READ, partials, bytesP, 0, NULL, NULL);
+		else if (mode == FINE_SVM)
+			clFinish(env.commandQueue);
+		else
+		{
+			clEnqueueReadBuffer(env.commandQueue, bufPartials, CL_TRUE, 0, bytesP, &hostPartials[0], 0, NULL, NULL);
+			p = &hostPartials[0];
+		}
+
+		double sum = 0.0;
+		for (int g = 0; g < NUM_GROUPS; g++)
+			sum += p[g];
+		if (mode == COARSE_SVM)
+			clEnqueueSVMUnmap(env.commandQueue, partials, 0, NULL, NULL);
+		result.sync.add(chrono::duration<double, nano>(Clock::now() - syncStart).count());
+
+		norm = (float)sqrt(sum);
+		float factor = 1.0f / norm;
+		clSetKernelArg(scale, 2, sizeof(float), &factor);
+		clEnqueueNDRangeKernel(env.commandQueue, scale, 1, NULL, rows, NULL, 0, NULL, NULL);
+	}
+	clFinish(env.commandQueue);
+	result.loop = secondsSince(loopStart);
+	result.eigenvalue = norm;
+
+/*Step 10: Clean the resources.*/
+	clReleaseKernel(gemv);
+	clReleaseKernel(sumSquares);
+	clReleaseKernel(scale);
+	if (mode == BUFFER)
+	{
+		clReleaseMemObject(bufA);
+		clReleaseMemObject(bufX);
+		clReleaseMemObject(bufY);
+		clReleaseMemObject(bufPartials);
+	}
+	else
+	{
+		clSVMFree(env.context, A);
+		clSVMFree(env.context, x);
+		clSVMFree(env.context, y);
+		clSVMFree(env.context, partials);
+	}
+	return SUCCESS;
+}
+
+
+int main(int argc, char* argv[])
+{
+	if (argc > 1)
+		Ndim = atoi(argv[1]);
+	if (argc > 2)
+		Iterations = atoi(argv[2]);
+
+/*Step1-4: Platform, device, context and command queue.*/
+	CLEnv env;
+	if (setupCL(env, 0) != SUCCESS)
+		return FAILURE;
+
+/*Step 5-6: Create and build program, GEMV kernels prepended. */
+	const char *files[] = { "../GEMV/Kernel.cl", "Kernel.cl" };
+	cl_program program = buildProgramFromFiles(env, files, 2, "-cl-std=CL2.0");
+	if (program == NULL)
+		return FAILURE;
+
+	cl_device_svm_capabilities caps = 0;
+	clGetDeviceInfo(env.device(), CL_DEVICE_SVM_CAPABILITIES, sizeof(caps), &caps, NULL);
+
+	double reference = hostEigenvalue(Ndim, Iterations);
+	cout << Ndim << "x" << Ndim << ", " << Iterations << " iterations, host eigenvalue " << reference << endl;
+	cout << fixed << setprecision(2);
+
+	int isSuccess = SUCCESS;
+	for (int m = COARSE_SVM; m <= BUFFER; m++)
+	{
+		SyncMode mode = (SyncMode)m;
+		if (mode == FINE_SVM && !(caps & CL_DEVICE_SVM_FINE_GRAIN_BUFFER))
+		{
+			cout << "\n" << modeNames[mode] << ": not supported by the device, skipped" << endl;
+			continue;
+		}
+
+		Result result;
+		result.sync = LatencyHistogram("sync");
+		if (powerIteration(env, program, mode, result) != SUCCESS)
+			return FAILURE;
+
+		double err = fabs(result.eigenvalue - reference) / reference;
+		cout << "\n" << modeNames[mode] << "\n------------------------------ " << endl;
+		cout << "setup " << result.setup * 1e3 << " ms, "
+		     << result.loop / Iterations * 1e6 << " us/iteration, eigenvalue "
+		     << setprecision(5) << result.eigenvalue << setprecision(2)
+		     << (err > 1e-3 ? "  MISMATCH" : "") << endl;
+		result.sync.print(cout);
+		if (err > 1e-3)
+			isSuccess = FAILURE;
+	}
+
+	clReleaseProgram(program);
+	releaseCL(env);
+	return isSuccess;
+}
@@ -0,0 +1,105 @@
+// Reductions over one array (sum, min, max, sum of squares for norms) or
+// two arrays (dot), specialised at build time:
+//   T                 element type (int, float, double; double needs USE_FP64)
+//   OP                OP_SUM, OP_MIN or OP_MAX
+//   MAP               MAP_IDENTITY (a[i]), MAP_SQUARE (a[i]^2), MAP_PRODUCT (a[i]*b[i])
+//   T_HIGHEST/LOWEST  identity elements for min/max
+//
+// Stage 1 (reduce_tree or reduce_builtin) leaves one partial per
+// work-group, stage 2 (reduce_final) folds the partials in one group.
+
+#ifdef USE_FP64
+#pragma OPENCL EXTENSION cl_khr_fp64 : enable
+#endif
+
+#define OP_SUM 0
+#define OP_MIN 1
+#define OP_MAX 2
+
+#define MAP_IDENTITY 0
+#define MAP_SQUARE   1
+#define MAP_PRODUCT  2
+
+#if OP == OP_SUM
+#define IDENTITY      ((T)0)
+#define COMBINE(x, y) ((x) + (y))
+#define WG_REDUCE     work_group_reduce_add
+#elif OP == OP_MIN
+#define IDENTITY      ((T)T_HIGHEST)
+#define COMBINE(x, y) min((x), (y))
+#define WG_REDUCE     work_group_reduce_min
+#else
+#define IDENTITY      ((T)T_LOWEST)
+#define COMBINE(x, y) max((x), (y))
+#define WG_REDUCE     work_group_reduce_max
+#endif
+
+#if MAP == MAP_PRODUCT
+#define LOAD(i) (a[i] * b[i])
+#elif MAP == MAP_SQUARE
+#define LOAD(i) (a[i] * a[i])
+#else
+#define LOAD(i) (a[i])
+#endif
+
+// Tree reduction of one value per work-item in local memory; local size
+// must be a power of two. Returns the group result in work-item 0.
+T group_tree_reduce(T acc, __local T* scratch) {
+  const int lid = get_local_id(0);
+  scratch[lid] = acc;
+  barrier(CLK_LOCAL_MEM_FENCE);
+
+  for (int offset = get_local_size(0) / 2; offset > 0; offset /= 2) {
+    if (lid < offset)
+      scratch[lid] = COMBINE(scratch[lid], scratch[lid + offset]);
+    barrier(CLK_LOCAL_MEM_FENCE);
+  }
+  return scratch[0];
+}
+
+__kernel void reduce_tree( const __global T* a,
+                           const __global T* b,
+                           __global T* partials,
+                           __local T* scratch,
+                           const int n
+                           ) {
+  T acc = IDENTITY;
+  for (int i = get_global_id(0); i < n; i += get_global_size(0)) {
+    acc = COMBINE(acc, LOAD(i));
+  }
+  acc = group_tree_reduce(acc, scratch);
+  if (get_local_id(0) == 0)
+    partials[get_group_id(0)] = acc;
+}
+
+#if __OPENCL_C_VERSION__ >= 200
+// Same, with the OpenCL 2.0 work-group collective in place of the tree.
+__kernel void reduce_builtin( const __global T* a,
+                              const __global T* b,
+                              __global T* partials,
+                              const int n
+                              ) {
+  T acc = IDENTITY;
+  for (int i = get_global_id(0); i < n; i += get_global_size(0)) {
+    acc = COMBINE(acc, LOAD(i));
+  }
+  acc = WG_REDUCE(acc);
+  if (get_local_id(0) == 0)
+    partials[get_group_id(0)] = acc;
+}
+#endif
+
+// Second pass: one work-group folds count partials into result[0].
+__kernel void reduce_final( const __global T* partials,
+                            __global T* result,
+                            __local T* scratch,
+                            const int count
+                            ) {
+  T acc = IDENTITY;
+  for (int i = get_local_id(0); i < count; i += get_local_size(0)) {
+    acc = COMBINE(acc, partials[i]);
+  }
+  acc = group_tree_reduce(acc, scratch);
+  if (get_local_id(0) == 0)
+    result[0] = acc;
+}
@@ -0,0 +1,383 @@
+/**********************************************************************
+Reductions: sum, dot, norm, min and max for int, float and double.
+
+Kernel.cl is built once per (type, operation) with -D options. Every
+reduction is two passes: stage 1 leaves one partial per work-group, using
+either a local-memory tree (reduce_tree) or the OpenCL 2.0 collective
+work_group_reduce_* (reduce_builtin), and reduce_final folds the partials
+in a single work-group. Inputs are resident in SVM or in cl_mem buffers;
+each timed reduction includes reading the one-element result back.
+
+The host baseline is an OpenMP SIMD loop (compile.sh adds -fopenmp-simd).
+
+Usage: prog [elements]
+********************************************************************/
+
+#include <CL/cl.h>
+#include <string.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <math.h>
+#include <iostream>
+#include <iomanip>
+#include <string>
+#include <vector>
+#include <chrono>
+
+#include "../common/CLSetup.hpp"
+
+#define SUCCESS 0
+#define FAILURE 1
+
+using namespace std;
+
+int Elements = 1 << 24;
+
+const int NRUNS = 20;
+const int NUM_GROUPS = 256;
+const int LOCAL_SIZE = 256;
+
+enum ReduceOp { SUM, DOT, NORM, MIN, MAX };
+const char *opNames[] = { "sum", "dot", "norm", "min", "max" };
+const char *opDefines[] = {
+	"-DOP=OP_SUM -DMAP=MAP_IDENTITY",
+	"-DOP=OP_SUM -DMAP=MAP_PRODUCT",
+	"-DOP=OP_SUM -DMAP=MAP_SQUARE",
+	"-DOP=OP_MIN -DMAP=MAP_IDENTITY",
+	"-DOP=OP_MAX -DMAP=MAP_IDENTITY" };
+
+enum Variant { TREE, BUILTIN };
+const char *variantNames[] = { "tree", "work_group_reduce" };
+
+enum Placement { SVM, BUFFER };
+const char *placementNames[] = { "SVM", "buffer" };
+
+typedef chrono::steady_clock Clock;
+
+double secondsSince(Clock::time_point start)
+{
+	return chrono::duration<double>(Clock::now() - start).count();
+}
+
+
+/* Per-type build options and input patterns (small values so int sums
+   and dots stay exact; one outlier so min/max are not trivial). */
+template <typename T> struct TypeInfo;
+
+template <> struct TypeInfo<int>
+{
+	static const char *name() { return "int"; }
+	static const char *defines() { return "-DT=int -DT_HIGHEST=INT_MAX -DT_LOWEST=INT_MIN"; }
+	static int scale() { return 1; }
+};
+
+template <> struct TypeInfo<float>
+{
+	static const char *name() { return "float"; }
+	static const char *defines() { return "-DT=float -DT_HIGHEST=INFINITY -DT_LOWEST=-INFINITY"; }
+	static float scale() { return 0.25f; }
+};
+
+template <> struct TypeInfo<double>
+{
+	static const char *name() { return "double"; }
+	static const char *defines() { return "-DT=double -DT_HIGHEST=INFINITY -DT_LOWEST=-INFINITY -DUSE_FP64"; }
+	static double scale() { return 0.25; }
+};
+
+template <typename T>
+void fillInputs(vector<T> &a, vector<T> &b)
+{
+	for (size_t i = 0; i < a.size(); i++)
+	{
+		a[i] = (T)((int)(i % 7) - 3) * TypeInfo<T>::scale();
+		b[i] = (T)((int)(i % 5) - 2) * TypeInfo<T>::scale();
+	}
+	a[a.size() / 3] = (T)-100 * TypeInfo<T>::scale();
+	a[a.size() / 2] = (T)100 * TypeInfo<T>::scale();
+}
+
+/* The raw reduction result (sum of squares for NORM) as double. */
+template <typename T>
+double finish(ReduceOp op, T raw)
+{
+	return op == NORM ? sqrt((double)raw) : (double)raw;
+}
+
+/* Host baseline, vectorised with OpenMP SIMD reductions. */
+template <typename T>
+T hostReduce(ReduceOp op, const T *a, const T *b, int n)
+{
+	T acc = 0;
+	switch (op)
+	{
+	case SUM:
+		#pragma omp simd reduction(+:acc)
+		for (int i = 0; i < n; i++)
+			acc += a[i];
+		break;
+	case DOT:
+		#pragma omp simd reduction(+:acc)
+		for (int i = 0; i < n; i++)
+			acc += a[i] * b[i];
+		break;
+	case NORM:
+		#pragma omp simd reduction(+:acc)
+		for (int i = 0; i < n; i++)
+			acc += a[i] * a[i];
+		break;
+	case MIN:
+		acc = a[0];
+		#pragma omp simd reduction(min:acc)
+		for (int i = 0; i < n; i++)
+			acc = a[i] < acc ? a[i] : acc;
+		break;
+	case MAX:
+		acc = a[0];
+		#pragma omp simd reduction(max:acc)
+		for (int i = 0; i < n; i++)
+			acc = a[i] > acc ? a[i] : acc;
+		break;
+	}
+	return acc;
+}
+
+/* Exact-enough reference: long double accumulation, serial. */
+template <typename T>
+double referenceReduce(ReduceOp op, const vector<T> &a, const vector<T> &b)
+{
+	long double acc = (op == MIN || op == MAX) ? a[0] : 0;
+	for (size_t i = 0; i < a.size(); i++)
+	{
+		if (op == SUM)
+			acc += a[i];
+		else if (op == DOT)
+			acc += (long double)a[i] * b[i];
+		else if (op == NORM)
+			acc += (long double)a[i] * a[i];
+		else if (op == MIN)
+			acc = a[i] < acc ? a[i] : acc;
+		else
+			acc = a[i] > acc ? a[i] : acc;
+	}
+	return op == NORM ? sqrt((double)acc) : (double)acc;
+}
+
+/* Relative tolerance: exact for int, rounding-order slack for floats. */
+template <typename T>
+bool matches(double got, double ref)
+{
+	double tol = TypeInfo<T>::scale() == 1 ? 0.0 : (sizeof(T) == 4 ? 1e-4 : 1e-10);
+	return fabs(got - ref) <= tol * (fabs(ref) + 1.0);
+}
+
+size_t largestPowerOfTwo(size_t limit)
+{
+	size_t p = 1;
+	while (p * 2 <= limit)
+		p *= 2;
+	return p;
+}
+
+
+/* Time NRUNS device reductions of resident data; returns seconds per
+   reduction and the raw result in *result. */
+template <typename T>
+double deviceReduce(CLEnv &env, cl_program program, Variant variant, Placement placement,
+                    const vector<T> &a, const vector<T> &b, T *result)
+{
+	int n = (int)a.size();
+	size_t bytes = n * sizeof(T);
+
+	cl_kernel stage1 = clCreateKernel(program, variant == TREE ? "reduce_tree" : "reduce_builtin", NULL);
+	cl_kernel stage2 = clCreateKernel(program, "reduce_final", NULL);
+
+	size_t maxLocal = LOCAL_SIZE;
+	clGetKernelWorkGroupInfo(stage1, env.device(), CL_KERNEL_WORK_GROUP_SIZE, sizeof(maxLocal), &maxLocal, NULL);
+	size_t local[1] = { largestPowerOfTwo(maxLocal < (size_t)LOCAL_SIZE ? maxLocal : LOCAL_SIZE) };
+	size_t global[1] = { NUM_GROUPS * local[0] };
+	int numGroups = NUM_GROUPS;
+
+	T *svmA = NULL, *svmB = NULL, *svmPartials = NULL, *svmResult = NULL;
+	cl_mem bufA = NULL, bufB = NULL, bufPartials = NULL, bufResult = NULL;
+
+/*Step 7: Place the inputs once.*/
+	if (placement == SVM)
+	{
+		svmA = (T *)clSVMAlloc(env.context, CL_MEM_READ_ONLY, bytes, 0);
+		svmB = (T *)clSVMAlloc(env.context, CL_MEM_READ_ONLY, bytes, 0);
+		svmPartials = (T *)clSVMAlloc(env.context, CL_MEM_READ_WRITE, NUM_GROUPS * sizeof(T), 0);
+		svmResult = (T *)clSVMAlloc(env.context, CL_MEM_READ_WRITE, sizeof(T), 0);
+		clEnqueueSVMMemcpy(env.commandQueue, CL_FALSE, svmA, &a[0], bytes, 0, NULL, NULL);
+		clEnqueueSVMMemcpy(env.commandQueue, CL_TRUE, svmB, &b[0], bytes, 0, NULL, NULL);
+
+		clSetKernelArgSVMPointer(stage1, 0, svmA);
+		clSetKernelArgSVMPointer(stage1, 1, svmB);
+		clSetKernelArgSVMPointer(stage1, 2, svmPartials);
+		clSetKernelArgSVMPointer(stage2, 0, svmPartials);
+		clSetKernelArgSVMPointer(stage2, 1, svmResult);
+	}
+	else
+	{
+		bufA = clCreateBuffer(env.context, CL_MEM_READ_ONLY | CL_MEM_COPY_HOST_PTR, bytes, (void *)&a[0], NULL);
+		bufB = clCreateBuffer(env.context, CL_MEM_READ_ONLY | CL_MEM_COPY_HOST_PTR, bytes, (void *)&b[0], NULL);
+		bufPartials = clCreateBuffer(env.context, CL_MEM_READ_WRITE, NUM_GROUPS * sizeof(T), NULL, NULL);
+		bufResult = clCreateBuffer(env.context, CL_MEM_WRITE_ONLY, sizeof(T), NULL, NULL);
+
+		clSetKernelArg(stage1, 0, sizeof(cl_mem), &bufA);
+		clSetKernelArg(stage1, 1, sizeof(cl_mem), &bufB);
+		clSetKernelArg(stage1, 2, sizeof(cl_mem), &bufPartials);
+		clSetKernelArg(stage2, 0, sizeof(cl_mem), &bufPartials);
+		clSetKernelArg(stage2, 1, sizeof(cl_mem), &bufResult);
+	}
+
+/*Step 8: Remaining arguments.*/
+	if (variant == TREE)
+	{
+		clSetKernelArg(stage1, 3, local[0] * sizeof(T), NULL);
+		clSetKernelArg(stage1, 4, sizeof(int), &n);
+	}
+	else
+		clSetKernelArg(stage1, 3, sizeof(int), &n);
+	clSetKernelArg(stage2, 2, local[0] * sizeof(T), NULL);
+	clSetKernelArg(stage2, 3, sizeof(int), &numGroups);
+	clFinish(env.commandQueue);
+
+/*Step 9: Reduce, first run untimed.*/
+	double seconds = 0.0;
+	for (int run = 0; run <= NRUNS; run++)
+	{
+		Clock::time_point start = Clock::now();
+		clEnqueueNDRangeKernel(env.commandQueue, stage1, 1, NULL, global, local, 0, NULL, NULL);
+		clEnqueueNDRangeKernel(env.commandQueue, stage2, 1, NULL, local, local, 0, NULL, NULL);
+		if (placement == SVM)
+		{
+			clEnqueueSVMMap(env.commandQueue, CL_TRUE, CL_MAP_READ, svmResult, sizeof(T), 0, NULL, NULL);
+			*result = *svmResult;
+			clEnqueueSVMUnmap(env.commandQueue, svmResult, 0, NULL, NULL);
+		}
+		else
+			clEnqueueReadBuffer(env.commandQueue, bufResult, CL_TRUE, 0, sizeof(T), result, 0, NULL, NULL);
+		if (run > 0)
+			seconds += secondsSince(start);
+	}
+	clFinish(env.commandQueue);
+
+/*Step 10: Clean the resources.*/
+	clReleaseKernel(stage1);
+	clReleaseKernel(stage2);
+	if (placement == SVM)
+	{
+		clSVMFree(env.context, svmA);
+		clSVMFree(env.context, svmB);
+		clSVMFree(env.context, svmPartials);
+		clSVMFree(env.context, svmResult);
+	}
+	else
+	{
+		clReleaseMemObject(bufA);
+		clReleaseMemObject(bufB);
+		clReleaseMemObject(bufPartials);
+		clReleaseMemObject(bufResult);
+	}
+	return seconds / NRUNS;
+}
+
+
+void printRow(const char *type, ReduceOp op, const char *how, double seconds, size_t bytes, double value, bool correct)
+{
+	cout << setw(7) << type << setw(6) << opNames[op] << "  " << setw(26) << left << how << right
+	     << setw(10) << seconds * 1e6 << " us" << setw(9) << bytes / seconds * 1e-9 << " GB/s"
+	     << "  " << value << (correct ? "" : "  MISMATCH") << endl;
+}
+
+template <typename T>
+int benchmarkType(CLEnv &env)
+{
+	vector<T> a(Elements), b(Elements);
+	fillInputs(a, b);
+	int isSuccess = SUCCESS;
+
+	for (int o = SUM; o <= MAX; o++)
+	{
+		ReduceOp op = (ReduceOp)o;
+		size_t bytes = (op == DOT ? 2 : 1) * a.size() * sizeof(T);
+		double ref = referenceReduce(op, a, b);
+
+		T value = hostReduce(op, &a[0], &b[0], Elements);
+		Clock::time_point start = Clock::now();
+		for (int run = 0; run < NRUNS; run++)
+			value = hostReduce(op, &a[0], &b[0], Elements);
+		double hostSeconds = secondsSince(start) / NRUNS;
+		bool correct = matches<T>(finish(op, value), ref);
+		printRow(TypeInfo<T>::name(), op, "host SIMD", hostSeconds, bytes, finish(op, value), correct);
+		if (!correct)
+			isSuccess = FAILURE;
+
+	/*Step 5-6: Build the (type, operation) specialisation.*/
+		string options = string("-cl-std=CL2.0 ") + TypeInfo<T>::defines() + " " + opDefines[op];
+		cl_program program = buildProgramFromFile(env, "Kernel.cl", options.c_str());
+		if (program == NULL)
+			return FAILURE;
+
+		cl_kernel probe = clCreateKernel(program, "reduce_builtin", NULL);
+		bool hasBuiltin = probe != NULL;
+		if (hasBuiltin)
+			clReleaseKernel(probe);
+
+		for (int v = TREE; v <= BUILTIN; v++)
+		{
+			if (v == BUILTIN && !hasBuiltin)
+				continue;
+			for (int p = SVM; p <= BUFFER; p++)
+			{
+				T raw;
+				double seconds = deviceReduce(env, program, (Variant)v, (Placement)p, a, b, &raw);
+				string how = string(variantNames[v]) + ", " + placementNames[p];
+				correct = matches<T>(finish(op, raw), ref);
+				printRow(TypeInfo<T>::name(), op, how.c_str(), seconds, bytes, finish(op, raw), correct);
+				if (!correct)
+					isSuccess = FAILURE;
+			}
+		}
+		clReleaseProgram(program);
+	}
+	return isSuccess;
+}
+
+
+int main(int argc, char* argv[])
+{
+	if (argc > 1)
+		Elements = atoi(argv[1]);
+
+/*Step1-4: Platform, device, context and command queue.*/
+	CLEnv env;
+	if (setupCL(env, 0) != SUCCESS)
+		return FAILURE;
+
+	size_t extSize = 0;
+	clGetDeviceInfo(env.device(), CL_DEVICE_EXTENSIONS, 0, NULL, &extSize);
+	string extensions(extSize, '\0');
+	clGetDeviceInfo(env.device(), CL_DEVICE_EXTENSIONS, extSize, &extensions[0], NULL);
+	bool hasFp64 = extensions.find("cl_khr_fp64") != string::npos;
+
+	cout << Elements << " elements, " << NUM_GROUPS << " work-groups, " << NRUNS << " runs" << endl;
+	cout << fixed << setprecision(2);
+
+	int isSuccess = SUCCESS;
+	if (benchmarkType<int>(env) != SUCCESS)
+		isSuccess = FAILURE;
+	if (benchmarkType<float>(env) != SUCCESS)
+		isSuccess = FAILURE;
+	if (hasFp64)
+	{
+		if (benchmarkType<double>(env) != SUCCESS)
+			isSuccess = FAILURE;
+	}
+	else
+		cout << "Device has no cl_khr_fp64; double skipped." << endl;
+
+	releaseCL(env);
+	return isSuccess;
+}
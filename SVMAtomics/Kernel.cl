@@ -0,0 +1,45 @@
+// Ring.h is prepended by the host when the program is built.
+
+#define SVM_LOAD(p)      atomic_load_explicit((p), memory_order_acquire, memory_scope_all_svm_devices)
+#define SVM_STORE(p, v)  atomic_store_explicit((p), (v), memory_order_release, memory_scope_all_svm_devices)
+
+// Persistent consumer: launched once as a single work-item, it drains the
+// request ring filled by host threads and pushes results to the response
+// ring until the host raises *stop and no request is left.
+__kernel void persistent_consumer( __global Cell* requests,
+                                   __global Cell* responses,
+                                   __global atomic_int* stop
+                                   ) {
+
+  int head = 0;         // next request position (single consumer)
+  int respTail = 0;     // next response position (single producer)
+
+  for (;;) {
+    __global Cell* cell = &requests[head & RING_MASK];
+
+    if (SVM_LOAD(&cell->seq) == head + 1) {
+      int id = cell->id;
+      int value = PROCESS(cell->value);
+      SVM_STORE(&cell->seq, head + RING_CAPACITY);
+      head++;
+
+      __global Cell* out = &responses[respTail & RING_MASK];
+      while (SVM_LOAD(&out->seq) != respTail) {
+        if (SVM_LOAD(stop))
+          return;
+      }
+      out->id = id;
+      out->value = value;
+      SVM_STORE(&out->seq, respTail + 1);
+      respTail++;
+    }
+    else if (SVM_LOAD(stop)) {
+      return;
+    }
+  }
+}
+
+// Baseline: one enqueue per request.
+__kernel void process_one( __global Cell* cell ) {
+  cell->value = PROCESS(cell->value);
+}
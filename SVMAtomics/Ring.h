@@ -0,0 +1,32 @@
+/* Ring buffer layout shared by the host (prog.cpp) and Kernel.cl, which is
+   compiled with this file prepended. Lives in fine-grained SVM allocated
+   with CL_MEM_SVM_ATOMICS.
+
+   Each cell carries a sequence number (bounded MPMC queue after D. Vyukov):
+   a cell at position pos is free for the producer when seq == pos, holds an
+   item for the consumer when seq == pos + 1, and is handed back by storing
+   seq = pos + RING_CAPACITY. id/value are plain fields ordered by the
+   release/acquire on seq. */
+
+#ifndef SVM_ATOMICS_RING_H
+#define SVM_ATOMICS_RING_H
+
+#define RING_CAPACITY 1024            // power of two
+#define RING_MASK (RING_CAPACITY - 1)
+
+#ifdef __OPENCL_VERSION__
+#define SVM_ATOMIC_INT atomic_int
+#else
+#define SVM_ATOMIC_INT int            // accessed with __atomic builtins on the host
+#endif
+
+typedef struct Cell {
+  SVM_ATOMIC_INT seq;
+  int id;
+  int value;
+} Cell;
+
+// The work each request stands for; host and device must agree.
+#define PROCESS(v) ((v) * 2 + 1)
+
+#endif
@@ -0,0 +1,299 @@
+/**********************************************************************
+Host/device producer-consumer through fine-grained SVM atomics.
+
+A persistent kernel (one work-item) consumes requests that host threads
+push into a lock-free ring buffer in CL_MEM_SVM_FINE_GRAIN_BUFFER |
+CL_MEM_SVM_ATOMICS memory, and answers through a second ring that a host
+collector thread drains. Device-side atomics use
+memory_scope_all_svm_devices, host-side the GCC __atomic builtins.
+
+Three measurements:
+	ping-pong    one request in flight at a time: pure round-trip latency
+	streaming    N producer threads saturating the ring: items/sec, latency
+	enqueue      the current pattern, one clEnqueueNDRangeKernel + clFinish
+	             per request, for comparison
+
+Usage: prog [producer threads [items per thread]]
+********************************************************************/
+
+#include <CL/cl.h>
+#include <string.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <iostream>
+#include <iomanip>
+#include <vector>
+#include <algorithm>
+#include <atomic>
+#include <thread>
+#include <chrono>
+
+#include "../common/CLSetup.hpp"
+#include "Ring.h"
+
+#define SUCCESS 0
+#define FAILURE 1
+
+using namespace std;
+
+int Producers = 4;
+int ItemsPerProducer = 100000;
+const int PINGPONG_ITEMS = 10000;
+
+typedef chrono::steady_clock Clock;
+
+int64_t nowNs()
+{
+	return chrono::duration_cast<chrono::nanoseconds>(Clock::now().time_since_epoch()).count();
+}
+
+/* Multi-producer push; returns false when the ring is full. */
+bool ringPush(Cell *cells, atomic<int> &tail, int id, int value)
+{
+	int pos = tail.load(memory_order_relaxed);
+	for (;;)
+	{
+		Cell *cell = &cells[pos & RING_MASK];
+		int dif = __atomic_load_n(&cell->seq, __ATOMIC_ACQUIRE) - pos;
+		if (dif == 0)
+		{
+			if (tail.compare_exchange_weak(pos, pos + 1, memory_order_relaxed))
+			{
+				cell->id = id;
+				cell->value = value;
+				__atomic_store_n(&cell->seq, pos + 1, __ATOMIC_RELEASE);
+				return true;
+			}
+		}
+		else if (dif < 0)
+			return false;
+		else
+			pos = tail.load(memory_order_relaxed);
+	}
+}
+
+/* Single-consumer pop; returns false when the ring is empty. */
+bool ringPop(Cell *cells, int &head, int &id, int &value)
+{
+	Cell *cell = &cells[head & RING_MASK];
+	if (__atomic_load_n(&cell->seq, __ATOMIC_ACQUIRE) != head + 1)
+		return false;
+	id = cell->id;
+	value = cell->value;
+	__atomic_store_n(&cell->seq, head + RING_CAPACITY, __ATOMIC_RELEASE);
+	head++;
+	return true;
+}
+
+void resetRing(Cell *cells)
+{
+	for (int i = 0; i < RING_CAPACITY; i++)
+	{
+		cells[i].seq = i;
+		cells[i].id = -1;
+		cells[i].value = 0;
+	}
+}
+
+void printLatency(const char *mode, vector<int64_t> &latencyNs, double seconds, bool correct)
+{
+	sort(latencyNs.begin(), latencyNs.end());
+	size_t n = latencyNs.size();
+	cout << setw(12) << mode
+	     << "  " << setw(10) << n / seconds << " items/s"
+	     << "  p50 " << setw(8) << latencyNs[n / 2] * 1e-3 << " us"
+	     << "  p99 " << setw(8) << latencyNs[(size_t)(n * 0.99)] * 1e-3 << " us"
+	     << "  max " << setw(8) << latencyNs[n - 1] * 1e-3 << " us"
+	     << (correct ? "" : "  MISMATCH") << endl;
+}
+
+struct SharedRings
+{
+	Cell *requests;
+	Cell *responses;
+	int *stop;
+};
+
+/* Launch the persistent consumer; it runs until *stop is raised. */
+cl_kernel startConsumer(CLEnv &env, cl_program program, SharedRings &rings)
+{
+	resetRing(rings.requests);
+	resetRing(rings.responses);
+	*rings.stop = 0;
+
+	cl_kernel kernel = clCreateKernel(program, "persistent_consumer", NULL);
+	clSetKernelArgSVMPointer(kernel, 0, rings.requests);
+	clSetKernelArgSVMPointer(kernel, 1, rings.responses);
+	clSetKernelArgSVMPointer(kernel, 2, rings.stop);
+	size_t global_work_size[1] = { 1 };
+	clEnqueueNDRangeKernel(env.commandQueue, kernel, 1, NULL, global_work_size, global_work_size, 0, NULL, NULL);
+	clFlush(env.commandQueue);
+	return kernel;
+}
+
+void stopConsumer(CLEnv &env, cl_kernel kernel, SharedRings &rings)
+{
+	__atomic_store_n(rings.stop, 1, __ATOMIC_RELEASE);
+	clFinish(env.commandQueue);
+	clReleaseKernel(kernel);
+}
+
+
+int ping_pong(CLEnv &env, cl_program program, SharedRings &rings)
+{
+	cl_kernel kernel = startConsumer(env, program, rings);
+	atomic<int> tail(0);
+	int head = 0;
+	vector<int64_t> latency(PINGPONG_ITEMS);
+	bool correct = true;
+
+	int64_t begin = nowNs();
+	for (int i = 0; i < PINGPONG_ITEMS; i++)
+	{
+		int id, value;
+		int64_t submit = nowNs();
+		ringPush(rings.requests, tail, i, i);
+		while (!ringPop(rings.responses, head, id, value))
+			;
+		latency[i] = nowNs() - submit;
+		correct = correct && id == i && value == PROCESS(i);
+	}
+	double seconds = (nowNs() - begin) * 1e-9;
+
+	stopConsumer(env, kernel, rings);
+	printLatency("ping-pong", latency, seconds, correct);
+	return correct ? SUCCESS : FAILURE;
+}
+
+
+int streaming(CLEnv &env, cl_program program, SharedRings &rings)
+{
+	int total = Producers * ItemsPerProducer;
+	vector<int64_t> submitNs(total), latency(total);
+	atomic<int> tail(0);
+	bool correct = true;
+
+	cl_kernel kernel = startConsumer(env, program, rings);
+	int64_t begin = nowNs();
+
+	/* collector: the only consumer of the response ring */
+	thread collector([&]() {
+		int head = 0, id, value;
+		for (int received = 0; received < total; )
+		{
+			if (!ringPop(rings.responses, head, id, value))
+				continue;
+			latency[received++] = nowNs() - submitNs[id];
+			correct = correct && value == PROCESS(id);
+		}
+	});
+
+	vector<thread> producers;
+	for (int p = 0; p < Producers; p++)
+		producers.push_back(thread([&, p]() {
+			for (int i = 0; i < ItemsPerProducer; i++)
+			{
+				int id = p * ItemsPerProducer + i;
+				submitNs[id] = nowNs();
+				while (!ringPush(rings.requests, tail, id, id))
+					this_thread::yield();
+			}
+		}));
+
+	for (size_t p = 0; p < producers.size(); p++)
+		producers[p].join();
+	collector.join();
+	double seconds = (nowNs() - begin) * 1e-9;
+
+	stopConsumer(env, kernel, rings);
+	char mode[32];
+	sprintf(mode, "streaming x%d", Producers);
+	printLatency(mode, latency, seconds, correct);
+	return correct ? SUCCESS : FAILURE;
+}
+
+
+int enqueue_per_request(CLEnv &env, cl_program program, SharedRings &rings)
+{
+	Cell *cell = rings.requests;
+	cl_kernel kernel = clCreateKernel(program, "process_one", NULL);
+	clSetKernelArgSVMPointer(kernel, 0, cell);
+	size_t global_work_size[1] = { 1 };
+	vector<int64_t> latency(PINGPONG_ITEMS);
+	bool correct = true;
+
+	int64_t begin = nowNs();
+	for (int i = 0; i < PINGPONG_ITEMS; i++)
+	{
+		int64_t submit = nowNs();
+		cell->value = i;
+		clEnqueueNDRangeKernel(env.commandQueue, kernel, 1, NULL, global_work_size, NULL, 0, NULL, NULL);
+		clFinish(env.commandQueue);
+		correct = correct && cell->value == PROCESS(i);
+		latency[i] = nowNs() - submit;
+	}
+	double seconds = (nowNs() - begin) * 1e-9;
+
+	clReleaseKernel(kernel);
+	printLatency("enqueue", latency, seconds, correct);
+	return correct ? SUCCESS : FAILURE;
+}
+
+
+int main(int argc, char* argv[])
+{
+	if (argc > 1)
+		Producers = atoi(argv[1]);
+	if (argc > 2)
+		ItemsPerProducer = atoi(argv[2]);
+	if (Producers < 1 || ItemsPerProducer < 1)
+	{
+		cout << "Error: producers and items per producer must be at least 1" << endl;
+		return FAILURE;
+	}
+
+	CLEnv env;
+	if (setupCL(env) != SUCCESS)
+		return FAILURE;
+
+	cl_device_svm_capabilities caps = 0;
+	clGetDeviceInfo(env.device(), CL_DEVICE_SVM_CAPABILITIES, sizeof(caps), &caps, NULL);
+	if (!(caps & CL_DEVICE_SVM_FINE_GRAIN_BUFFER) || !(caps & CL_DEVICE_SVM_ATOMICS))
+	{
+		cout << "Device does not support fine-grained SVM with atomics; nothing to measure." << endl;
+		releaseCL(env);
+		return SUCCESS;
+	}
+
+	const char *files[] = { "Ring.h", "Kernel.cl" };
+	cl_program program = buildProgramFromFiles(env, files, 2, "-cl-std=CL2.0");
+	if (program == NULL)
+	{
+		releaseCL(env);
+		return FAILURE;
+	}
+
+	cl_svm_mem_flags flags = CL_MEM_READ_WRITE | CL_MEM_SVM_FINE_GRAIN_BUFFER | CL_MEM_SVM_ATOMICS;
+	SharedRings rings;
+	rings.requests = (Cell *)clSVMAlloc(env.context, flags, RING_CAPACITY * sizeof(Cell), 0);
+	rings.responses = (Cell *)clSVMAlloc(env.context, flags, RING_CAPACITY * sizeof(Cell), 0);
+	rings.stop = (int *)clSVMAlloc(env.context, flags, sizeof(int), 0);
+
+	cout << fixed << setprecision(2);
+	cout << "Persistent kernel vs enqueue per request \n------------------------------ " << endl;
+	int isSuccess = SUCCESS;
+	if (ping_pong(env, program, rings) != SUCCESS)
+		isSuccess = FAILURE;
+	if (streaming(env, program, rings) != SUCCESS)
+		isSuccess = FAILURE;
+	if (enqueue_per_request(env, program, rings) != SUCCESS)
+		isSuccess = FAILURE;
+
+	clSVMFree(env.context, rings.requests);
+	clSVMFree(env.context, rings.responses);
+	clSVMFree(env.context, rings.stop);
+	clReleaseProgram(program);
+	releaseCL(env);
+	return isSuccess;
+}
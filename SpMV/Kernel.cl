@@ -0,0 +1,78 @@
+#ifndef VECTOR_SIZE
+#define VECTOR_SIZE 32      // work-items cooperating on one row in spmv_csr_vector
+#endif
+
+// One work-item per row.
+__kernel void spmv_csr_scalar( const __global int* row_ptr,
+                               const __global int* col_idx,
+                               const __global float* values,
+                               const __global float* x,
+                               __global float* y,
+                               const int rows
+                               ) {
+
+  const int row = get_global_id(0);
+  if (row >= rows)
+    return;
+
+  float sum = 0.0f;
+  for (int j = row_ptr[row]; j < row_ptr[row + 1]; j++) {
+    sum += values[j] * x[col_idx[j]];
+  }
+  y[row] = sum;
+}
+
+// VECTOR_SIZE work-items per row, partial sums reduced in local memory.
+// Every work-item reaches every barrier, including those past the last row.
+__kernel void spmv_csr_vector( const __global int* row_ptr,
+                               const __global int* col_idx,
+                               const __global float* values,
+                               const __global float* x,
+                               __global float* y,
+                               const int rows,
+                               __local float* partial
+                               ) {
+
+  const int lid  = get_local_id(0);
+  const int lane = lid % VECTOR_SIZE;
+  const int row  = get_global_id(0) / VECTOR_SIZE;
+
+  float sum = 0.0f;
+  if (row < rows) {
+    for (int j = row_ptr[row] + lane; j < row_ptr[row + 1]; j += VECTOR_SIZE) {
+      sum += values[j] * x[col_idx[j]];
+    }
+  }
+  partial[lid] = sum;
+  barrier(CLK_LOCAL_MEM_FENCE);
+
+  for (int offset = VECTOR_SIZE / 2; offset > 0; offset /= 2) {
+    if (lane < offset)
+      partial[lid] += partial[lid + offset];
+    barrier(CLK_LOCAL_MEM_FENCE);
+  }
+
+  if (lane == 0 && row < rows)
+    y[row] = partial[lid];
+}
+
+// ELLPACK, column-major: entry k of row r is at [k * rows + r], so
+// consecutive work-items read consecutive addresses. Padding has value 0.
+__kernel void spmv_ell( const __global int* ell_cols,
+                        const __global float* ell_vals,
+                        const __global float* x,
+                        __global float* y,
+                        const int rows,
+                        const int width
+                        ) {
+
+  const int row = get_global_id(0);
+  if (row >= rows)
+    return;
+
+  float sum = 0.0f;
+  for (int k = 0; k < width; k++) {
+    sum += ell_vals[k * rows + row] * x[ell_cols[k * rows + row]];
+  }
+  y[row] = sum;
+}
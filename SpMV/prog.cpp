@@ -0,0 +1,383 @@
+/**********************************************************************
+Sparse matrix-vector product (y = A x) in CSR and ELLPACK formats.
+
+A random sparse matrix is generated as COO triplets and converted on the
+host to CSR and ELL. Each of the three kernels (CSR scalar, CSR vector,
+ELL) is run with its arrays in SVM (plain pointers) and in cl_mem buffers.
+The indirect x[col_idx[j]] gather is where the two placements differ most.
+
+Usage: prog [rows [average nonzeros per row]]
+********************************************************************/
+
+#include <CL/cl.h>
+#include <string.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <math.h>
+#include <iostream>
+#include <iomanip>
+#include <string>
+#include <vector>
+#include <algorithm>
+#include <chrono>
+
+#include "../common/CLSetup.hpp"
+
+#define SUCCESS 0
+#define FAILURE 1
+
+using namespace std;
+
+int Rows = 1 << 20;
+int AvgNnz = 16;
+
+const int NRUNS = 10;
+const int VECTOR_SIZE = 32;
+const int LOCAL_SIZE = 128;
+const double TOLERANCE = 1e-4;   // max relative error; the kernels sum in a different order than the host
+
+struct COOMatrix
+{
+	int rows, cols;
+	vector<int> row, col;
+	vector<float> val;
+};
+
+struct CSRMatrix
+{
+	int rows, cols;
+	vector<int> row_ptr;
+	vector<int> col_idx;
+	vector<float> values;
+};
+
+struct ELLMatrix
+{
+	int rows, width;
+	vector<int> cols;       // column-major, rows * width
+	vector<float> vals;
+};
+
+enum SpMVKernel { CSR_SCALAR, CSR_VECTOR, ELL };
+const char *kernelNames[] = { "spmv_csr_scalar", "spmv_csr_vector", "spmv_ell" };
+
+
+/* Random matrix with 1..2*avgNnz entries per row at random columns. */
+void generateCOO(int rows, int cols, int avgNnz, COOMatrix &coo)
+{
+	srand(42);
+	coo.rows = rows;
+	coo.cols = cols;
+	for (int r = 0; r < rows; r++)
+	{
+		int nnz = 1 + rand() % (2 * avgNnz);
+		for (int k = 0; k < nnz; k++)
+		{
+			coo.row.push_back(r);
+			coo.col.push_back(rand() % cols);
+			coo.val.push_back((float)(rand() % 100) / 100.0f);
+		}
+	}
+}
+
+/* Counting sort by row; duplicates are kept (they simply add up). */
+void cooToCSR(const COOMatrix &coo, CSRMatrix &csr)
+{
+	size_t nnz = coo.val.size();
+	csr.rows = coo.rows;
+	csr.cols = coo.cols;
+	csr.row_ptr.assign(coo.rows + 1, 0);
+	csr.col_idx.resize(nnz);
+	csr.values.resize(nnz);
+
+	for (size_t i = 0; i < nnz; i++)
+		csr.row_ptr[coo.row[i] + 1]++;
+	for (int r = 0; r < coo.rows; r++)
+		csr.row_ptr[r + 1] += csr.row_ptr[r];
+
+	vector<int> next(csr.row_ptr.begin(), csr.row_ptr.end() - 1);
+	for (size_t i = 0; i < nnz; i++)
+	{
+		int dst = next[coo.row[i]]++;
+		csr.col_idx[dst] = coo.col[i];
+		csr.values[dst] = coo.val[i];
+	}
+}
+
+/* Pad every row to the longest one; padding points at column 0 with value 0. */
+void csrToELL(const CSRMatrix &csr, ELLMatrix &ell)
+{
+	ell.rows = csr.rows;
+	ell.width = 0;
+	for (int r = 0; r < csr.rows; r++)
+		ell.width = max(ell.width, csr.row_ptr[r + 1] - csr.row_ptr[r]);
+
+	ell.cols.assign((size_t)ell.width * ell.rows, 0);
+	ell.vals.assign((size_t)ell.width * ell.rows, 0.0f);
+	for (int r = 0; r < csr.rows; r++)
+		for (int j = csr.row_ptr[r], k = 0; j < csr.row_ptr[r + 1]; j++, k++)
+		{
+			ell.cols[(size_t)k * ell.rows + r] = csr.col_idx[j];
+			ell.vals[(size_t)k * ell.rows + r] = csr.values[j];
+		}
+}
+
+void spmvHost(const CSRMatrix &csr, const vector<float> &x, vector<float> &y)
+{
+	y.assign(csr.rows, 0.0f);
+	for (int r = 0; r < csr.rows; r++)
+	{
+		float sum = 0.0f;
+		for (int j = csr.row_ptr[r]; j < csr.row_ptr[r + 1]; j++)
+			sum += csr.values[j] * x[csr.col_idx[j]];
+		y[r] = sum;
+	}
+}
+
+double maxRelError(const float *y, const vector<float> &ref)
+{
+	double err = 0.0;
+	for (size_t i = 0; i < ref.size(); i++)
+		err = max(err, fabs((double)y[i] - ref[i]) / max(1.0, fabs((double)ref[i])));
+	return err;
+}
+
+size_t roundUp(size_t n, size_t multiple)
+{
+	return (n + multiple - 1) / multiple * multiple;
+}
+
+/* Copy a host vector into a fresh coarse-grained SVM allocation. */
+template <typename T>
+T *svmFromVector(CLEnv &env, const vector<T> &v)
+{
+	size_t bytes = v.size() * sizeof(T);
+	T *ptr = (T *)clSVMAlloc(env.context, CL_MEM_READ_WRITE, bytes, 0);
+	clEnqueueSVMMap(env.commandQueue, CL_TRUE, CL_MAP_WRITE_INVALIDATE_REGION, ptr, bytes, 0, NULL, NULL);
+	memcpy(ptr, &v[0], bytes);
+	clEnqueueSVMUnmap(env.commandQueue, ptr, 0, NULL, NULL);
+	return ptr;
+}
+
+template <typename T>
+cl_mem bufferFromVector(CLEnv &env, const vector<T> &v)
+{
+	return clCreateBuffer(env.context, CL_MEM_READ_ONLY | CL_MEM_COPY_HOST_PTR,
+	                      v.size() * sizeof(T), (void *)&v[0], NULL);
+}
+
+void printResult(const char *mode, SpMVKernel which, size_t nnz, double kernelTime, double totalTime, double err)
+{
+	cout << setw(8) << mode << "  " << setw(16) << kernelNames[which]
+	     << "  kernel " << setw(10) << kernelTime * 1e3 << " ms"
+	     << "  " << setw(8) << 2.0 * nnz / kernelTime * 1e-9 << " GFLOP/s"
+	     << "  end-to-end " << setw(10) << totalTime * 1e3 << " ms"
+	     << "  max rel err " << err << (err > TOLERANCE ? "  MISMATCH" : "") << endl;
+}
+
+void setWorkSize(SpMVKernel which, int rows, size_t *global, size_t *local)
+{
+	local[0] = LOCAL_SIZE;
+	global[0] = roundUp(which == CSR_VECTOR ? (size_t)rows * VECTOR_SIZE : rows, LOCAL_SIZE);
+}
+
+int SpMV_svm(CLEnv &env, cl_program program, SpMVKernel which, const CSRMatrix &csr,
+             const ELLMatrix &ell, const vector<float> &x, const vector<float> &ref)
+{
+	auto start_time = chrono::high_resolution_clock::now();
+	cl_int status;
+	cl_kernel kernel = clCreateKernel(program, kernelNames[which], &status);
+
+	/* The sparse structure lives in SVM as plain pointers. */
+	int *row_ptr = NULL, *col_idx = NULL;
+	float *values = NULL;
+	float *X = svmFromVector(env, x);
+	float *Y = (float *)clSVMAlloc(env.context, CL_MEM_READ_WRITE, csr.rows * sizeof(float), 0);
+
+	if (which == ELL)
+	{
+		col_idx = svmFromVector(env, ell.cols);
+		values = svmFromVector(env, ell.vals);
+		status = clSetKernelArgSVMPointer(kernel, 0, col_idx);
+		status = clSetKernelArgSVMPointer(kernel, 1, values);
+		status = clSetKernelArgSVMPointer(kernel, 2, X);
+		status = clSetKernelArgSVMPointer(kernel, 3, Y);
+		status = clSetKernelArg(kernel, 4, sizeof(int), &ell.rows);
+		status = clSetKernelArg(kernel, 5, sizeof(int), &ell.width);
+	}
+	else
+	{
+		row_ptr = svmFromVector(env, csr.row_ptr);
+		col_idx = svmFromVector(env, csr.col_idx);
+		values = svmFromVector(env, csr.values);
+		status = clSetKernelArgSVMPointer(kernel, 0, row_ptr);
+		status = clSetKernelArgSVMPointer(kernel, 1, col_idx);
+		status = clSetKernelArgSVMPointer(kernel, 2, values);
+		status = clSetKernelArgSVMPointer(kernel, 3, X);
+		status = clSetKernelArgSVMPointer(kernel, 4, Y);
+		status = clSetKernelArg(kernel, 5, sizeof(int), &csr.rows);
+		if (which == CSR_VECTOR)
+			status = clSetKernelArg(kernel, 6, LOCAL_SIZE * sizeof(float), NULL);
+	}
+
+	size_t global_work_size[1], local_work_size[1];
+	setWorkSize(which, csr.rows, global_work_size, local_work_size);
+
+	double kernelTime = 0.0;
+	for (int run = 0; run < NRUNS; run++)
+	{
+		cl_event event;
+		status = clEnqueueNDRangeKernel(env.commandQueue, kernel, 1, NULL, global_work_size, local_work_size, 0, NULL, &event);
+		clWaitForEvents(1, &event);
+		kernelTime += eventSeconds(event);
+		clReleaseEvent(event);
+	}
+
+	status = clEnqueueSVMMap(env.commandQueue, CL_TRUE, CL_MAP_READ, Y, csr.rows * sizeof(float), 0, NULL, NULL);
+	auto end_time = chrono::high_resolution_clock::now();
+	chrono::duration<double> total = end_time - start_time;
+	double err = maxRelError(Y, ref);
+	printResult("SVM", which, csr.values.size(), kernelTime / NRUNS, total.count(), err);
+	status = clEnqueueSVMUnmap(env.commandQueue, Y, 0, NULL, NULL);
+	clFinish(env.commandQueue);
+
+	if (row_ptr != NULL)
+		clSVMFree(env.context, row_ptr);
+	clSVMFree(env.context, col_idx);
+	clSVMFree(env.context, values);
+	clSVMFree(env.context, X);
+	clSVMFree(env.context, Y);
+	clReleaseKernel(kernel);
+	return status == CL_SUCCESS && err <= TOLERANCE ? SUCCESS : FAILURE;
+}
+
+int SpMV_non_svm(CLEnv &env, cl_program program, SpMVKernel which, const CSRMatrix &csr,
+                 const ELLMatrix &ell, const vector<float> &x, const vector<float> &ref)
+{
+	auto start_time = chrono::high_resolution_clock::now();
+	cl_int status;
+	cl_kernel kernel = clCreateKernel(program, kernelNames[which], &status);
+
+	cl_mem Buffer_row_ptr = NULL, Buffer_col_idx, Buffer_values;
+	cl_mem Buffer_X = bufferFromVector(env, x);
+	cl_mem Buffer_Y = clCreateBuffer(env.context, CL_MEM_WRITE_ONLY, csr.rows * sizeof(float), NULL, NULL);
+
+	if (which == ELL)
+	{
+		Buffer_col_idx = bufferFromVector(env, ell.cols);
+		Buffer_values = bufferFromVector(env, ell.vals);
+		status = clSetKernelArg(kernel, 0, sizeof(cl_mem), &Buffer_col_idx);
+		status = clSetKernelArg(kernel, 1, sizeof(cl_mem), &Buffer_values);
+		status = clSetKernelArg(kernel, 2, sizeof(cl_mem), &Buffer_X);
+		status = clSetKernelArg(kernel, 3, sizeof(cl_mem), &Buffer_Y);
+		status = clSetKernelArg(kernel, 4, sizeof(int), &ell.rows);
+		status = clSetKernelArg(kernel, 5, sizeof(int), &ell.width);
+	}
+	else
+	{
+		Buffer_row_ptr = bufferFromVector(env, csr.row_ptr);
+		Buffer_col_idx = bufferFromVector(env, csr.col_idx);
+		Buffer_values = bufferFromVector(env, csr.values);
+		status = clSetKernelArg(kernel, 0, sizeof(cl_mem), &Buffer_row_ptr);
+		status = clSetKernelArg(kernel, 1, sizeof(cl_mem), &Buffer_col_idx);
+		status = clSetKernelArg(kernel, 2, sizeof(cl_mem), &Buffer_values);
+		status = clSetKernelArg(kernel, 3, sizeof(cl_mem), &Buffer_X);
+		status = clSetKernelArg(kernel, 4, sizeof(cl_mem), &Buffer_Y);
+		status = clSetKernelArg(kernel, 5, sizeof(int), &csr.rows);
+		if (which == CSR_VECTOR)
+			status = clSetKernelArg(kernel, 6, LOCAL_SIZE * sizeof(float), NULL);
+	}
+
+	size_t global_work_size[1], local_work_size[1];
+	setWorkSize(which, csr.rows, global_work_size, local_work_size);
+
+	double kernelTime = 0.0;
+	for (int run = 0; run < NRUNS; run++)
+	{
+		cl_event event;
+		status = clEnqueueNDRangeKernel(env.commandQueue, kernel, 1, NULL, global_work_size, local_work_size, 0, NULL, &event);
+		clWaitForEvents(1, &event);
+		kernelTime += eventSeconds(event);
+		clReleaseEvent(event);
+	}
+
+	vector<float> y(csr.rows);
+	status = clEnqueueReadBuffer(env.commandQueue, Buffer_Y, CL_TRUE, 0, csr.rows * sizeof(float), &y[0], 0, NULL, NULL);
+	auto end_time = chrono::high_resolution_clock::now();
+	chrono::duration<double> total = end_time - start_time;
+	double err = maxRelError(&y[0], ref);
+	printResult("Non-SVM", which, csr.values.size(), kernelTime / NRUNS, total.count(), err);
+
+	if (Buffer_row_ptr != NULL)
+		clReleaseMemObject(Buffer_row_ptr);
+	clReleaseMemObject(Buffer_col_idx);
+	clReleaseMemObject(Buffer_values);
+	clReleaseMemObject(Buffer_X);
+	clReleaseMemObject(Buffer_Y);
+	clReleaseKernel(kernel);
+	return status == CL_SUCCESS && err <= TOLERANCE ? SUCCESS : FAILURE;
+}
+
+
+int main(int argc, char* argv[])
+{
+	if (argc > 1)
+		Rows = atoi(argv[1]);
+	if (argc > 2)
+		AvgNnz = atoi(argv[2]);
+
+/*Step 1: Build the matrix on the host and convert it.*/
+	COOMatrix coo;
+	CSRMatrix csr;
+	ELLMatrix ell;
+
+	auto start_time = chrono::high_resolution_clock::now();
+	generateCOO(Rows, Rows, AvgNnz, coo);
+	auto convert_time = chrono::high_resolution_clock::now();
+	cooToCSR(coo, csr);
+	auto csr_time = chrono::high_resolution_clock::now();
+	csrToELL(csr, ell);
+	auto ell_time = chrono::high_resolution_clock::now();
+
+	cout << "Matrix: " << Rows << " x " << Rows << ", nnz " << csr.values.size()
+	     << ", ELL width " << ell.width << " (" << fixed << setprecision(1)
+	     << 100.0 * csr.values.size() / ((double)ell.width * Rows) << "% filled)" << endl;
+	cout << "COO generation " << chrono::duration<double>(convert_time - start_time).count() << " s, "
+	     << "COO->CSR " << chrono::duration<double>(csr_time - convert_time).count() << " s, "
+	     << "CSR->ELL " << chrono::duration<double>(ell_time - csr_time).count() << " s" << endl;
+	cout << setprecision(3);
+
+	vector<float> x(Rows), ref;
+	for (int i = 0; i < Rows; i++)
+		x[i] = (float)(i % 7) - 3.0f;
+	spmvHost(csr, x, ref);
+
+/*Step 2: OpenCL setup; one program serves both placements.*/
+	CLEnv env;
+	if (setupCL(env) != SUCCESS)
+		return FAILURE;
+
+	char options[64];
+	sprintf(options, "-cl-std=CL2.0 -DVECTOR_SIZE=%d", VECTOR_SIZE);
+	cl_program program = buildProgramFromFile(env, "Kernel.cl", options);
+	if (program == NULL)
+	{
+		releaseCL(env);
+		return FAILURE;
+	}
+
+/*Step 3: Every kernel in both placements.*/
+	int isSuccess = SUCCESS;
+	cout << "\nSVM vs Non-SVM \n------------------------------ " << endl;
+	for (int which = CSR_SCALAR; which <= ELL; which++)
+	{
+		if (SpMV_svm(env, program, (SpMVKernel)which, csr, ell, x, ref) != SUCCESS)
+			isSuccess = FAILURE;
+		if (SpMV_non_svm(env, program, (SpMVKernel)which, csr, ell, x, ref) != SUCCESS)
+			isSuccess = FAILURE;
+	}
+
+	clReleaseProgram(program);
+	releaseCL(env);
+	return isSuccess;
+}
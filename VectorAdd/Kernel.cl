@@ -2,3 +2,21 @@ kernel void vector_add(__global float *a, __global float *b, __global float *res
     for ( uint i = get_global_id(0); i < vector_size; i += get_global_size(0))
         res[i] = a[i] + b[i]; 
 }
+
+// Scale and fused variants of the same grid-stride loop.
+kernel void scale(__global float *res, __global const float *x, float alpha, uint vector_size){
+    for ( uint i = get_global_id(0); i < vector_size; i += get_global_size(0))
+        res[i] = alpha * x[i];
+}
+
+// y = alpha * x + y in one pass (scale + vector_add would be two)
+kernel void axpy(float alpha, __global const float *x, __global float *y, uint vector_size){
+    for ( uint i = get_global_id(0); i < vector_size; i += get_global_size(0))
+        y[i] = alpha * x[i] + y[i];
+}
+
+// y = alpha * x + beta * y in one pass
+kernel void axpby(float alpha, __global const float *x, float beta, __global float *y, uint vector_size){
+    for ( uint i = get_global_id(0); i < vector_size; i += get_global_size(0))
+        y[i] = alpha * x[i] + beta * y[i];
+}
@@ -20,19 +20,36 @@ THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
 #include <string.h>
 #include <stdio.h>
 #include <stdlib.h>
+#include <math.h>
 #include <iostream>
 #include <string>
 #include <fstream>
 #include <iomanip>
 #include <chrono>
 #include <exception>
+#include <functional>
+
+#include "../common/MatrixLoader.hpp"
+#include "../common/CLSetup.hpp"
+#include "../common/PerfCounters.hpp"
+#include "../common/ElementwiseExpr.hpp"
+#include "../common/FirstTouch.hpp"
+#include "../common/Numa.hpp"
+#include "../common/Roofline.hpp"
+#include "../common/BenchmarkRegistry.hpp"
 
 #define SUCCESS 0
 #define FAILURE 1
 
+SVM_BENCH_NAMESPACE_BEGIN(vectoradd)
+
 using namespace std;
 
-const int SIZE = 100000000;
+int SIZE = 100000000;
+
+/* optional on-disk inputs: prog [a-file b-file], see common/MatrixLoader.hpp */
+MappedMatrix inputA;
+MappedMatrix inputB;
     
 /* convert the kernel file into a string */
 int convertToString(const char *filename, std::string& s)
@@ -65,85 +82,112 @@ int convertToString(const char *filename, std::string& s)
 	return FAILURE;
 }
 
-void vector_add_svm();
-void vector_add_non_svm();
+int vector_add_svm();
+int vector_add_non_svm();
+int vector_add_host_ptr();
+int vector_fusion();
+int vector_first_touch();
+int vector_numa();
 
 
+#ifdef SVM_BENCH_DRIVER
+static BenchmarkRegistrar registrar(Benchmark("VectorAdd", "VectorAdd")
+	.param("size", "elements per vector", &SIZE)
+	.mode("svm", vector_add_svm)
+	.mode("non_svm", vector_add_non_svm)
+	.mode("host_ptr", vector_add_host_ptr)
+	.mode("fusion", vector_fusion)
+	.mode("first_touch", vector_first_touch)
+	.mode("numa", vector_numa));
+#else
 int main(int argc, char* argv[])
 {
+  PerfCounters::instance();  // SVM_PERF_COUNTERS=1: open before the runtime starts threads
+
+  int isSuccess = SUCCESS;
+
+  if (argc == 3)
+  {
+    if (mapMatrixFile(argv[1], ELEM_FLOAT32, inputA) != SUCCESS ||
+        mapMatrixFile(argv[2], ELEM_FLOAT32, inputB) != SUCCESS)
+      return FAILURE;
+    if (inputA.count() != inputB.count())
+    {
+      cout << "Error: a and b differ in length" << endl;
+      return FAILURE;
+    }
+    SIZE = inputA.count();
+    cout << "Inputs: " << argv[1] << ", " << argv[2] << " (" << SIZE << " elements)" << endl;
+  }
 
   std::cout << "SVM \n------------------------------ \n" << std::endl;
   {
-    vector_add_svm();
+    if (vector_add_svm() != SUCCESS)
+      isSuccess = FAILURE;
   }
   
   
   std::cout << "\n\n" << "Non-SVM \n------------------------------ " << std::endl;
   {
-    vector_add_non_svm();
+    if (vector_add_non_svm() != SUCCESS)
+      isSuccess = FAILURE;
+  }
+  
+  
+  std::cout << "\n\n" << "Host-Ptr \n------------------------------ " << std::endl;
+  {
+    if (vector_add_host_ptr() != SUCCESS)
+      isSuccess = FAILURE;
+  }
+  
+  
+  std::cout << "\n\n" << "Fusion \n------------------------------ " << std::endl;
+  {
+    if (vector_fusion() != SUCCESS)
+      isSuccess = FAILURE;
+  }
+
+
+  std::cout << "\n\n" << "First-Touch \n------------------------------ " << std::endl;
+  {
+    if (vector_first_touch() != SUCCESS)
+      isSuccess = FAILURE;
+  }
+
+
+  std::cout << "\n\n" << "NUMA \n------------------------------ " << std::endl;
+  {
+    if (vector_numa() != SUCCESS)
+      isSuccess = FAILURE;
   }
+
+  Roofline::instance().report();
+  Roofline::instance().exportCsv("roofline.csv");
+
+  unmapMatrixFile(inputA);
+  unmapMatrixFile(inputB);
+  return isSuccess;
 }
+#endif
 
 
 
-void vector_add_svm(){
+int vector_add_svm(){
 
-  const float ELEMENTS = 100000000;
+  const float ELEMENTS = SIZE;
 	const float DATA_SIZE = ELEMENTS * sizeof(float);
  
-/*Step1: Getting platforms and choose an available one.*/
-	cl_uint numPlatforms;	//the NO. of platforms
-	cl_platform_id platform = NULL;	//the chosen platform
-	cl_int	status = clGetPlatformIDs(0, NULL, &numPlatforms);
-	if (status != CL_SUCCESS)
-	{
-		cout << "Error: Getting platforms!" << endl;
-	}
-
-	/*For clarity, choose the first available platform. */
-	if(numPlatforms > 0)
-	{
-		cl_platform_id* platforms = (cl_platform_id* )malloc(numPlatforms* sizeof(cl_platform_id));
-		status = clGetPlatformIDs(numPlatforms, platforms, NULL);
-		platform = platforms[0];
-		free(platforms);
-	}
-
-/*Step 2:Query the platform and choose the first GPU device if has one.Otherwise use the CPU as device.*/
-	cl_uint				numDevices = 0;
-	cl_device_id        *devices;
-	status = clGetDeviceIDs(platform, CL_DEVICE_TYPE_GPU, 0, NULL, &numDevices);	
-	if (numDevices == 0)	//no GPU available.
-	{
-		cout << "No GPU device available." << endl;
-		cout << "Choose CPU as default device." << endl;
-		status = clGetDeviceIDs(platform, CL_DEVICE_TYPE_CPU, 0, NULL, &numDevices);	
-		devices = (cl_device_id*)malloc(numDevices * sizeof(cl_device_id));
-		status = clGetDeviceIDs(platform, CL_DEVICE_TYPE_CPU, numDevices, devices, NULL);
-	}
-	else
-	{
-		devices = (cl_device_id*)malloc(numDevices * sizeof(cl_device_id));
-		status = clGetDeviceIDs(platform, CL_DEVICE_TYPE_GPU, numDevices, devices, NULL);
-	}
-	
+	PhaseProfiler phases("VectorAdd SVM");
+	phases.next("setup");
 
-/*Step 3: Create context.*/
-	cl_context context = clCreateContext(NULL,1, devices,NULL,NULL,NULL);
-	
-/*Step 4: Creating command queue associate with the context.*/
-	/*old func. code
-		cl_command_queue commandQueue = clCreateCommandQueue(context, devices[0], 0, NULL);
-    	*/
-	/*new func.
-    	*	cl_command_queue clCreateCommandQueueWithProperties(
-			cl_context context, 
-			cl_device_id device, 
-			const cl_queue_properties *properties, 
-			cl_int *errcode_ret)
-	*/
-	//cl_command_queue commandQueue = clCreateCommandQueueWithProperties(context, devices[0], 0, NULL);
-	cl_command_queue commandQueue = clCreateCommandQueue(context, devices[0], CL_QUEUE_PROFILING_ENABLE, NULL);
+/*Step1-4: Platform, device, context and command queue.*/
+	CLEnv env;
+	if (setupCL(env) != SUCCESS)
+		return FAILURE;
+	cl_device_id *devices = env.devices;
+	cl_context context = env.context;
+	cl_command_queue commandQueue = env.commandQueue;
+	cl_int status = CL_SUCCESS;
 
 /*Step 5: Create program object */
 	const char *filename = "Kernel.cl";
@@ -156,10 +200,19 @@ void vector_add_svm(){
 /*Step 6: Build program. */
 	const char options[] = "-cl-std=CL2.0";
 	status = clBuildProgram(program, 1,devices, options,NULL,NULL);
+	if (status != CL_SUCCESS)
+	{
+		cout << "Error: building " << filename << " failed, status: " << status << endl;
+		clReleaseProgram(program);
+		releaseCL(env);
+		return FAILURE;
+	}
 
 /*Step 7: Create kernel object */
 	cl_kernel kernel = clCreateKernel(program, "vector_add", NULL);
 	
+	phases.next("inputs", commandQueue);
+
 /*Step 8: Initial input,output for the host and create SVM buffer*/
   auto start_time = chrono::high_resolution_clock::now();
   
@@ -167,17 +220,32 @@ void vector_add_svm(){
   int szB = SIZE;
   int szC = SIZE;
 	
-  float *A = (float *)clSVMAlloc( context, CL_MEM_READ_WRITE, szA * sizeof(float), 0 );
-  float *B = (float *)clSVMAlloc( context, CL_MEM_READ_WRITE, szB * sizeof(float), 0 );
+  float *A;
+  float *B;
+  bool zeroCopyA = false;
+  bool zeroCopyB = false;
 	float *C = (float *)clSVMAlloc( context, CL_MEM_READ_WRITE, szC * sizeof(float), 0 );
 
+  if (inputA.loaded())
+  {
+    // Stream (or, with fine-grained system SVM, alias) the mapped files
+    A = (float *)loadIntoSVM(context, commandQueue, devices[0], inputA, ELEM_FLOAT32, zeroCopyA);
+    B = (float *)loadIntoSVM(context, commandQueue, devices[0], inputB, ELEM_FLOAT32, zeroCopyB);
+  }
+  else
+  {
+  A = (float *)clSVMAlloc( context, CL_MEM_READ_WRITE, szA * sizeof(float), 0 );
+  B = (float *)clSVMAlloc( context, CL_MEM_READ_WRITE, szB * sizeof(float), 0 );
  
 	status = clEnqueueSVMMap(commandQueue, CL_TRUE, CL_MAP_WRITE_INVALIDATE_REGION, A, DATA_SIZE, 0, NULL, NULL);
   status = clEnqueueSVMMap(commandQueue, CL_TRUE, CL_MAP_WRITE_INVALIDATE_REGION, B, DATA_SIZE, 0, NULL, NULL);
   
 	status = clEnqueueSVMUnmap(commandQueue, A, 0, NULL, NULL);
   status = clEnqueueSVMUnmap(commandQueue, B, 0, NULL, NULL);
+  }
  
+	phases.next("kernel", commandQueue);
+
 /*Step 9: Sets Kernel arguments.*/
 	status = clSetKernelArgSVMPointer(kernel, 0, A);
  	
@@ -190,9 +258,11 @@ void vector_add_svm(){
   
  
 /*Step 10: Running the kernel.*/
-	size_t global_work_size[1] = {SIZE};
+	size_t global_work_size[1] = {(size_t)SIZE};
   
-	status = clEnqueueNDRangeKernel(commandQueue, kernel, 1, NULL, global_work_size, NULL, 0, NULL, NULL);
+	cl_event kernelEvent;
+	status = clEnqueueNDRangeKernel(commandQueue, kernel, 1, NULL, global_work_size, NULL, 0, NULL, &kernelEvent);
+	Roofline::instance().recordEvent("VectorAdd", "SVM", (double)SIZE, 3.0 * SIZE * sizeof(float), kernelEvent);
   
   clFinish(commandQueue);
  
@@ -202,6 +272,8 @@ void vector_add_svm(){
   chrono::duration<double> time_duration = end_time-start_time;
   cout << "SVM vector_add takes: " << time_duration.count() << " s" <<endl;
 
+	phases.next("readback", commandQueue);
+
 /*Step 11: Test if kernel works and char. are all assign to outputBuffer*/
 /*	
 	cout << "\nA :" << endl;
@@ -233,71 +305,37 @@ void vector_add_svm(){
 */
   status = clEnqueueSVMUnmap(commandQueue, C, 0, NULL, NULL);
 
+	phases.next("cleanup", commandQueue);
+
 /*Step 12: Clean the resources.*/
-	clSVMFree(context, A);  
-  clSVMFree(context, B); 
+	releaseSVMInput(context, A, zeroCopyA);
+  releaseSVMInput(context, B, zeroCopyB);
 	clSVMFree(context, C);  
 	status = clReleaseKernel(kernel);				//Release kernel.
 	status = clReleaseProgram(program);				//Release the program object.
-	status = clReleaseCommandQueue(commandQueue);	//Release  Command queue.
-	status = clReleaseContext(context);				//Release context.
+	releaseCL(env);
 
-	if (devices != NULL)
-	{
-		free(devices);
-		devices = NULL;
-	}
+	phases.report();
 
 	cout<<"Program passed!\n";
+	return SUCCESS;
 }
 
 
 
-void vector_add_non_svm(){
-
-/*Step1: Getting platforms and choose an available one.*/
-	cl_uint numPlatforms; //the NO. of platforms
-	cl_platform_id platform = NULL; //the chosen platform
-	cl_int status = clGetPlatformIDs(0, NULL, &numPlatforms);
-	if (status != CL_SUCCESS)
-	{
-		cout << "Error: Getting platforms!" << endl;
-	}
-
-	/*For clarity, choose the first available platform. */
-	if (numPlatforms > 0)
-	{
-		cl_platform_id* platforms = 
-                     (cl_platform_id*)malloc(numPlatforms * sizeof(cl_platform_id));
-		status = clGetPlatformIDs(numPlatforms, platforms, NULL);
-		platform = platforms[0];
-		free(platforms);
-	}
-
-	/*Step 2:Query the platform and choose the first GPU device if has one.Otherwise use the CPU as device.*/
-	cl_uint numDevices = 0;
-	cl_device_id        *devices;
-	status = clGetDeviceIDs(platform, CL_DEVICE_TYPE_GPU, 0, NULL, &numDevices);
-	if (numDevices == 0) //no GPU available.
-	{
-		cout << "No GPU device available." << endl;
-		cout << "Choose CPU as default device." << endl;
-		status = clGetDeviceIDs(platform, CL_DEVICE_TYPE_CPU, 0, NULL, &numDevices);
-		devices = (cl_device_id*)malloc(numDevices * sizeof(cl_device_id));
-		status = clGetDeviceIDs(platform, CL_DEVICE_TYPE_CPU, numDevices, devices, NULL);
-	}
-	else
-	{
-		devices = (cl_device_id*)malloc(numDevices * sizeof(cl_device_id));
-		status = clGetDeviceIDs(platform, CL_DEVICE_TYPE_GPU, numDevices, devices, NULL);
-	}
+int vector_add_non_svm(){
 
+	PhaseProfiler phases("VectorAdd Non-SVM");
+	phases.next("setup");
 
-	/*Step 3: Create context.*/
-	cl_context context = clCreateContext(NULL, 1, devices, NULL, NULL, NULL);
-
-	/*Step 4: Creating command queue associate with the context.*/
-	cl_command_queue commandQueue = clCreateCommandQueue(context, devices[0], CL_QUEUE_PROFILING_ENABLE, NULL);
+/*Step1-4: Platform, device, context and command queue.*/
+	CLEnv env;
+	if (setupCL(env) != SUCCESS)
+		return FAILURE;
+	cl_device_id *devices = env.devices;
+	cl_context context = env.context;
+	cl_command_queue commandQueue = env.commandQueue;
+	cl_int status = CL_SUCCESS;
 
 	/*Step 5: Create program object */
 	const char *filename = "Kernel.cl";
@@ -309,34 +347,55 @@ void vector_add_non_svm(){
 
 	/*Step 6: Build program. */
 	status = clBuildProgram(program, 1, devices, NULL, NULL, NULL);
+	if (status != CL_SUCCESS)
+	{
+		cout << "Error: building " << filename << " failed, status: " << status << endl;
+		clReleaseProgram(program);
+		releaseCL(env);
+		return FAILURE;
+	}
+
+	phases.next("inputs", commandQueue);
 
 	/*Step 7: Initial input,output for the host and create memory objects for the kernel*/
 	int szA = SIZE;
   int szB = SIZE;
   int szC = SIZE;
 
-  int *A;
-  int *B;
-  int *C;
+  float *A;
+  float *B;
+  float *C;
+  bool ownsA = true;
+  bool ownsB = true;
+
+  C = (float *)malloc(szC * sizeof(float));
+  if (inputA.loaded())
+  {
+    A = (float *)loadIntoHost(inputA, ELEM_FLOAT32, ownsA);
+    B = (float *)loadIntoHost(inputB, ELEM_FLOAT32, ownsB);
+  }
+  else
+  {
+    A = (float *)malloc(szA * sizeof(float));
+    B = (float *)malloc(szB * sizeof(float));
+  }
 
-  A = (int *)malloc(szA * sizeof(int));
-  B = (int *)malloc(szB * sizeof(int));
-  C = (int *)malloc(szC * sizeof(int));
-  
   auto start_time = chrono::high_resolution_clock::now();
   
 	cl_mem Buffer_A = clCreateBuffer(context, CL_MEM_READ_ONLY | CL_MEM_COPY_HOST_PTR, 
-                             szA * sizeof(int), A, NULL);
+                             szA * sizeof(float), A, NULL);
   
   cl_mem Buffer_B = clCreateBuffer(context, CL_MEM_READ_ONLY | CL_MEM_COPY_HOST_PTR, 
-                             szB * sizeof(int), B, NULL);
+                             szB * sizeof(float), B, NULL);
                              
 	cl_mem Buffer_C = clCreateBuffer(context, CL_MEM_READ_WRITE | CL_MEM_COPY_HOST_PTR, 
-                             szC * sizeof(int), C, NULL);
+                             szC * sizeof(float), C, NULL);
 
 	/*Step 8: Create kernel object */
 	cl_kernel kernel = clCreateKernel(program, "vector_add", NULL);
 
+	phases.next("kernel", commandQueue);
+
 	/*Step 9: Sets Kernel arguments.*/
 	status = clSetKernelArg(kernel, 0, sizeof(cl_mem), &Buffer_A);
 	status = clSetKernelArg(kernel, 1, sizeof(cl_mem), &Buffer_B);
@@ -345,14 +404,18 @@ void vector_add_non_svm(){
 
   
 	/*Step 10: Running the kernel.*/
-	size_t global_work_size[1] = { SIZE };
+	size_t global_work_size[1] = { (size_t)SIZE };
  
+	cl_event kernelEvent;
 	status = clEnqueueNDRangeKernel(commandQueue, kernel, 1, NULL, 
-                                        global_work_size, NULL, 0, NULL, NULL);
+                                        global_work_size, NULL, 0, NULL, &kernelEvent);
+	Roofline::instance().recordEvent("VectorAdd", "Non-SVM", (double)SIZE, 3.0 * SIZE * sizeof(float), kernelEvent);
   
+	phases.next("readback", commandQueue);
+
 	/*Step 11: Read the cout put back to host memory.*/
   
-	status = clEnqueueReadBuffer(commandQueue, Buffer_C, CL_TRUE, 0, szC * sizeof(int), C, 0, NULL, NULL);
+	status = clEnqueueReadBuffer(commandQueue, Buffer_C, CL_TRUE, 0, szC * sizeof(float), C, 0, NULL, NULL);
   
   auto end_time = chrono::high_resolution_clock::now();
   chrono::duration<double> time_duration = end_time-start_time;
@@ -390,14 +453,15 @@ void vector_add_non_svm(){
   }
 */  
 
+	phases.next("cleanup", commandQueue);
+
 	/*Step 12: Clean the resources.*/
 	status = clReleaseKernel(kernel); //Release kernel.
 	status = clReleaseProgram(program); //Release the program object.
 	status = clReleaseMemObject(Buffer_A); //Release mem object.
   status = clReleaseMemObject(Buffer_B);
 	status = clReleaseMemObject(Buffer_C);
-	status = clReleaseCommandQueue(commandQueue); //Release  Command queue.
-	status = clReleaseContext(context); //Release context.
+	releaseCL(env);
 
 	if (C != NULL)
 	{
@@ -405,12 +469,607 @@ void vector_add_non_svm(){
 		C = NULL;
 	}
 
-	if (devices != NULL)
+	if (ownsA) free(A);  // file inputs used in place are not ours to free
+	if (ownsB) free(B);
+
+	phases.report();
+
+	std::cout << "\nPassed!\n";
+	return SUCCESS;
+}
+
+
+
+int vector_add_host_ptr(){
+
+	PhaseProfiler phases("VectorAdd Host-Ptr");
+	phases.next("setup");
+
+/*Step1-4: Platform, device, context and command queue.*/
+	CLEnv env;
+	if (setupCL(env) != SUCCESS)
+		return FAILURE;
+
+/*Step 5-6: Create and build program. */
+	cl_program program = buildProgramFromFile(env, "Kernel.cl", NULL);
+	if (program == NULL)
 	{
-		free(devices);
-		devices = NULL;
+		releaseCL(env);
+		return FAILURE;
 	}
 
+/*Step 7: Create kernel object */
+	cl_int status;
+	cl_kernel kernel = clCreateKernel(program, "vector_add", NULL);
+
+	phases.next("inputs", env.commandQueue);
+
+/*Step 8: Zero-copy buffers. A and B wrap our own page-aligned allocations
+  (CL_MEM_USE_HOST_PTR), C is runtime-allocated host memory (CL_MEM_ALLOC_HOST_PTR).
+  Inputs are written through a map so no copy is made on unified-memory devices.*/
+  auto start_time = chrono::high_resolution_clock::now();
+
+  int szA = SIZE;
+  int szB = SIZE;
+  int szC = SIZE;
+
+  float *a = (float *)alignedHostAlloc(szA * sizeof(float));
+  float *b = (float *)alignedHostAlloc(szB * sizeof(float));
+
+  cl_mem Buffer_A = clCreateBuffer(env.context, CL_MEM_READ_ONLY | CL_MEM_USE_HOST_PTR, 
+                             szA * sizeof(float), a, NULL);
+  cl_mem Buffer_B = clCreateBuffer(env.context, CL_MEM_READ_ONLY | CL_MEM_USE_HOST_PTR, 
+                             szB * sizeof(float), b, NULL);
+  cl_mem Buffer_C = clCreateBuffer(env.context, CL_MEM_WRITE_ONLY | CL_MEM_ALLOC_HOST_PTR, 
+                             szC * sizeof(float), NULL, NULL);
+
+  float *A = (float *)clEnqueueMapBuffer(env.commandQueue, Buffer_A, CL_TRUE, CL_MAP_WRITE_INVALIDATE_REGION, 
+                             0, szA * sizeof(float), 0, NULL, NULL, &status);
+  float *B = (float *)clEnqueueMapBuffer(env.commandQueue, Buffer_B, CL_TRUE, CL_MAP_WRITE_INVALIDATE_REGION, 
+                             0, szB * sizeof(float), 0, NULL, NULL, &status);
+  if (A != a || B != b)
+    cout << "Note: runtime did not map the host pointer in place (copying buffers)" << endl;
+
+  if (inputA.loaded())
+  {
+    copyMatrixTo(inputA, ELEM_FLOAT32, A);
+    copyMatrixTo(inputB, ELEM_FLOAT32, B);
+  }
+
+  status = clEnqueueUnmapMemObject(env.commandQueue, Buffer_A, A, 0, NULL, NULL);
+  status = clEnqueueUnmapMemObject(env.commandQueue, Buffer_B, B, 0, NULL, NULL);
+
+	phases.next("kernel", env.commandQueue);
+
+/*Step 9: Sets Kernel arguments.*/
+	status = clSetKernelArg(kernel, 0, sizeof(cl_mem), &Buffer_A);
+	status = clSetKernelArg(kernel, 1, sizeof(cl_mem), &Buffer_B);
+  status = clSetKernelArg(kernel, 2, sizeof(cl_mem), &Buffer_C);
+  status = clSetKernelArg(kernel, 3, sizeof(cl_uint), &SIZE);
+
+/*Step 10: Running the kernel.*/
+	size_t global_work_size[1] = { (size_t)SIZE };
+
+	cl_event kernelEvent;
+	status = clEnqueueNDRangeKernel(env.commandQueue, kernel, 1, NULL, 
+                                        global_work_size, NULL, 0, NULL, &kernelEvent);
+	Roofline::instance().recordEvent("VectorAdd", "Host-Ptr", (double)SIZE, 3.0 * SIZE * sizeof(float), kernelEvent);
+
+	phases.next("readback", env.commandQueue);
+
+/*Step 11: Map the result instead of reading it back.*/
+  float *C = (float *)clEnqueueMapBuffer(env.commandQueue, Buffer_C, CL_TRUE, CL_MAP_READ, 
+                             0, szC * sizeof(float), 0, NULL, NULL, &status);
+
+  auto end_time = chrono::high_resolution_clock::now();
+  chrono::duration<double> time_duration = end_time-start_time;
+  cout << "Host-Ptr vector_add takes: " << time_duration.count() << " s" <<endl;
+
+  status = clEnqueueUnmapMemObject(env.commandQueue, Buffer_C, C, 0, NULL, NULL);
+  clFinish(env.commandQueue);
+
+	phases.next("cleanup", env.commandQueue);
+
+/*Step 12: Clean the resources.*/
+	status = clReleaseKernel(kernel); //Release kernel.
+	status = clReleaseProgram(program); //Release the program object.
+	status = clReleaseMemObject(Buffer_A); //Release mem object.
+  status = clReleaseMemObject(Buffer_B);
+	status = clReleaseMemObject(Buffer_C);
+	releaseCL(env);
+
+  free(a);
+  free(b);
+
+	phases.report();
+
 	std::cout << "\nPassed!\n";
- 
-}
\ No newline at end of file
+	return SUCCESS;
+}
+
+
+
+
+/* y = alpha*x + y (AXPY) and y = alpha*x + beta*y (AXPBY) on SVM vectors,
+   each three ways: a chain of scale/vector_add kernels through a
+   temporary, the hand-fused axpy/axpby kernel, and the same expression
+   through ElementwiseEngine, which generates the fused kernel. Traffic
+   is counted in floats per element. */
+int vector_fusion(){
+/*Step1-4: Platform, device, context and command queue.*/
+	CLEnv env;
+	if (setupCL(env, 0) != SUCCESS)
+		return FAILURE;
+
+/*Step 5-6: Create and build program. */
+	cl_program program = buildProgramFromFile(env, "Kernel.cl", "-cl-std=CL2.0");
+	if (program == NULL)
+	{
+		releaseCL(env);
+		return FAILURE;
+	}
+
+/*Step 7: Create kernel objects */
+	cl_kernel add = clCreateKernel(program, "vector_add", NULL);
+	cl_kernel scale = clCreateKernel(program, "scale", NULL);
+	cl_kernel axpy = clCreateKernel(program, "axpy", NULL);
+	cl_kernel axpby = clCreateKernel(program, "axpby", NULL);
+
+/*Step 8: SVM vectors; tmp only used by the unfused chains.*/
+	size_t bytes = (size_t)SIZE * sizeof(float);
+	float *x = (float *)clSVMAlloc(env.context, CL_MEM_READ_WRITE, bytes, 0);
+	float *y = (float *)clSVMAlloc(env.context, CL_MEM_READ_WRITE, bytes, 0);
+	float *tmp = (float *)clSVMAlloc(env.context, CL_MEM_READ_WRITE, bytes, 0);
+	if (x == NULL || y == NULL || tmp == NULL)
+	{
+		cout << "Error: clSVMAlloc failed" << endl;
+		clSVMFree(env.context, x);
+		clSVMFree(env.context, y);
+		clSVMFree(env.context, tmp);
+		clReleaseKernel(add);
+		clReleaseKernel(scale);
+		clReleaseKernel(axpy);
+		clReleaseKernel(axpby);
+		clReleaseProgram(program);
+		releaseCL(env);
+		return FAILURE;
+	}
+	clEnqueueSVMMap(env.commandQueue, CL_TRUE, CL_MAP_WRITE_INVALIDATE_REGION, x, bytes, 0, NULL, NULL);
+	for (int i = 0; i < SIZE; i++)
+		x[i] = (i % 100) * 0.01f;
+	clEnqueueSVMUnmap(env.commandQueue, x, 0, NULL, NULL);
+
+	const float alpha = 2.0f, beta = 0.5f;
+	cl_uint n = SIZE;
+	size_t global_work_size[1] = { (size_t)SIZE };
+	ElementwiseEngine engine(env);
+	ew::Vector X(x, SIZE), Y(y, SIZE);
+
+	ew::Traffic axpyTraffic = ElementwiseEngine::traffic(Y, alpha * X + Y);
+	ew::Traffic axpbyTraffic = ElementwiseEngine::traffic(Y, alpha * X + beta * Y);
+
+	/* generate and build both expression kernels outside the timing */
+	engine.assign(Y, alpha * X + Y);
+	engine.assign(Y, alpha * X + beta * Y);
+	clFinish(env.commandQueue);
+
+	auto enqueue = [&](cl_kernel kernel) {
+		clEnqueueNDRangeKernel(env.commandQueue, kernel, 1, NULL, global_work_size, NULL, 0, NULL, NULL);
+	};
+	auto scaleInto = [&](float *res, float *src, float factor) {
+		clSetKernelArgSVMPointer(scale, 0, res);
+		clSetKernelArgSVMPointer(scale, 1, src);
+		clSetKernelArg(scale, 2, sizeof(float), &factor);
+		clSetKernelArg(scale, 3, sizeof(cl_uint), &n);
+		enqueue(scale);
+	};
+	auto addInto = [&](float *res, float *a, float *b) {
+		clSetKernelArgSVMPointer(add, 0, a);
+		clSetKernelArgSVMPointer(add, 1, b);
+		clSetKernelArgSVMPointer(add, 2, res);
+		clSetKernelArg(add, 3, sizeof(cl_uint), &n);
+		enqueue(add);
+	};
+
+	/* reset y = 1, run one variant, check it against the host formula */
+	int isSuccess = SUCCESS;
+	auto run = [&](const char *name, int floatsPerElement, int unfused, float b, std::function<void()> body) {
+		clEnqueueSVMMap(env.commandQueue, CL_TRUE, CL_MAP_WRITE_INVALIDATE_REGION, y, bytes, 0, NULL, NULL);
+		for (int i = 0; i < SIZE; i++)
+			y[i] = 1.0f;
+		clEnqueueSVMUnmap(env.commandQueue, y, 0, NULL, NULL);
+		clFinish(env.commandQueue);
+
+		auto start_time = chrono::high_resolution_clock::now();
+		body();
+		clFinish(env.commandQueue);
+		chrono::duration<double> seconds = chrono::high_resolution_clock::now() - start_time;
+
+		clEnqueueSVMMap(env.commandQueue, CL_TRUE, CL_MAP_READ, y, bytes, 0, NULL, NULL);
+		bool correct = true;
+		for (int i = 0; i < SIZE && correct; i += 997)
+			correct = fabsf(y[i] - (alpha * ((i % 100) * 0.01f) + b)) <= 1e-5f;
+		clEnqueueSVMUnmap(env.commandQueue, y, 0, NULL, NULL);
+
+		double moved = (double)floatsPerElement * bytes;
+		cout << setw(22) << name << "  " << setw(9) << seconds.count() << " s  "
+		     << setw(8) << moved / seconds.count() * 1e-9 << " GB/s  "
+		     << floatsPerElement * sizeof(float) << " B/element, saved "
+		     << (unfused - floatsPerElement) * sizeof(float) << " B/element ("
+		     << (unfused - floatsPerElement) * (double)bytes / (1 << 20) << " MB)"
+		     << (correct ? "" : "  MISMATCH") << endl;
+		if (!correct)
+			isSuccess = FAILURE;
+	};
+
+/*Step 9: AXPY.*/
+	cout << fixed << setprecision(3);
+	int u = axpyTraffic.unfused;
+	run("axpy unfused", u, u, 1.0f, [&]() {
+		scaleInto(tmp, x, alpha);
+		addInto(y, tmp, y);
+	});
+	run("axpy kernel", axpyTraffic.fused, u, 1.0f, [&]() {
+		clSetKernelArg(axpy, 0, sizeof(float), &alpha);
+		clSetKernelArgSVMPointer(axpy, 1, x);
+		clSetKernelArgSVMPointer(axpy, 2, y);
+		clSetKernelArg(axpy, 3, sizeof(cl_uint), &n);
+		enqueue(axpy);
+	});
+	run("axpy expression", axpyTraffic.fused, u, 1.0f, [&]() {
+		engine.assign(Y, alpha * X + Y);
+	});
+
+/*Step 10: AXPBY.*/
+	u = axpbyTraffic.unfused;
+	run("axpby unfused", u, u, beta, [&]() {
+		scaleInto(tmp, x, alpha);
+		scaleInto(y, y, beta);
+		addInto(y, tmp, y);
+	});
+	run("axpby kernel", axpbyTraffic.fused, u, beta, [&]() {
+		clSetKernelArg(axpby, 0, sizeof(float), &alpha);
+		clSetKernelArgSVMPointer(axpby, 1, x);
+		clSetKernelArg(axpby, 2, sizeof(float), &beta);
+		clSetKernelArgSVMPointer(axpby, 3, y);
+		clSetKernelArg(axpby, 4, sizeof(cl_uint), &n);
+		enqueue(axpby);
+	});
+	run("axpby expression", axpbyTraffic.fused, u, beta, [&]() {
+		engine.assign(Y, alpha * X + beta * Y);
+	});
+	cout.unsetf(ios::fixed);
+
+/*Step 11: Clean the resources.*/
+	clSVMFree(env.context, x);
+	clSVMFree(env.context, y);
+	clSVMFree(env.context, tmp);
+	clReleaseKernel(add);
+	clReleaseKernel(scale);
+	clReleaseKernel(axpy);
+	clReleaseKernel(axpby);
+	clReleaseProgram(program);
+	releaseCL(env);
+	return isSuccess;
+}
+
+
+
+/* Where the page faults of SVM vectors land. vector_add_svm maps A and B
+   with CL_MAP_WRITE_INVALIDATE_REGION and unmaps them straight away, so on
+   CPU and integrated-GPU runtimes the pages are first touched inside the
+   kernel it times. Each variant below allocates fresh vectors and reports
+   time and getrusage() faults per phase, followed by a second (warm)
+   kernel run:
+
+	cold       map/unmap only, as vector_add_svm
+	prefault   inputs written and C touched on the host before the kernel
+	hugepage   MADV_HUGEPAGE before the prefault (THP must be "madvise"
+	           or "always")
+	node N     mbind to NUMA node N before the prefault; N from
+	           SVM_NUMA_NODE, default 0
+
+   Advice that the kernel refuses (non-NUMA kernel, device-resident SVM)
+   is reported and the variant runs without it. */
+int vector_first_touch(){
+/*Step1-4: Platform, device, context and command queue.*/
+	CLEnv env;
+	if (setupCL(env, 0) != SUCCESS)
+		return FAILURE;
+
+/*Step 5-7: Program and kernel.*/
+	cl_program program = buildProgramFromFile(env, "Kernel.cl", "-cl-std=CL2.0");
+	if (program == NULL)
+	{
+		releaseCL(env);
+		return FAILURE;
+	}
+	cl_kernel kernel = clCreateKernel(program, "vector_add", NULL);
+
+	const char *nodeEnv = getenv("SVM_NUMA_NODE");
+	int node = nodeEnv != NULL ? atoi(nodeEnv) : 0;
+	char nodeName[32];
+	sprintf(nodeName, "node %d", node);
+	cout << "THP: " << transparentHugePageMode() << endl;
+
+	enum Placement { COLD, PREFAULT, HUGEPAGE, BIND };
+	const Placement placements[] = { COLD, PREFAULT, HUGEPAGE, BIND };
+	const char *names[] = { "cold", "prefault", "hugepage", nodeName };
+
+	size_t bytes = (size_t)SIZE * sizeof(float);
+	cl_uint n = SIZE;
+	size_t global_work_size[1] = { (size_t)SIZE };
+
+	for (int v = 0; v < 4; v++)
+	{
+		Placement placement = placements[v];
+		FaultMeter meter(string("\n") + names[v] + ":");
+
+/*Step 8: Allocate and (optionally) advise before anything touches the pages.*/
+		meter.next("alloc");
+		float *A = (float *)clSVMAlloc(env.context, CL_MEM_READ_ONLY, bytes, 0);
+		float *B = (float *)clSVMAlloc(env.context, CL_MEM_READ_ONLY, bytes, 0);
+		float *C = (float *)clSVMAlloc(env.context, CL_MEM_WRITE_ONLY, bytes, 0);
+		if (A == NULL || B == NULL || C == NULL)
+		{
+			cout << "Error: clSVMAlloc failed" << endl;
+			clSVMFree(env.context, A);
+			clSVMFree(env.context, B);
+			clSVMFree(env.context, C);
+			clReleaseKernel(kernel);
+			clReleaseProgram(program);
+			releaseCL(env);
+			return FAILURE;
+		}
+		float *vectors[] = { A, B, C };
+
+		if (placement == HUGEPAGE || placement == BIND)
+		{
+			meter.next("advise");
+			for (int i = 0; i < 3; i++)
+			{
+				int status = placement == HUGEPAGE ? adviseHugePages(vectors[i], bytes)
+				                                   : bindToNode(vectors[i], bytes, node);
+				if (status != SUCCESS)
+				{
+					cout << (placement == HUGEPAGE ? "madvise" : "mbind") << " failed: " << strerror(errno)
+					     << " (running without it)" << endl;
+					break;
+				}
+			}
+		}
+
+/*Step 9: Map for writing; only the prefaulting variants touch the pages.*/
+		meter.next("map/touch");
+		for (int i = 0; i < 3; i++)
+			clEnqueueSVMMap(env.commandQueue, CL_TRUE, CL_MAP_WRITE_INVALIDATE_REGION, vectors[i], bytes, 0, NULL, NULL);
+		if (placement != COLD)
+		{
+			for (int i = 0; i < SIZE; i++)
+			{
+				A[i] = 1.0f;
+				B[i] = 2.0f;
+			}
+			prefaultPages(C, bytes);
+		}
+		for (int i = 0; i < 3; i++)
+			clEnqueueSVMUnmap(env.commandQueue, vectors[i], 0, NULL, NULL);
+		clFinish(env.commandQueue);
+
+/*Step 10: The same kernel twice: first touch (for cold) and warm.*/
+		clSetKernelArgSVMPointer(kernel, 0, A);
+		clSetKernelArgSVMPointer(kernel, 1, B);
+		clSetKernelArgSVMPointer(kernel, 2, C);
+		clSetKernelArg(kernel, 3, sizeof(cl_uint), &n);
+		meter.next("kernel (first)");
+		clEnqueueNDRangeKernel(env.commandQueue, kernel, 1, NULL, global_work_size, NULL, 0, NULL, NULL);
+		clFinish(env.commandQueue);
+		meter.next("kernel (warm)");
+		clEnqueueNDRangeKernel(env.commandQueue, kernel, 1, NULL, global_work_size, NULL, 0, NULL, NULL);
+		clFinish(env.commandQueue);
+
+		meter.next("free");
+		for (int i = 0; i < 3; i++)
+			clSVMFree(env.context, vectors[i]);
+		meter.report();
+	}
+
+/*Step 11: Clean the resources.*/
+	clReleaseKernel(kernel);
+	clReleaseProgram(program);
+	releaseCL(env);
+	return SUCCESS;
+}
+
+
+
+/* vector_add bandwidth under each NUMA placement policy (common/Numa.hpp).
+   Vectors are page-aligned host allocations wrapped with
+   CL_MEM_USE_HOST_PTR, so placement is decided by the host's first touch:
+   single-thread, interleaved, partitioned per node, and partitioned with
+   the device fissioned per node so each sub-device adds its own slice.
+   Bandwidth counts three vectors per run (two reads, one write). */
+int vector_numa(){
+/*Step1-4: Platform, device, context and command queue.*/
+	CLEnv env;
+	if (setupCL(env, 0) != SUCCESS)
+		return FAILURE;
+
+	NumaTopology topo = NumaTopology::detect();
+	cl_device_type type;
+	clGetDeviceInfo(env.device(), CL_DEVICE_TYPE, sizeof(type), &type, NULL);
+	cout << topo.size() << " NUMA node(s)" << endl;
+
+	std::vector<cl_device_id> subDevices;
+	if (type & CL_DEVICE_TYPE_CPU)
+	{
+		cl_int status = createNumaSubDevices(env.device(), subDevices);
+		if (status != CL_SUCCESS)
+			cout << "Device fission by NUMA domain not supported, status: " << status << endl;
+		else if (subDevices.size() != topo.size())
+			cout << "Note: " << subDevices.size() << " sub-devices for " << topo.size() << " nodes" << endl;
+	}
+	else
+		cout << "Not a CPU device: placement only affects host-side traffic, no fission" << endl;
+
+	const int RUNS = 5;
+	size_t bytes = (size_t)SIZE * sizeof(float);
+	int isSuccess = SUCCESS;
+	const NumaPolicy policies[] = { NUMA_SINGLE, NUMA_INTERLEAVE, NUMA_PARTITIONED, NUMA_PARTITIONED };
+
+	cout << fixed << setprecision(3);
+	for (int v = 0; v < 4; v++)
+	{
+		NumaPolicy policy = policies[v];
+		bool fission = v == 3;
+		if (fission && subDevices.empty())
+			continue;
+
+/*Step 5-7: Context (whole device or its sub-devices), program and kernel.*/
+		std::vector<cl_device_id> devices(1, env.device());
+		if (fission)
+			devices = subDevices;
+		cl_int status = CL_SUCCESS;
+		cl_context context = env.context;
+		std::vector<cl_command_queue> queues;
+		if (fission)
+		{
+			context = clCreateContext(NULL, (cl_uint)devices.size(), &devices[0], NULL, NULL, &status);
+			for (size_t d = 0; d < devices.size() && status == CL_SUCCESS; d++)
+			{
+				cl_command_queue queue = clCreateCommandQueue(context, devices[d], 0, &status);
+				if (status == CL_SUCCESS)
+					queues.push_back(queue);
+			}
+			if (status != CL_SUCCESS)
+				cout << "Error: creating the sub-device context and queues, status: " << status << endl;
+		}
+		else
+			queues.push_back(env.commandQueue);
+
+		cl_program program = NULL;
+		cl_kernel kernel = NULL;
+		std::string sourceStr;
+		bool built = status == CL_SUCCESS && readKernelSource("Kernel.cl", sourceStr) == SUCCESS;
+		if (built)
+		{
+			const char *source = sourceStr.c_str();
+			size_t sourceSize[] = { sourceStr.size() };
+			program = clCreateProgramWithSource(context, 1, &source, sourceSize, &status);
+			if (status == CL_SUCCESS)
+				status = clBuildProgram(program, (cl_uint)devices.size(), &devices[0], NULL, NULL, NULL);
+			if (status == CL_SUCCESS)
+				kernel = clCreateKernel(program, "vector_add", &status);
+			built = status == CL_SUCCESS;
+			if (!built)
+				cout << "Error: building vector_add, status: " << status << endl;
+		}
+		if (!built)
+		{
+			if (kernel != NULL)
+				clReleaseKernel(kernel);
+			if (program != NULL)
+				clReleaseProgram(program);
+			for (size_t d = 0; fission && d < queues.size(); d++)
+				clReleaseCommandQueue(queues[d]);
+			if (fission && context != NULL)
+				clReleaseContext(context);
+			isSuccess = FAILURE;
+			break;
+		}
+
+/*Step 8: Allocate, place by policy on first touch, wrap in buffers.*/
+		float *a = (float *)alignedHostAlloc(bytes);
+		float *b = (float *)alignedHostAlloc(bytes);
+		float *c = (float *)alignedHostAlloc(bytes);
+		std::vector<std::pair<void *, size_t> > regions;
+		regions.push_back(std::make_pair((void *)a, bytes));
+		regions.push_back(std::make_pair((void *)b, bytes));
+		regions.push_back(std::make_pair((void *)c, bytes));
+
+		auto start_time = chrono::high_resolution_clock::now();
+		numaFirstTouch(policy, topo, SIZE, regions, [&](size_t begin, size_t end) {
+			for (size_t i = begin; i < end; i++)
+			{
+				a[i] = 1.0f;
+				b[i] = 2.0f;
+				c[i] = 0.0f;
+			}
+		});
+		chrono::duration<double> initSeconds = chrono::high_resolution_clock::now() - start_time;
+
+		cl_mem Buffer_A = clCreateBuffer(context, CL_MEM_READ_ONLY | CL_MEM_USE_HOST_PTR, bytes, a, NULL);
+		cl_mem Buffer_B = clCreateBuffer(context, CL_MEM_READ_ONLY | CL_MEM_USE_HOST_PTR, bytes, b, NULL);
+		cl_mem Buffer_C = clCreateBuffer(context, CL_MEM_WRITE_ONLY | CL_MEM_USE_HOST_PTR, bytes, c, NULL);
+		clSetKernelArg(kernel, 0, sizeof(cl_mem), &Buffer_A);
+		clSetKernelArg(kernel, 1, sizeof(cl_mem), &Buffer_B);
+		clSetKernelArg(kernel, 2, sizeof(cl_mem), &Buffer_C);
+
+/*Step 9: One warm-up and RUNS timed runs; with fission, sub-device d adds
+  numaSlice d through a global offset (the kernel's grid-stride loop then
+  stays inside [offset, offset + size)).*/
+		auto runOnce = [&]() {
+			for (size_t d = 0; d < queues.size(); d++)
+			{
+				size_t begin = 0, end = SIZE;
+				if (fission)
+					numaSlice(SIZE, queues.size(), d, begin, end);
+				if (end == begin)
+					continue;
+				cl_uint limit = (cl_uint)end;
+				size_t offset[1] = { begin };
+				size_t global_work_size[1] = { end - begin };
+				clSetKernelArg(kernel, 3, sizeof(cl_uint), &limit);
+				clEnqueueNDRangeKernel(queues[d], kernel, 1, offset, global_work_size, NULL, 0, NULL, NULL);
+				clFlush(queues[d]);
+			}
+			for (size_t d = 0; d < queues.size(); d++)
+				clFinish(queues[d]);
+		};
+		runOnce();
+		start_time = chrono::high_resolution_clock::now();
+		for (int run = 0; run < RUNS; run++)
+			runOnce();
+		chrono::duration<double> seconds = chrono::high_resolution_clock::now() - start_time;
+		double perRun = seconds.count() / RUNS;
+
+		float *C = (float *)clEnqueueMapBuffer(queues[0], Buffer_C, CL_TRUE, CL_MAP_READ, 0, bytes, 0, NULL, NULL, &status);
+		bool correct = true;
+		for (int i = 0; i < SIZE && correct; i += 997)
+			correct = C[i] == 3.0f;
+		correct = correct && C[SIZE - 1] == 3.0f;
+		clEnqueueUnmapMemObject(queues[0], Buffer_C, C, 0, NULL, NULL);
+		clFinish(queues[0]);
+
+		cout << setw(24) << (string(numaPolicyName(policy)) + (fission ? " + fission" : ""))
+		     << "  init " << setw(8) << initSeconds.count() << " s  kernel " << setw(8) << perRun * 1e3 << " ms  "
+		     << setw(8) << 3.0 * bytes / perRun * 1e-9 << " GB/s"
+		     << (correct ? "" : "  MISMATCH") << endl;
+		if (!correct)
+			isSuccess = FAILURE;
+
+/*Step 10: Clean the resources.*/
+		clReleaseMemObject(Buffer_A);
+		clReleaseMemObject(Buffer_B);
+		clReleaseMemObject(Buffer_C);
+		clReleaseKernel(kernel);
+		clReleaseProgram(program);
+		if (fission)
+		{
+			for (size_t d = 0; d < queues.size(); d++)
+				clReleaseCommandQueue(queues[d]);
+			clReleaseContext(context);
+		}
+		free(a);
+		free(b);
+		free(c);
+	}
+	cout.unsetf(ios::fixed);
+
+	for (size_t d = 0; d < subDevices.size(); d++)
+		clReleaseDevice(subDevices[d]);
+	releaseCL(env);
+	return isSuccess;
+}
+
+SVM_BENCH_NAMESPACE_END
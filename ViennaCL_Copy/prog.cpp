@@ -27,11 +27,17 @@ THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
 #include <chrono>
 #include <exception>
 
-#include "/home/ctchao/ViennaCLPP/viennacl/tools/timer.hpp"
+#include "../common/CLSetup.hpp"
+#include "../common/Roofline.hpp"
+#include "../common/BenchmarkRegistry.hpp"
+
+#include "viennacl/tools/timer.hpp"
 
 #define SUCCESS 0
 #define FAILURE 1
 
+SVM_BENCH_NAMESPACE_BEGIN(copy)
+
 using namespace std;
 
 int Mdim = 100000000;
@@ -67,81 +73,58 @@ int convertToString(const char *filename, std::string& s)
 	return FAILURE;
 }
 
-void GEMV_svm();
-void GEMV_non_svm();
+int GEMV_svm();
+int GEMV_non_svm();
+int GEMV_host_ptr();
 
 
-int main(int argc, char* argv[])
+#ifdef SVM_BENCH_DRIVER
+static BenchmarkRegistrar registrar(Benchmark("Copy", "ViennaCL_Copy")
+	.mode("svm", GEMV_svm)
+	.mode("non_svm", GEMV_non_svm)
+	.mode("host_ptr", GEMV_host_ptr));
+#else
+int main()
 {
- 
+  int isSuccess = SUCCESS;
+
   std::cout << "SVM \n------------------------------ \n" << std::endl;
   {
-    GEMV_svm();
+    if (GEMV_svm() != SUCCESS)
+      isSuccess = FAILURE;
   }
   
   
   std::cout << "\n\n" << "Non-SVM \n------------------------------ " << std::endl;
   {
-    GEMV_non_svm();
+    if (GEMV_non_svm() != SUCCESS)
+      isSuccess = FAILURE;
+  }
+  
+  
+  std::cout << "\n\n" << "Host-Ptr \n------------------------------ " << std::endl;
+  {
+    if (GEMV_host_ptr() != SUCCESS)
+      isSuccess = FAILURE;
   }
-}
-
-
 
-void GEMV_svm(){
-/*Step1: Getting platforms and choose an available one.*/
-	cl_uint numPlatforms;	//the NO. of platforms
-	cl_platform_id platform = NULL;	//the chosen platform
-	cl_int	status = clGetPlatformIDs(0, NULL, &numPlatforms);
-	if (status != CL_SUCCESS)
-	{
-		cout << "Error: Getting platforms!" << endl;
-	}
+  Roofline::instance().report();
+  Roofline::instance().exportCsv("roofline.csv");
+  return isSuccess;
+}
+#endif
 
-	/*For clarity, choose the first available platform. */
-	if(numPlatforms > 0)
-	{
-		cl_platform_id* platforms = (cl_platform_id* )malloc(numPlatforms* sizeof(cl_platform_id));
-		status = clGetPlatformIDs(numPlatforms, platforms, NULL);
-		platform = platforms[0];
-		free(platforms);
-	}
 
-/*Step 2:Query the platform and choose the first GPU device if has one.Otherwise use the CPU as device.*/
-	cl_uint				numDevices = 0;
-	cl_device_id        *devices;
-	status = clGetDeviceIDs(platform, CL_DEVICE_TYPE_GPU, 0, NULL, &numDevices);	
-	if (numDevices == 0)	//no GPU available.
-	{
-		cout << "No GPU device available." << endl;
-		cout << "Choose CPU as default device." << endl;
-		status = clGetDeviceIDs(platform, CL_DEVICE_TYPE_CPU, 0, NULL, &numDevices);	
-		devices = (cl_device_id*)malloc(numDevices * sizeof(cl_device_id));
-		status = clGetDeviceIDs(platform, CL_DEVICE_TYPE_CPU, numDevices, devices, NULL);
-	}
-	else
-	{
-		devices = (cl_device_id*)malloc(numDevices * sizeof(cl_device_id));
-		status = clGetDeviceIDs(platform, CL_DEVICE_TYPE_GPU, numDevices, devices, NULL);
-	}
-	
 
-/*Step 3: Create context.*/
-	cl_context context = clCreateContext(NULL,1, devices,NULL,NULL,NULL);
-	
-/*Step 4: Creating command queue associate with the context.*/
-	/*old func. code
-		cl_command_queue commandQueue = clCreateCommandQueue(context, devices[0], 0, NULL);
-    	*/
-	/*new func.
-    	*	cl_command_queue clCreateCommandQueueWithProperties(
-			cl_context context, 
-			cl_device_id device, 
-			const cl_queue_properties *properties, 
-			cl_int *errcode_ret)
-	*/
-	//cl_command_queue commandQueue = clCreateCommandQueueWithProperties(context, devices[0], 0, NULL);
-	cl_command_queue commandQueue = clCreateCommandQueue(context, devices[0], CL_QUEUE_PROFILING_ENABLE, NULL);
+int GEMV_svm(){
+/*Step1-4: Platform, device, context and command queue.*/
+	CLEnv env;
+	if (setupCL(env) != SUCCESS)
+		return FAILURE;
+	cl_device_id *devices = env.devices;
+	cl_context context = env.context;
+	cl_command_queue commandQueue = env.commandQueue;
+	cl_int status = CL_SUCCESS;
 
 /*Step 5: Create program object */
 	const char *filename = "Kernel.cl";
@@ -154,6 +137,13 @@ void GEMV_svm(){
 /*Step 6: Build program. */
 	const char options[] = "-cl-std=CL2.0";
 	status = clBuildProgram(program, 1,devices, options,NULL,NULL);
+	if (status != CL_SUCCESS)
+	{
+		cout << "Error: building " << filename << " failed, status: " << status << endl;
+		clReleaseProgram(program);
+		releaseCL(env);
+		return FAILURE;
+	}
 
 /*Step 7: Create kernel object */
 	cl_kernel kernel = clCreateKernel(program, "av_cpu", NULL);
@@ -200,11 +190,13 @@ auto start_time = chrono::high_resolution_clock::now();
 	size_t global_work_size[1] = {16384};
   size_t local_work_size[1] = {128};
   
-	status = clEnqueueNDRangeKernel(commandQueue, kernel, 1, NULL, global_work_size, local_work_size, 0, NULL, NULL);
+	cl_event kernelEvent;
+	status = clEnqueueNDRangeKernel(commandQueue, kernel, 1, NULL, global_work_size, local_work_size, 0, NULL, &kernelEvent);
 
 auto end_time = chrono::high_resolution_clock::now();
 chrono::duration<double> time_duration = end_time-start_time;
 cout << "SVM vector_copy takes: " << time_duration.count() << " s" <<endl;
+	Roofline::instance().recordEvent("av_cpu", "SVM", (double)Mdim, 2.0 * Mdim * sizeof(float), kernelEvent);
   
   status = clEnqueueSVMMap(commandQueue, CL_TRUE, CL_MAP_WRITE_INVALIDATE_REGION, A, szA * sizeof(int), 0, NULL, NULL); 
 
@@ -247,8 +239,7 @@ cout << "SVM vector_copy takes: " << time_duration.count() << " s" <<endl;
   clSVMFree(context, B); 
 	status = clReleaseKernel(kernel);				//Release kernel.
 	status = clReleaseProgram(program);				//Release the program object.
-	status = clReleaseCommandQueue(commandQueue);	//Release  Command queue.
-	status = clReleaseContext(context);				//Release context.
+	releaseCL(env);
 
 	if (a != NULL)
 	{
@@ -256,63 +247,22 @@ cout << "SVM vector_copy takes: " << time_duration.count() << " s" <<endl;
 		a = NULL;
 	}
 
-	if (devices != NULL)
-	{
-		free(devices);
-		devices = NULL;
-	}
-
 	cout<<"Program passed!\n";
-
+	return SUCCESS;
 }
 
 
 
-void GEMV_non_svm(){
-
-/*Step1: Getting platforms and choose an available one.*/
-	cl_uint numPlatforms; //the NO. of platforms
-	cl_platform_id platform = NULL; //the chosen platform
-	cl_int status = clGetPlatformIDs(0, NULL, &numPlatforms);
-	if (status != CL_SUCCESS)
-	{
-		cout << "Error: Getting platforms!" << endl;
-	}
-
-	/*For clarity, choose the first available platform. */
-	if (numPlatforms > 0)
-	{
-		cl_platform_id* platforms = 
-                     (cl_platform_id*)malloc(numPlatforms * sizeof(cl_platform_id));
-		status = clGetPlatformIDs(numPlatforms, platforms, NULL);
-		platform = platforms[0];
-		free(platforms);
-	}
-
-	/*Step 2:Query the platform and choose the first GPU device if has one.Otherwise use the CPU as device.*/
-	cl_uint numDevices = 0;
-	cl_device_id        *devices;
-	status = clGetDeviceIDs(platform, CL_DEVICE_TYPE_GPU, 0, NULL, &numDevices);
-	if (numDevices == 0) //no GPU available.
-	{
-		cout << "No GPU device available." << endl;
-		cout << "Choose CPU as default device." << endl;
-		status = clGetDeviceIDs(platform, CL_DEVICE_TYPE_CPU, 0, NULL, &numDevices);
-		devices = (cl_device_id*)malloc(numDevices * sizeof(cl_device_id));
-		status = clGetDeviceIDs(platform, CL_DEVICE_TYPE_CPU, numDevices, devices, NULL);
-	}
-	else
-	{
-		devices = (cl_device_id*)malloc(numDevices * sizeof(cl_device_id));
-		status = clGetDeviceIDs(platform, CL_DEVICE_TYPE_GPU, numDevices, devices, NULL);
-	}
-
-
-	/*Step 3: Create context.*/
-	cl_context context = clCreateContext(NULL, 1, devices, NULL, NULL, NULL);
+int GEMV_non_svm(){
 
-	/*Step 4: Creating command queue associate with the context.*/
-	cl_command_queue commandQueue = clCreateCommandQueue(context, devices[0], CL_QUEUE_PROFILING_ENABLE, NULL);
+/*Step1-4: Platform, device, context and command queue.*/
+	CLEnv env;
+	if (setupCL(env) != SUCCESS)
+		return FAILURE;
+	cl_device_id *devices = env.devices;
+	cl_context context = env.context;
+	cl_command_queue commandQueue = env.commandQueue;
+	cl_int status = CL_SUCCESS;
 
 	/*Step 5: Create program object */
 	const char *filename = "Kernel.cl";
@@ -324,6 +274,13 @@ void GEMV_non_svm(){
 
 	/*Step 6: Build program. */
 	status = clBuildProgram(program, 1, devices, NULL, NULL, NULL);
+	if (status != CL_SUCCESS)
+	{
+		cout << "Error: building " << filename << " failed, status: " << status << endl;
+		clReleaseProgram(program);
+		releaseCL(env);
+		return FAILURE;
+	}
 
 	/*Step 7: Initial input,output for the host and create memory objects for the kernel*/
 	int szA = Mdim;
@@ -367,7 +324,9 @@ void GEMV_non_svm(){
 	size_t global_work_size[1] = {16384};
   size_t local_work_size[1] = {128};
   
-	status = clEnqueueNDRangeKernel(commandQueue, kernel, 1, NULL, global_work_size, local_work_size, 0, NULL, NULL);
+	cl_event kernelEvent;
+	status = clEnqueueNDRangeKernel(commandQueue, kernel, 1, NULL, global_work_size, local_work_size, 0, NULL, &kernelEvent);
+	Roofline::instance().recordEvent("av_cpu", "Non-SVM", (double)Mdim, 2.0 * Mdim * sizeof(float), kernelEvent);
   
 	/*Step 11: Read the cout put back to host memory.*/
   
@@ -413,8 +372,7 @@ void GEMV_non_svm(){
 	status = clReleaseProgram(program); //Release the program object.
 	status = clReleaseMemObject(Buffer_A); //Release mem object.
   status = clReleaseMemObject(Buffer_B);
-	status = clReleaseCommandQueue(commandQueue); //Release  Command queue.
-	status = clReleaseContext(context); //Release context.
+	releaseCL(env);
 
 	if (A != NULL)
 	{
@@ -422,12 +380,96 @@ void GEMV_non_svm(){
 		A = NULL;
 	}
 
-	if (devices != NULL)
+	std::cout << "\nPassed!\n";
+	return SUCCESS;
+}
+
+
+
+int GEMV_host_ptr(){
+
+/*Step1-4: Platform, device, context and command queue.*/
+	CLEnv env;
+	if (setupCL(env) != SUCCESS)
+		return FAILURE;
+
+/*Step 5-6: Create and build program. */
+	cl_program program = buildProgramFromFile(env, "Kernel.cl", NULL);
+	if (program == NULL)
 	{
-		free(devices);
-		devices = NULL;
+		releaseCL(env);
+		return FAILURE;
 	}
 
+/*Step 7: Create kernel object */
+	cl_int status;
+	cl_kernel kernel = clCreateKernel(program, "av_cpu", NULL);
+
+/*Step 8: Zero-copy buffers. The source B wraps our own page-aligned allocation
+  (CL_MEM_USE_HOST_PTR), the destination A is runtime-allocated host memory
+  (CL_MEM_ALLOC_HOST_PTR). B is written through a map, never copied.*/
+  int szA = Mdim;
+  int szB = Mdim;
+
+  auto start_time = chrono::high_resolution_clock::now();
+
+  float *b = (float *)alignedHostAlloc(szB * sizeof(float));
+
+  cl_mem Buffer_A = clCreateBuffer(env.context, CL_MEM_READ_WRITE | CL_MEM_ALLOC_HOST_PTR, 
+                             szA * sizeof(float), NULL, NULL);
+  cl_mem Buffer_B = clCreateBuffer(env.context, CL_MEM_READ_ONLY | CL_MEM_USE_HOST_PTR, 
+                             szB * sizeof(float), b, NULL);
+
+  float *B = (float *)clEnqueueMapBuffer(env.commandQueue, Buffer_B, CL_TRUE, CL_MAP_WRITE_INVALIDATE_REGION, 
+                             0, szB * sizeof(float), 0, NULL, NULL, &status);
+  if (B != b)
+    cout << "Note: runtime did not map the host pointer in place (copying buffers)" << endl;
+  status = clEnqueueUnmapMemObject(env.commandQueue, Buffer_B, B, 0, NULL, NULL);
+
+/*Step 9: Sets Kernel arguments.*/
+	status = clSetKernelArg(kernel, 0, sizeof(cl_mem), &Buffer_A);
+
+  cl_uint4 size1 = {0, 1, (cl_uint)Mdim, (cl_uint)Mdim};
+  status = clSetKernelArg(kernel, 1, sizeof(cl_uint4), (void*)&size1);
+
+ 	float val = 1.0f;
+  status = clSetKernelArg(kernel, 2, sizeof(float), (void*)&val);
+
+  status = clSetKernelArg(kernel, 3, sizeof(cl_mem), &Buffer_B);
+
+  cl_uint4 size2 = {0, 1, (cl_uint)Mdim, (cl_uint)Mdim};
+  status = clSetKernelArg(kernel, 4, sizeof(cl_uint4), (void*)&size2);
+
+/*Step 10: Running the kernel.*/
+	size_t global_work_size[1] = {16384};
+  size_t local_work_size[1] = {128};
+
+	cl_event kernelEvent;
+	status = clEnqueueNDRangeKernel(env.commandQueue, kernel, 1, NULL, global_work_size, local_work_size, 0, NULL, &kernelEvent);
+	Roofline::instance().recordEvent("av_cpu", "Host-Ptr", (double)Mdim, 2.0 * Mdim * sizeof(float), kernelEvent);
+
+/*Step 11: Map the result instead of reading it back.*/
+  float *A = (float *)clEnqueueMapBuffer(env.commandQueue, Buffer_A, CL_TRUE, CL_MAP_READ, 
+                             0, szA * sizeof(float), 0, NULL, NULL, &status);
+
+  auto end_time = chrono::high_resolution_clock::now();
+  chrono::duration<double> time_duration = end_time-start_time;
+  cout << "Host-Ptr vector_copy takes: " << time_duration.count() << " s" <<endl;
+
+  status = clEnqueueUnmapMemObject(env.commandQueue, Buffer_A, A, 0, NULL, NULL);
+  clFinish(env.commandQueue);
+
+/*Step 12: Clean the resources.*/
+	status = clReleaseKernel(kernel); //Release kernel.
+	status = clReleaseProgram(program); //Release the program object.
+	status = clReleaseMemObject(Buffer_A); //Release mem object.
+  status = clReleaseMemObject(Buffer_B);
+	releaseCL(env);
+
+  free(b);
+
 	std::cout << "\nPassed!\n";
- 
-}
\ No newline at end of file
+	return SUCCESS;
+}
+
+SVM_BENCH_NAMESPACE_END
@@ -0,0 +1,165 @@
+/**********************************************************************
+Benchmark registry for the single driver binary (Driver/).
+
+Every program keeps its own main() for the standalone build. Built with
+-DSVM_BENCH_DRIVER, main() is compiled out, the program's code is moved
+into its own namespace (the programs share global names such as Mdim
+and GEMV_svm) and it registers its modes and parameters instead:
+
+	SVM_BENCH_NAMESPACE_BEGIN(gemm)
+	...
+	#ifdef SVM_BENCH_DRIVER
+	static BenchmarkRegistrar registrar(Benchmark("GEMM", "GEMM")
+		.param("size", "M = N = K", { &Mdim, &Ndim, &Pdim })
+		.mode("svm", MatMul_svm)
+		.mode("non_svm", MatMul_non_svm));
+	#else
+	int main(int argc, char* argv[]) { ... }
+	#endif
+	...
+	SVM_BENCH_NAMESPACE_END
+
+The second Benchmark argument is the program's directory: the driver
+changes into it before running a mode, so kernel files load by the same
+relative paths as in the standalone build.
+
+The driver build also counts SVM for --soak: this header, like the
+common headers that allocate SVM, includes common/Telemetry.hpp, which
+routes clSVMAlloc / clSVMFree through SvmAccounting.
+********************************************************************/
+
+#ifndef BENCHMARK_REGISTRY_HPP
+#define BENCHMARK_REGISTRY_HPP
+
+#include <stdlib.h>
+#include <string.h>
+#include <algorithm>
+#include <functional>
+#include <initializer_list>
+#include <string>
+#include <vector>
+
+#ifndef SUCCESS
+#define SUCCESS 0
+#define FAILURE 1
+#endif
+
+#ifdef SVM_BENCH_DRIVER
+#include "Telemetry.hpp"
+#define SVM_BENCH_NAMESPACE_BEGIN(name) namespace name {
+#define SVM_BENCH_NAMESPACE_END }
+#else
+#define SVM_BENCH_NAMESPACE_BEGIN(name)
+#define SVM_BENCH_NAMESPACE_END
+#endif
+
+struct BenchmarkMode
+{
+	std::string name;
+	std::function<int()> run;   // SUCCESS or FAILURE
+};
+
+/* A settable program global (sizes, iteration counts). */
+struct BenchmarkParam
+{
+	std::string name;
+	std::string description;
+	std::function<std::string()> get;
+	std::function<void(const std::string &)> set;
+};
+
+struct Benchmark
+{
+	std::string name;
+	std::string directory;
+	std::vector<BenchmarkMode> modes;
+	std::vector<BenchmarkParam> params;
+
+	Benchmark(const std::string &benchmarkName, const std::string &dir) : name(benchmarkName), directory(dir) {}
+
+	Benchmark &mode(const std::string &modeName, int (*fn)())
+	{
+		BenchmarkMode m = { modeName, fn };
+		modes.push_back(m);
+		return *this;
+	}
+
+	Benchmark &param(const std::string &paramName, const std::string &description, int *value)
+	{
+		BenchmarkParam p = { paramName, description,
+		                     [value]() { return std::to_string(*value); },
+		                     [value](const std::string &s) { *value = atoi(s.c_str()); } };
+		params.push_back(p);
+		return *this;
+	}
+
+	/* one parameter setting several globals that must stay equal */
+	Benchmark &param(const std::string &paramName, const std::string &description, std::initializer_list<int *> values)
+	{
+		std::vector<int *> tied(values);
+		BenchmarkParam p = { paramName, description,
+		                     [tied]() { return std::to_string(*tied[0]); },
+		                     [tied](const std::string &s) { for (size_t i = 0; i < tied.size(); i++) *tied[i] = atoi(s.c_str()); } };
+		params.push_back(p);
+		return *this;
+	}
+
+	Benchmark &param(const std::string &paramName, const std::string &description, bool *value)
+	{
+		BenchmarkParam p = { paramName, description,
+		                     [value]() { return std::string(*value ? "true" : "false"); },
+		                     [value](const std::string &s) { *value = s == "1" || s == "true" || s == "all"; } };
+		params.push_back(p);
+		return *this;
+	}
+
+	BenchmarkParam *findParam(const std::string &paramName)
+	{
+		for (size_t i = 0; i < params.size(); i++)
+			if (params[i].name == paramName)
+				return &params[i];
+		return NULL;
+	}
+};
+
+class BenchmarkRegistry
+{
+public:
+	static BenchmarkRegistry &instance()
+	{
+		static BenchmarkRegistry registry;
+		return registry;
+	}
+
+	void add(const Benchmark &benchmark) { benchmarks_.push_back(benchmark); }
+
+	/* sorted by name, so the run order does not depend on link order */
+	std::vector<Benchmark> &benchmarks()
+	{
+		std::sort(benchmarks_.begin(), benchmarks_.end(),
+		          [](const Benchmark &a, const Benchmark &b) { return a.name < b.name; });
+		return benchmarks_;
+	}
+
+	Benchmark *find(const std::string &name)
+	{
+		for (size_t i = 0; i < benchmarks_.size(); i++)
+			if (benchmarks_[i].name == name)
+				return &benchmarks_[i];
+		return NULL;
+	}
+
+private:
+	BenchmarkRegistry() {}
+	std::vector<Benchmark> benchmarks_;
+};
+
+struct BenchmarkRegistrar
+{
+	explicit BenchmarkRegistrar(const Benchmark &benchmark)
+	{
+		BenchmarkRegistry::instance().add(benchmark);
+	}
+};
+
+#endif
@@ -0,0 +1,279 @@
+/**********************************************************************
+Shared OpenCL setup for the comparison programs.
+
+setupCL() performs Steps 1-4 of every program (first platform, first GPU
+or else the CPU, context, profiling command queue) and
+buildProgramFromFile(s)() performs Steps 5-6. The benchmark modes use
+these instead of repeating the boilerplate; error checking follows the
+programs: print and return FAILURE.
+
+Including it also routes the programs' clEnqueue* calls through the
+SVM_TRACE timeline recorder (Trace.hpp).
+********************************************************************/
+
+#ifndef CL_SETUP_HPP
+#define CL_SETUP_HPP
+
+#include <CL/cl.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <iostream>
+#include <fstream>
+#include <iterator>
+#include <string>
+#include <vector>
+
+#include "Trace.hpp"
+
+#ifndef SUCCESS
+#define SUCCESS 0
+#define FAILURE 1
+#endif
+
+struct CLEnv
+{
+	cl_platform_id   platform;
+	cl_device_id     *devices;
+	cl_uint          numDevices;
+	cl_context       context;
+	cl_command_queue commandQueue;
+
+	CLEnv() : platform(NULL), devices(NULL), numDevices(0), context(NULL), commandQueue(NULL) {}
+
+	cl_device_id device() const { return devices[0]; }
+};
+
+/* Environment shared by every setupCL() call while set; the benchmark
+   driver installs one so all modes run in a single context. */
+inline CLEnv *&sharedCLEnv()
+{
+	static CLEnv *shared = NULL;
+	return shared;
+}
+
+/* Steps 1-4: platform, device (GPU if any, otherwise CPU), context, queue.
+   With a shared environment installed, env gets retained references to
+   its context and, if it has the requested properties, its queue;
+   otherwise a queue with those properties is created in the shared
+   context. releaseCL() drops them. */
+inline int setupCL(CLEnv &env, cl_command_queue_properties properties = CL_QUEUE_PROFILING_ENABLE)
+{
+	if (sharedCLEnv() != NULL)
+	{
+		const CLEnv &shared = *sharedCLEnv();
+		env.platform = shared.platform;
+		env.numDevices = shared.numDevices;
+		env.devices = (cl_device_id *)malloc(env.numDevices * sizeof(cl_device_id));
+		memcpy(env.devices, shared.devices, env.numDevices * sizeof(cl_device_id));
+		env.context = shared.context;
+		clRetainContext(env.context);
+
+		cl_command_queue_properties sharedProperties = 0;
+		clGetCommandQueueInfo(shared.commandQueue, CL_QUEUE_PROPERTIES, sizeof(sharedProperties), &sharedProperties, NULL);
+		if (sharedProperties == properties)
+		{
+			env.commandQueue = shared.commandQueue;
+			clRetainCommandQueue(env.commandQueue);
+			return SUCCESS;
+		}
+		cl_int status;
+		env.commandQueue = clCreateCommandQueue(env.context, env.devices[0], properties, &status);
+		if (status != CL_SUCCESS)
+		{
+			std::cout << "Error: clCreateCommandQueue, status: " << status << std::endl;
+			return FAILURE;
+		}
+		return SUCCESS;
+	}
+
+	cl_uint numPlatforms;
+	cl_int status = clGetPlatformIDs(0, NULL, &numPlatforms);
+	if (status != CL_SUCCESS || numPlatforms == 0)
+	{
+		std::cout << "Error: Getting platforms!" << std::endl;
+		return FAILURE;
+	}
+	std::vector<cl_platform_id> platforms(numPlatforms);
+	status = clGetPlatformIDs(numPlatforms, &platforms[0], NULL);
+	env.platform = platforms[0];
+
+	cl_device_type type = CL_DEVICE_TYPE_GPU;
+	status = clGetDeviceIDs(env.platform, type, 0, NULL, &env.numDevices);
+	if (env.numDevices == 0)
+	{
+		std::cout << "No GPU device available." << std::endl;
+		std::cout << "Choose CPU as default device." << std::endl;
+		type = CL_DEVICE_TYPE_CPU;
+		status = clGetDeviceIDs(env.platform, type, 0, NULL, &env.numDevices);
+	}
+	if (env.numDevices == 0)
+	{
+		std::cout << "Error: no OpenCL device found!" << std::endl;
+		return FAILURE;
+	}
+	env.devices = (cl_device_id *)malloc(env.numDevices * sizeof(cl_device_id));
+	status = clGetDeviceIDs(env.platform, type, env.numDevices, env.devices, NULL);
+
+	env.context = clCreateContext(NULL, 1, env.devices, NULL, NULL, &status);
+	if (status != CL_SUCCESS)
+	{
+		std::cout << "Error: clCreateContext, status: " << status << std::endl;
+		return FAILURE;
+	}
+
+	env.commandQueue = clCreateCommandQueue(env.context, env.devices[0], properties, &status);
+	if (status != CL_SUCCESS)
+	{
+		std::cout << "Error: clCreateCommandQueue, status: " << status << std::endl;
+		return FAILURE;
+	}
+	return SUCCESS;
+}
+
+inline void releaseCL(CLEnv &env)
+{
+	if (env.commandQueue != NULL)
+		clReleaseCommandQueue(env.commandQueue);
+	if (env.context != NULL)
+		clReleaseContext(env.context);
+	free(env.devices);
+	env = CLEnv();
+}
+
+/* read a kernel file into a string */
+inline int readKernelSource(const char *filename, std::string &s)
+{
+	std::ifstream f(filename, std::ios::in | std::ios::binary);
+	if (!f.is_open())
+	{
+		std::cout << "Error: failed to open file\n:" << filename << std::endl;
+		return FAILURE;
+	}
+	s.assign((std::istreambuf_iterator<char>(f)), std::istreambuf_iterator<char>());
+	return SUCCESS;
+}
+
+/* Steps 5-6: create and build a program from one or more source files,
+   concatenated in order (e.g. a shared struct header followed by the
+   kernels); prints the build log on failure. */
+inline cl_program buildProgramFromFiles(CLEnv &env, const char **filenames, int count, const char *options)
+{
+	std::vector<std::string> sourceStrs(count);
+	std::vector<const char *> sources(count);
+	std::vector<size_t> sourceSizes(count);
+	for (int i = 0; i < count; i++)
+	{
+		if (readKernelSource(filenames[i], sourceStrs[i]) != SUCCESS)
+			return NULL;
+		sources[i] = sourceStrs[i].c_str();
+		sourceSizes[i] = sourceStrs[i].size();
+	}
+
+	cl_int status;
+	cl_program program = clCreateProgramWithSource(env.context, count, &sources[0], &sourceSizes[0], &status);
+	status = clBuildProgram(program, 1, env.devices, options, NULL, NULL);
+	if (status != CL_SUCCESS)
+	{
+		size_t logSize = 0;
+		clGetProgramBuildInfo(program, env.devices[0], CL_PROGRAM_BUILD_LOG, 0, NULL, &logSize);
+		std::string log(logSize, '\0');
+		clGetProgramBuildInfo(program, env.devices[0], CL_PROGRAM_BUILD_LOG, logSize, &log[0], NULL);
+		std::cout << "Error: building " << filenames[count - 1] << " failed, status: " << status << "\n" << log << std::endl;
+		clReleaseProgram(program);
+		return NULL;
+	}
+	return program;
+}
+
+inline cl_program buildProgramFromFile(CLEnv &env, const char *filename, const char *options)
+{
+	return buildProgramFromFiles(env, &filename, 1, options);
+}
+
+/* Execution time of a completed command; the queue needs
+   CL_QUEUE_PROFILING_ENABLE (the setupCL() default). */
+inline double eventSeconds(cl_event event)
+{
+	cl_ulong start, end;
+	clGetEventProfilingInfo(event, CL_PROFILING_COMMAND_START, sizeof(cl_ulong), &start, NULL);
+	clGetEventProfilingInfo(event, CL_PROFILING_COMMAND_END, sizeof(cl_ulong), &end, NULL);
+	return (end - start) * 1e-9;
+}
+
+/* Average kernel time over runs launches after one warm-up launch. */
+inline double timeKernel(cl_command_queue queue, cl_kernel kernel, cl_uint dims,
+                         const size_t *global, const size_t *local, int runs)
+{
+	double seconds = 0.0;
+	for (int run = 0; run <= runs; run++)
+	{
+		cl_event event;
+		clEnqueueNDRangeKernel(queue, kernel, dims, NULL, global, local, 0, NULL, &event);
+		clWaitForEvents(1, &event);
+		if (run > 0)
+			seconds += eventSeconds(event);
+		clReleaseEvent(event);
+	}
+	return seconds / runs;
+}
+
+/* Whether the device takes a width x height image2d; prints why not.
+   Check before building a program that uses images, which fails to
+   build on devices without image support. */
+inline bool imageSupport(CLEnv &env, size_t width, size_t height)
+{
+	cl_bool images = CL_FALSE;
+	size_t maxWidth = 0, maxHeight = 0;
+	clGetDeviceInfo(env.device(), CL_DEVICE_IMAGE_SUPPORT, sizeof(images), &images, NULL);
+	clGetDeviceInfo(env.device(), CL_DEVICE_IMAGE2D_MAX_WIDTH, sizeof(maxWidth), &maxWidth, NULL);
+	clGetDeviceInfo(env.device(), CL_DEVICE_IMAGE2D_MAX_HEIGHT, sizeof(maxHeight), &maxHeight, NULL);
+	if (!images || width > maxWidth || height > maxHeight)
+	{
+		std::cout << "No image support for a " << width << "x" << height << " image2d (device limit "
+		          << maxWidth << "x" << maxHeight << ")" << std::endl;
+		return false;
+	}
+	return true;
+}
+
+/* width x height image of one signed 32-bit channel, read in a kernel as
+   read_imagei(image, sampler, (int2)(x, y)).x; NULL (with a message) when
+   imageSupport() fails or clCreateImage does. */
+inline cl_mem createIntImage2D(CLEnv &env, cl_mem_flags flags, size_t width, size_t height, cl_int *status)
+{
+	if (!imageSupport(env, width, height))
+	{
+		*status = CL_INVALID_IMAGE_SIZE;
+		return NULL;
+	}
+
+	cl_image_format format = { CL_R, CL_SIGNED_INT32 };
+	cl_image_desc desc;
+	memset(&desc, 0, sizeof(desc));
+	desc.image_type = CL_MEM_OBJECT_IMAGE2D;
+	desc.image_width = width;
+	desc.image_height = height;
+	cl_mem image = clCreateImage(env.context, flags, &format, &desc, NULL, status);
+	if (*status != CL_SUCCESS)
+	{
+		std::cout << "Error: clCreateImage, status: " << *status << std::endl;
+		return NULL;
+	}
+	return image;
+}
+
+/* Page-aligned host allocation, size rounded up to a whole cache line, as
+   required for CL_MEM_USE_HOST_PTR to be zero-copy on CPU and integrated
+   GPU runtimes. Release with free(). */
+inline void *alignedHostAlloc(size_t bytes)
+{
+	size_t pageSize = sysconf(_SC_PAGESIZE);
+	size_t rounded = (bytes + 63) & ~(size_t)63;
+	void *ptr = NULL;
+	if (posix_memalign(&ptr, pageSize, rounded) != 0)
+		return NULL;
+	return ptr;
+}
+
+#endif
@@ -0,0 +1,262 @@
+/**********************************************************************
+Elementwise expression templates over float SVM vectors.
+
+Builds a whole chain of elementwise operations on the host and runs it
+as one generated kernel, so each input is read once and the result is
+written once instead of one memory pass per operation:
+
+	ElementwiseEngine engine(env);
+	ew::Vector x(xPtr, n), y(yPtr, n);
+	engine.assign(y, 2.0f * x + 0.5f * y);   // one axpby-shaped pass
+
+Supported: +, -, * and / between vectors and float scalars. Scalars
+become kernel arguments, so the same expression shape with different
+coefficients reuses the compiled kernel; vectors are deduplicated by
+pointer (y on both sides is loaded once). Generated programs are cached
+per source string for the lifetime of the engine.
+
+Byte accounting (Traffic) compares the fused pass with running every
+vector-valued operation as its own kernel through a temporary.
+********************************************************************/
+
+#ifndef ELEMENTWISE_EXPR_HPP
+#define ELEMENTWISE_EXPR_HPP
+
+#include <CL/cl.h>
+#include <stdio.h>
+#include <iostream>
+#include <map>
+#include <string>
+#include <vector>
+#include <type_traits>
+
+#include "CLSetup.hpp"
+
+namespace ew
+{
+
+/* Marker base for everything that can appear in an expression. */
+struct Expr {};
+
+struct Vector : Expr
+{
+	float *ptr;
+	size_t size;
+	Vector(float *p, size_t n) : ptr(p), size(n) {}
+};
+
+struct Scalar : Expr
+{
+	float value;
+	explicit Scalar(float v) : value(v) {}
+};
+
+template <typename L, typename R, char OP>
+struct Binary : Expr
+{
+	L l;
+	R r;
+	Binary(const L &left, const R &right) : l(left), r(right) {}
+};
+
+/* Kernel arguments gathered while generating source. */
+struct Operands
+{
+	std::vector<float *> vectors;
+	std::vector<float> scalars;
+};
+
+/* Memory traffic in elements-per-index (multiply by n * sizeof(float)). */
+struct Traffic
+{
+	int fused;    // distinct vectors read + one write
+	int unfused;  // one read per vector operand + one write, per operation
+};
+
+inline void emit(const Vector &v, Operands &ops, std::string &src)
+{
+	size_t i = 0;
+	while (i < ops.vectors.size() && ops.vectors[i] != v.ptr)
+		i++;
+	if (i == ops.vectors.size())
+		ops.vectors.push_back(v.ptr);
+	char buf[32];
+	sprintf(buf, "v%d[i]", (int)i);
+	src += buf;
+}
+
+inline void emit(const Scalar &s, Operands &ops, std::string &src)
+{
+	char buf[32];
+	sprintf(buf, "s%d", (int)ops.scalars.size());
+	ops.scalars.push_back(s.value);
+	src += buf;
+}
+
+template <typename L, typename R, char OP>
+void emit(const Binary<L, R, OP> &e, Operands &ops, std::string &src)
+{
+	src += "(";
+	emit(e.l, ops, src);
+	src += " ";
+	src += OP;
+	src += " ";
+	emit(e.r, ops, src);
+	src += ")";
+}
+
+/* Whether a subexpression is vector-valued, and the unfused traffic of
+   computing it: every vector-valued operation reads its vector operands
+   (terminals or temporaries) and writes one temporary. */
+inline bool isVector(const Vector &) { return true; }
+inline bool isVector(const Scalar &) { return false; }
+template <typename L, typename R, char OP>
+bool isVector(const Binary<L, R, OP> &e) { return isVector(e.l) || isVector(e.r); }
+
+inline int unfusedTraffic(const Vector &) { return 0; }
+inline int unfusedTraffic(const Scalar &) { return 0; }
+template <typename L, typename R, char OP>
+int unfusedTraffic(const Binary<L, R, OP> &e)
+{
+	int own = isVector(e) ? (int)isVector(e.l) + (int)isVector(e.r) + 1 : 0;
+	return unfusedTraffic(e.l) + unfusedTraffic(e.r) + own;
+}
+
+template <typename E>
+struct IsExpr : std::is_base_of<Expr, E> {};
+
+#define EW_OPERATOR(sym, ch)                                                              \
+	template <typename L, typename R>                                                     \
+	typename std::enable_if<IsExpr<L>::value && IsExpr<R>::value, Binary<L, R, ch> >::type \
+	operator sym(const L &l, const R &r) { return Binary<L, R, ch>(l, r); }                \
+	template <typename R>                                                                 \
+	typename std::enable_if<IsExpr<R>::value, Binary<Scalar, R, ch> >::type               \
+	operator sym(float l, const R &r) { return Binary<Scalar, R, ch>(Scalar(l), r); }      \
+	template <typename L>                                                                 \
+	typename std::enable_if<IsExpr<L>::value, Binary<L, Scalar, ch> >::type               \
+	operator sym(const L &l, float r) { return Binary<L, Scalar, ch>(l, Scalar(r)); }
+
+EW_OPERATOR(+, '+')
+EW_OPERATOR(-, '-')
+EW_OPERATOR(*, '*')
+EW_OPERATOR(/, '/')
+
+#undef EW_OPERATOR
+
+} // namespace ew
+
+
+class ElementwiseEngine
+{
+public:
+	explicit ElementwiseEngine(CLEnv &env) : env_(env) {}
+
+	~ElementwiseEngine()
+	{
+		for (std::map<std::string, Compiled>::iterator it = cache_.begin(); it != cache_.end(); ++it)
+		{
+			clReleaseKernel(it->second.kernel);
+			clReleaseProgram(it->second.program);
+		}
+	}
+
+	/* target = expr in one pass; returns the enqueue status. The target
+	   may also appear in the expression. */
+	template <typename E>
+	cl_int assign(const ew::Vector &target, const E &expr, cl_event *event = NULL)
+	{
+		ew::Operands ops;
+		ops.vectors.push_back(target.ptr);   // v0 is always the output
+		std::string body;
+		ew::emit(expr, ops, body);
+
+		cl_kernel kernel = kernelFor(body, ops);
+		if (kernel == NULL)
+			return CL_INVALID_KERNEL;
+
+		cl_uint arg = 0;
+		for (size_t i = 0; i < ops.vectors.size(); i++)
+			clSetKernelArgSVMPointer(kernel, arg++, ops.vectors[i]);
+		for (size_t i = 0; i < ops.scalars.size(); i++)
+			clSetKernelArg(kernel, arg++, sizeof(float), &ops.scalars[i]);
+		cl_uint n = (cl_uint)target.size;
+		clSetKernelArg(kernel, arg++, sizeof(cl_uint), &n);
+
+		size_t global_work_size[1] = { target.size };
+		return clEnqueueNDRangeKernel(env_.commandQueue, kernel, 1, NULL, global_work_size, NULL, 0, NULL, event);
+	}
+
+	template <typename E>
+	static ew::Traffic traffic(const ew::Vector &target, const E &expr)
+	{
+		ew::Operands ops;
+		ops.vectors.push_back(target.ptr);
+		std::string body;
+		ew::emit(expr, ops, body);
+		bool targetRead = body.find("v0[") != std::string::npos;
+
+		ew::Traffic t;
+		t.fused = (int)ops.vectors.size() - (targetRead ? 0 : 1) + 1;
+		t.unfused = ew::unfusedTraffic(expr);
+		return t;
+	}
+
+	size_t compiledKernels() const { return cache_.size(); }
+
+private:
+	struct Compiled
+	{
+		cl_program program;
+		cl_kernel kernel;
+	};
+
+	static std::string generate(const std::string &body, const ew::Operands &ops)
+	{
+		std::string src = "__kernel void elementwise(__global float* v0";
+		char buf[64];
+		for (size_t i = 1; i < ops.vectors.size(); i++)
+		{
+			sprintf(buf, ", __global const float* v%d", (int)i);
+			src += buf;
+		}
+		for (size_t i = 0; i < ops.scalars.size(); i++)
+		{
+			sprintf(buf, ", const float s%d", (int)i);
+			src += buf;
+		}
+		src += ", const uint n) {\n"
+		       "  for (uint i = get_global_id(0); i < n; i += get_global_size(0))\n"
+		       "    v0[i] = " + body + ";\n"
+		       "}\n";
+		return src;
+	}
+
+	cl_kernel kernelFor(const std::string &body, const ew::Operands &ops)
+	{
+		std::string src = generate(body, ops);
+		std::map<std::string, Compiled>::iterator it = cache_.find(src);
+		if (it != cache_.end())
+			return it->second.kernel;
+
+		const char *source = src.c_str();
+		size_t sourceSize[] = { src.size() };
+		cl_int status;
+		Compiled c;
+		c.program = clCreateProgramWithSource(env_.context, 1, &source, sourceSize, &status);
+		status = clBuildProgram(c.program, 1, env_.devices, "-cl-std=CL2.0", NULL, NULL);
+		if (status != CL_SUCCESS)
+		{
+			std::cout << "Error: building elementwise kernel failed, status: " << status << "\n" << src << std::endl;
+			clReleaseProgram(c.program);
+			return NULL;
+		}
+		c.kernel = clCreateKernel(c.program, "elementwise", NULL);
+		cache_[src] = c;
+		return c.kernel;
+	}
+
+	CLEnv &env_;
+	std::map<std::string, Compiled> cache_;
+};
+
+#endif
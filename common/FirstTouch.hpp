@@ -0,0 +1,154 @@
+/**********************************************************************
+First-touch control and page-fault accounting for host-backed memory.
+
+On CPU devices and integrated GPUs, clSVMAlloc and CL_MEM_ALLOC_HOST_PTR
+memory is ordinary anonymous memory: pages are allocated on first write,
+wherever that write happens (often inside the first timed kernel).
+These helpers make the placement explicit:
+
+	prefaultPages(p, bytes)        write one byte per page now
+	adviseHugePages(p, bytes)      madvise(MADV_HUGEPAGE), before first touch
+	bindToNode(p, bytes, node)     mbind(MPOL_BIND) to one NUMA node, before
+	                               first touch (raw syscall, no libnuma)
+
+Advice is applied to the page-aligned interior of [p, p + bytes). All
+of them return SUCCESS or FAILURE (errno is left for the caller);
+they do nothing useful for memory the runtime keeps on a discrete GPU.
+
+FaultMeter records wall time and getrusage() minor/major faults per
+named phase, for the whole process (all runtime threads included).
+********************************************************************/
+
+#ifndef FIRST_TOUCH_HPP
+#define FIRST_TOUCH_HPP
+
+#include <sys/mman.h>
+#include <sys/resource.h>
+#include <sys/syscall.h>
+#include <linux/mempolicy.h>
+#include <unistd.h>
+#include <stdint.h>
+#include <errno.h>
+#include <iostream>
+#include <iomanip>
+#include <fstream>
+#include <string>
+#include <vector>
+#include <chrono>
+
+#include "Telemetry.hpp"
+
+#ifndef SUCCESS
+#define SUCCESS 0
+#define FAILURE 1
+#endif
+
+/* [begin, end) rounded inward to page boundaries; false if empty */
+inline bool pageInterior(void *p, size_t bytes, uintptr_t &begin, uintptr_t &end)
+{
+	uintptr_t page = (uintptr_t)sysconf(_SC_PAGESIZE);
+	begin = ((uintptr_t)p + page - 1) & ~(page - 1);
+	end = ((uintptr_t)p + bytes) & ~(page - 1);
+	return end > begin;
+}
+
+inline void prefaultPages(void *p, size_t bytes)
+{
+	size_t page = (size_t)sysconf(_SC_PAGESIZE);
+	volatile char *c = (volatile char *)p;
+	for (size_t off = 0; off < bytes; off += page)
+		c[off] = 0;
+	if (bytes > 0)
+		c[bytes - 1] = 0;
+}
+
+inline int adviseHugePages(void *p, size_t bytes)
+{
+	uintptr_t begin, end;
+	if (!pageInterior(p, bytes, begin, end))
+		return FAILURE;
+	return madvise((void *)begin, end - begin, MADV_HUGEPAGE) == 0 ? SUCCESS : FAILURE;
+}
+
+inline int bindToNode(void *p, size_t bytes, int node)
+{
+	uintptr_t begin, end;
+	if (!pageInterior(p, bytes, begin, end) || node < 0 || node >= 64)
+		return FAILURE;
+	unsigned long nodemask = 1UL << node;
+	long rc = syscall(__NR_mbind, begin, end - begin, MPOL_BIND, &nodemask,
+	                  sizeof(nodemask) * 8, MPOL_MF_MOVE);
+	return rc == 0 ? SUCCESS : FAILURE;
+}
+
+/* current THP mode, e.g. "always", "madvise" or "never" */
+inline std::string transparentHugePageMode()
+{
+	std::ifstream f("/sys/kernel/mm/transparent_hugepage/enabled");
+	std::string line;
+	std::getline(f, line);
+	size_t open = line.find('['), close = line.find(']');
+	if (open == std::string::npos || close == std::string::npos)
+		return "unavailable";
+	return line.substr(open + 1, close - open - 1);
+}
+
+
+class FaultMeter
+{
+public:
+	explicit FaultMeter(const std::string &title) : title_(title), open_(false) {}
+
+	void next(const char *phase)
+	{
+		end();
+		Phase p;
+		p.name = phase;
+		getrusage(RUSAGE_SELF, &p.start);
+		p.startTime = std::chrono::steady_clock::now();
+		phases_.push_back(p);
+		open_ = true;
+	}
+
+	void end()
+	{
+		if (!open_)
+			return;
+		Phase &p = phases_.back();
+		p.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - p.startTime).count();
+		getrusage(RUSAGE_SELF, &p.stop);
+		open_ = false;
+	}
+
+	void report(std::ostream &os = std::cout)
+	{
+		end();
+		std::ios::fmtflags flags = os.flags();
+		os << title_ << std::endl;
+		for (size_t i = 0; i < phases_.size(); i++)
+		{
+			const Phase &p = phases_[i];
+			os << "  " << std::setw(16) << std::left << p.name << std::right << std::fixed
+			   << std::setw(10) << std::setprecision(3) << p.seconds * 1e3 << " ms"
+			   << std::setw(10) << p.stop.ru_minflt - p.start.ru_minflt << " minor"
+			   << std::setw(6) << p.stop.ru_majflt - p.start.ru_majflt << " major" << std::endl;
+		}
+		os.flags(flags);
+	}
+
+private:
+	struct Phase
+	{
+		std::string name;
+		std::chrono::steady_clock::time_point startTime;
+		double seconds;
+		struct rusage start;
+		struct rusage stop;
+	};
+
+	std::string title_;
+	bool open_;
+	std::vector<Phase> phases_;
+};
+
+#endif
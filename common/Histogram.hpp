@@ -0,0 +1,116 @@
+/**********************************************************************
+Latency histogram for the microbenchmarks.
+
+Keeps every sample (so percentiles are exact) and prints a log2-bucketed
+text histogram in nanoseconds:
+
+	  [  256,   512) ns  ######################            1234
+********************************************************************/
+
+#ifndef HISTOGRAM_HPP
+#define HISTOGRAM_HPP
+
+#include <math.h>
+#include <iostream>
+#include <iomanip>
+#include <string>
+#include <vector>
+#include <algorithm>
+
+class LatencyHistogram
+{
+public:
+	explicit LatencyHistogram(const std::string &name = "") : name_(name), sorted_(true) {}
+
+	void add(double ns)
+	{
+		samples_.push_back(ns);
+		sorted_ = false;
+	}
+
+	void clear()
+	{
+		samples_.clear();
+		sorted_ = true;
+	}
+
+	const std::string &name() const { return name_; }
+	size_t count() const { return samples_.size(); }
+
+	/* p in [0, 100] */
+	double percentile(double p) const
+	{
+		if (samples_.empty())
+			return 0.0;
+		sort();
+		size_t i = (size_t)(p / 100.0 * (samples_.size() - 1) + 0.5);
+		return samples_[i];
+	}
+
+	double mean() const
+	{
+		double sum = 0.0;
+		for (size_t i = 0; i < samples_.size(); i++)
+			sum += samples_[i];
+		return samples_.empty() ? 0.0 : sum / samples_.size();
+	}
+
+	double max() const { return percentile(100.0); }
+
+	/* one line: name  n  mean  p50  p99  max (microseconds) */
+	void printSummary(std::ostream &os) const
+	{
+		os << std::setw(28) << std::left << name_ << std::right
+		   << "  n " << std::setw(6) << count()
+		   << "  mean " << std::setw(9) << mean() * 1e-3
+		   << "  p50 " << std::setw(9) << percentile(50) * 1e-3
+		   << "  p99 " << std::setw(9) << percentile(99) * 1e-3
+		   << "  max " << std::setw(9) << max() * 1e-3 << " us" << std::endl;
+	}
+
+	void print(std::ostream &os, int barWidth = 40) const
+	{
+		printSummary(os);
+		if (samples_.empty())
+			return;
+
+		sort();
+		int lo = bucketOf(samples_.front());
+		int hi = bucketOf(samples_.back());
+		std::vector<size_t> counts(hi - lo + 1, 0);
+		for (size_t i = 0; i < samples_.size(); i++)
+			counts[bucketOf(samples_[i]) - lo]++;
+		size_t peak = *std::max_element(counts.begin(), counts.end());
+
+		for (int b = lo; b <= hi; b++)
+		{
+			size_t n = counts[b - lo];
+			int bar = (int)((double)n / peak * barWidth + 0.5);
+			os << "  [" << std::setw(9) << (b == 0 ? 0.0 : ldexp(1.0, b))
+			   << ", " << std::setw(9) << ldexp(1.0, b + 1) << ") ns  "
+			   << std::string(bar, '#') << std::string(barWidth - bar, ' ')
+			   << "  " << n << std::endl;
+		}
+	}
+
+private:
+	static int bucketOf(double ns)
+	{
+		return ns < 1.0 ? 0 : (int)floor(log2(ns));
+	}
+
+	void sort() const
+	{
+		if (!sorted_)
+		{
+			std::sort(samples_.begin(), samples_.end());
+			sorted_ = true;
+		}
+	}
+
+	std::string name_;
+	mutable std::vector<double> samples_;
+	mutable bool sorted_;
+};
+
+#endif
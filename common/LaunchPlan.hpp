@@ -0,0 +1,212 @@
+/**********************************************************************
+Cached kernel launches.
+
+A LaunchPlan owns one cl_kernel created once from a built program, keeps
+the last value bound to every argument and its NDRange, so repeating a
+launch costs one clEnqueueNDRangeKernel plus a clSetKernelArg* only for
+arguments that actually changed:
+
+	LaunchPlan gemv(program, "GEMV", 1, global);
+	gemv.svm(0, A).svm(1, x).svm(2, y).scalar(3, M).scalar(4, N);
+	for (...)
+	{
+		gemv.svm(1, nextX);        // only this argument is re-bound
+		gemv.enqueue(queue);
+	}
+
+A LaunchSequence records a series of launches (plan plus the argument
+values at record time) and replays them back to back. Like cl_kernel
+itself, a plan must not be bound or enqueued from two threads at once.
+********************************************************************/
+
+#ifndef LAUNCH_PLAN_HPP
+#define LAUNCH_PLAN_HPP
+
+#include <CL/cl.h>
+#include <string.h>
+#include <iostream>
+#include <vector>
+
+#include "Trace.hpp"
+
+class LaunchPlan
+{
+public:
+	LaunchPlan(cl_program program, const char *kernelName, cl_uint workDim,
+	           const size_t *global, const size_t *local = NULL)
+		: workDim_(workDim), hasLocal_(local != NULL), setArgCalls_(0)
+	{
+		cl_int status;
+		kernel_ = clCreateKernel(program, kernelName, &status);
+		if (status != CL_SUCCESS)
+		{
+			std::cout << "Error: clCreateKernel(" << kernelName << "), status: " << status << std::endl;
+			kernel_ = NULL;
+		}
+		cl_uint numArgs = 0;
+		if (kernel_ != NULL)
+			clGetKernelInfo(kernel_, CL_KERNEL_NUM_ARGS, sizeof(numArgs), &numArgs, NULL);
+		args_.resize(numArgs);
+		setRange(global, local);
+	}
+
+	~LaunchPlan()
+	{
+		if (kernel_ != NULL)
+			clReleaseKernel(kernel_);
+	}
+
+	bool valid() const { return kernel_ != NULL; }
+	cl_kernel kernel() const { return kernel_; }
+
+	/* number of clSetKernelArg* calls actually made, for reporting */
+	size_t setArgCalls() const { return setArgCalls_; }
+
+	void setRange(const size_t *global, const size_t *local = NULL)
+	{
+		for (cl_uint d = 0; d < workDim_; d++)
+		{
+			global_[d] = global[d];
+			local_[d] = local != NULL ? local[d] : 0;
+		}
+		hasLocal_ = local != NULL;
+	}
+
+	LaunchPlan &svm(cl_uint index, const void *ptr)
+	{
+		return bind(index, ARG_SVM, &ptr, sizeof(ptr));
+	}
+
+	LaunchPlan &mem(cl_uint index, cl_mem buffer)
+	{
+		return bind(index, ARG_VALUE, &buffer, sizeof(buffer));
+	}
+
+	/* __local argument of the given size */
+	LaunchPlan &local(cl_uint index, size_t bytes)
+	{
+		return bind(index, ARG_LOCAL, &bytes, sizeof(bytes));
+	}
+
+	template <typename T>
+	LaunchPlan &scalar(cl_uint index, const T &value)
+	{
+		return bind(index, ARG_VALUE, &value, sizeof(T));
+	}
+
+	cl_int enqueue(cl_command_queue queue, cl_uint numEvents = 0,
+	               const cl_event *waitList = NULL, cl_event *event = NULL) const
+	{
+		return clEnqueueNDRangeKernel(queue, kernel_, workDim_, NULL, global_,
+		                              hasLocal_ ? local_ : NULL, numEvents, waitList, event);
+	}
+
+private:
+	friend class LaunchSequence;
+
+	enum ArgKind { ARG_UNSET, ARG_SVM, ARG_VALUE, ARG_LOCAL };
+
+	struct Arg
+	{
+		ArgKind kind;
+		std::vector<unsigned char> bytes;
+		Arg() : kind(ARG_UNSET) {}
+	};
+
+	LaunchPlan &bind(cl_uint index, ArgKind kind, const void *value, size_t size)
+	{
+		if (index >= args_.size())
+		{
+			std::cout << "Error: argument " << index << " out of range" << std::endl;
+			return *this;
+		}
+		Arg &arg = args_[index];
+		if (arg.kind == kind && arg.bytes.size() == size && memcmp(&arg.bytes[0], value, size) == 0)
+			return *this;
+
+		cl_int status;
+		if (kind == ARG_SVM)
+			status = clSetKernelArgSVMPointer(kernel_, index, *(void * const *)value);
+		else if (kind == ARG_LOCAL)
+			status = clSetKernelArg(kernel_, index, *(const size_t *)value, NULL);
+		else
+			status = clSetKernelArg(kernel_, index, size, value);
+		setArgCalls_++;
+		if (status != CL_SUCCESS)
+		{
+			std::cout << "Error: setting argument " << index << ", status: " << status << std::endl;
+			arg.kind = ARG_UNSET;
+			return *this;
+		}
+		arg.kind = kind;
+		arg.bytes.assign((const unsigned char *)value, (const unsigned char *)value + size);
+		return *this;
+	}
+
+	LaunchPlan(const LaunchPlan &);
+	LaunchPlan &operator=(const LaunchPlan &);
+
+	cl_kernel kernel_;
+	cl_uint workDim_;
+	size_t global_[3];
+	size_t local_[3];
+	bool hasLocal_;
+	std::vector<Arg> args_;
+	size_t setArgCalls_;
+};
+
+
+class LaunchSequence
+{
+public:
+	/* snapshot the plan's current arguments and range as the next step */
+	void record(LaunchPlan &plan)
+	{
+		Step step;
+		step.plan = &plan;
+		step.args = plan.args_;
+		memcpy(step.global, plan.global_, sizeof(step.global));
+		memcpy(step.local, plan.local_, sizeof(step.local));
+		step.hasLocal = plan.hasLocal_;
+		steps_.push_back(step);
+	}
+
+	size_t size() const { return steps_.size(); }
+	void clear() { steps_.clear(); }
+
+	/* Enqueue every step in order; the last launch optionally returns an
+	   event. Arguments are re-bound only where they differ from what the
+	   plan has bound at that point. */
+	cl_int replay(cl_command_queue queue, cl_event *lastEvent = NULL)
+	{
+		cl_int status = CL_SUCCESS;
+		for (size_t s = 0; s < steps_.size() && status == CL_SUCCESS; s++)
+		{
+			Step &step = steps_[s];
+			LaunchPlan &plan = *step.plan;
+			for (size_t i = 0; i < step.args.size(); i++)
+			{
+				const LaunchPlan::Arg &arg = step.args[i];
+				if (arg.kind != LaunchPlan::ARG_UNSET)
+					plan.bind((cl_uint)i, arg.kind, &arg.bytes[0], arg.bytes.size());
+			}
+			plan.setRange(step.global, step.hasLocal ? step.local : NULL);
+			status = plan.enqueue(queue, 0, NULL, s + 1 == steps_.size() ? lastEvent : NULL);
+		}
+		return status;
+	}
+
+private:
+	struct Step
+	{
+		LaunchPlan *plan;
+		std::vector<LaunchPlan::Arg> args;
+		size_t global[3];
+		size_t local[3];
+		bool hasLocal;
+	};
+
+	std::vector<Step> steps_;
+};
+
+#endif
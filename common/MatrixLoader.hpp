@@ -0,0 +1,432 @@
+/**********************************************************************
+Memory-mapped matrix / vector input for the SVM comparison programs.
+
+Supported files:
+	raw binary    "A.bin:2000x2000"  (element type is the program's native type,
+	                                  shape given after the colon, row-major)
+	NumPy         "A.npy"            (<i4, <f4 or <f8, C order, 1-D or 2-D)
+	Matrix Market "A.mtx"            (dense "array" format, real or integer)
+
+Binary files of the program's element type are used in place: on devices with
+fine-grained system SVM the mmap pointer is handed straight to the kernel,
+otherwise it is streamed into a clSVMAlloc region in chunks with madvise hints.
+Matrix Market files are text and are always parsed into the destination.
+********************************************************************/
+
+#ifndef MATRIX_LOADER_HPP
+#define MATRIX_LOADER_HPP
+
+#include <CL/cl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <string.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <stddef.h>
+#include <iostream>
+#include <string>
+
+#include "Telemetry.hpp"
+#include "Trace.hpp"
+
+#ifndef SUCCESS
+#define SUCCESS 0
+#define FAILURE 1
+#endif
+
+enum ElementType { ELEM_INT32, ELEM_FLOAT32, ELEM_FLOAT64 };
+
+inline size_t elementSize(ElementType type)
+{
+	return type == ELEM_FLOAT64 ? 8 : 4;
+}
+
+struct MappedMatrix
+{
+	void        *base;       // start of the mapping
+	size_t      mapLength;   // length of the mapping
+	const char  *data;       // first element (binary) or first value token (text)
+	size_t      rows;
+	size_t      cols;
+	ElementType type;
+	bool        isText;      // Matrix Market: values must be parsed
+
+	MappedMatrix() : base(NULL), mapLength(0), data(NULL), rows(0), cols(0),
+	                 type(ELEM_INT32), isText(false) {}
+
+	size_t count() const { return rows * cols; }
+	bool   loaded() const { return base != NULL; }
+};
+
+/* Stream copies through this many bytes at a time so that readahead and
+   page reclaim can overlap with the copy into the SVM region. */
+const size_t LOADER_CHUNK_BYTES = 64 << 20;
+
+/* skip blanks and newlines */
+inline const char *loaderSkipSpace(const char *p, const char *end)
+{
+	while (p < end && (*p == ' ' || *p == '\t' || *p == '\n' || *p == '\r'))
+		p++;
+	return p;
+}
+
+/* skip to the start of the next line */
+inline const char *loaderNextLine(const char *p, const char *end)
+{
+	while (p < end && *p != '\n')
+		p++;
+	return p < end ? p + 1 : end;
+}
+
+/* Parse one whitespace-separated number at or after p without reading
+   past end (the mapping is not NUL-terminated). Returns the position
+   after it, or NULL when there is no well-formed number before end. */
+inline const char *loaderParseNumber(const char *p, const char *end, double &value)
+{
+	p = loaderSkipSpace(p, end);
+	char token[64];
+	size_t length = 0;
+	while (p + length < end && length < sizeof(token) - 1 &&
+	       p[length] != ' ' && p[length] != '\t' && p[length] != '\n' && p[length] != '\r')
+	{
+		token[length] = p[length];
+		length++;
+	}
+	if (length == 0 || length == sizeof(token) - 1)
+		return NULL;
+	token[length] = '\0';
+	char *next;
+	value = strtod(token, &next);
+	return next == token + length ? p + length : NULL;
+}
+
+inline int parseNpyHeader(MappedMatrix &m, const char *path)
+{
+	const char *bytes = (const char *)m.base;
+	if (m.mapLength < 10 || memcmp(bytes, "\x93NUMPY", 6) != 0)
+	{
+		std::cout << "Error: not a .npy file: " << path << std::endl;
+		return FAILURE;
+	}
+
+	size_t headerLen, headerStart;
+	if (bytes[6] == 1)
+	{
+		headerLen = (unsigned char)bytes[8] | ((unsigned char)bytes[9] << 8);
+		headerStart = 10;
+	}
+	else
+	{
+		uint32_t len;
+		memcpy(&len, bytes + 8, sizeof(len));
+		headerLen = len;
+		headerStart = 12;
+	}
+	if (headerStart + headerLen > m.mapLength)
+	{
+		std::cout << "Error: truncated .npy header: " << path << std::endl;
+		return FAILURE;
+	}
+	std::string header(bytes + headerStart, headerLen);
+
+	size_t pos = header.find("'descr'");
+	if (pos == std::string::npos)
+	{
+		std::cout << "Error: .npy header has no descr: " << path << std::endl;
+		return FAILURE;
+	}
+	pos = header.find('\'', pos + 7);
+	size_t end = pos == std::string::npos ? pos : header.find('\'', pos + 1);
+	if (end == std::string::npos)
+	{
+		std::cout << "Error: malformed .npy descr: " << path << std::endl;
+		return FAILURE;
+	}
+	std::string descr = header.substr(pos + 1, end - pos - 1);
+	if (descr == "<i4")
+		m.type = ELEM_INT32;
+	else if (descr == "<f4")
+		m.type = ELEM_FLOAT32;
+	else if (descr == "<f8")
+		m.type = ELEM_FLOAT64;
+	else
+	{
+		std::cout << "Error: unsupported .npy dtype " << descr << ": " << path << std::endl;
+		return FAILURE;
+	}
+
+	if (header.find("'fortran_order': True") != std::string::npos)
+	{
+		std::cout << "Error: Fortran-ordered .npy is not supported: " << path << std::endl;
+		return FAILURE;
+	}
+
+	pos = header.find("'shape'");
+	if (pos != std::string::npos)
+		pos = header.find('(', pos);
+	if (pos == std::string::npos)
+	{
+		std::cout << "Error: .npy header has no shape: " << path << std::endl;
+		return FAILURE;
+	}
+	char *next;
+	m.rows = strtoul(header.c_str() + pos + 1, &next, 10);
+	while (*next == ',' || *next == ' ')
+		next++;
+	m.cols = (*next == ')') ? 1 : strtoul(next, NULL, 10);
+
+	m.data = bytes + headerStart + headerLen;
+	if (m.data + m.count() * elementSize(m.type) > bytes + m.mapLength)
+	{
+		std::cout << "Error: .npy data shorter than its shape: " << path << std::endl;
+		return FAILURE;
+	}
+	return SUCCESS;
+}
+
+inline int parseMatrixMarketHeader(MappedMatrix &m, const char *path)
+{
+	const char *p = (const char *)m.base;
+	const char *end = p + m.mapLength;
+	std::string banner(p, loaderNextLine(p, end) - p);
+
+	if (banner.compare(0, 14, "%%MatrixMarket") != 0 || banner.find("array") == std::string::npos)
+	{
+		std::cout << "Error: only dense (array) Matrix Market files are supported: " << path << std::endl;
+		return FAILURE;
+	}
+	if (banner.find("general") == std::string::npos || banner.find("complex") != std::string::npos)
+	{
+		std::cout << "Error: only real or integer general Matrix Market arrays are supported"
+		          << " (symmetric storage holds one triangle): " << path << std::endl;
+		return FAILURE;
+	}
+	m.type = banner.find("integer") != std::string::npos ? ELEM_INT32 : ELEM_FLOAT64;
+
+	/* skip comment lines, then read "rows cols" */
+	while (p < end && *p == '%')
+		p = loaderNextLine(p, end);
+	double rows = 0, cols = 0;
+	const char *next = loaderParseNumber(p, end, rows);
+	if (next != NULL)
+		next = loaderParseNumber(next, end, cols);
+	if (next == NULL || rows < 1 || cols < 1 || rows != (size_t)rows || cols != (size_t)cols)
+	{
+		std::cout << "Error: malformed Matrix Market size line: " << path << std::endl;
+		return FAILURE;
+	}
+	m.rows = (size_t)rows;
+	m.cols = (size_t)cols;
+	m.data = loaderNextLine(next, end);
+	m.isText = true;
+
+	/* check all rows * cols values parse, so copyMatrixTo() cannot run short */
+	const char *q = m.data;
+	double v;
+	for (size_t i = 0; i < m.count(); i++)
+	{
+		q = loaderParseNumber(q, end, v);
+		if (q == NULL)
+		{
+			std::cout << "Error: Matrix Market data has fewer than " << m.count()
+			          << " values or a malformed one (value " << i << "): " << path << std::endl;
+			return FAILURE;
+		}
+	}
+	return SUCCESS;
+}
+
+/* Map "path" or "path:RxC" read-only and describe its contents. */
+inline int mapMatrixFile(const char *spec, ElementType nativeType, MappedMatrix &m)
+{
+	std::string path(spec);
+	size_t rawRows = 0, rawCols = 0;
+	size_t colon = path.rfind(':');
+	if (colon != std::string::npos)
+	{
+		char *next;
+		rawRows = strtoul(path.c_str() + colon + 1, &next, 10);
+		rawCols = (*next == 'x') ? strtoul(next + 1, NULL, 10) : 1;
+		path.resize(colon);
+	}
+
+	int fd = open(path.c_str(), O_RDONLY);
+	if (fd < 0)
+	{
+		std::cout << "Error: failed to open file\n:" << path << std::endl;
+		return FAILURE;
+	}
+	struct stat st;
+	if (fstat(fd, &st) != 0 || st.st_size == 0)
+	{
+		std::cout << "Error: cannot stat file or file is empty\n:" << path << std::endl;
+		close(fd);
+		return FAILURE;
+	}
+	m.mapLength = st.st_size;
+	m.base = mmap(NULL, m.mapLength, PROT_READ, MAP_PRIVATE, fd, 0);
+	close(fd);
+	if (m.base == MAP_FAILED)
+	{
+		m.base = NULL;
+		std::cout << "Error: mmap failed: " << path << std::endl;
+		return FAILURE;
+	}
+
+	int status;
+	if (path.size() > 4 && path.compare(path.size() - 4, 4, ".npy") == 0)
+		status = parseNpyHeader(m, path.c_str());
+	else if (path.size() > 4 && path.compare(path.size() - 4, 4, ".mtx") == 0)
+		status = parseMatrixMarketHeader(m, path.c_str());
+	else
+	{
+		m.type = nativeType;
+		m.rows = rawRows ? rawRows : m.mapLength / elementSize(nativeType);
+		m.cols = rawRows ? rawCols : 1;
+		m.data = (const char *)m.base;
+		status = (m.count() * elementSize(nativeType) <= m.mapLength) ? SUCCESS : FAILURE;
+		if (status != SUCCESS)
+			std::cout << "Error: " << path << " is smaller than its shape" << std::endl;
+	}
+
+	if (status != SUCCESS)
+	{
+		munmap(m.base, m.mapLength);
+		m = MappedMatrix();
+	}
+	return status;
+}
+
+inline void unmapMatrixFile(MappedMatrix &m)
+{
+	if (m.base != NULL)
+		munmap(m.base, m.mapLength);
+	m = MappedMatrix();
+}
+
+inline double loaderReadElement(const char *src, ElementType type, size_t i)
+{
+	switch (type)
+	{
+	case ELEM_INT32:   return ((const int32_t *)src)[i];
+	case ELEM_FLOAT32: return ((const float *)src)[i];
+	default:           return ((const double *)src)[i];
+	}
+}
+
+inline void loaderWriteElement(void *dst, ElementType type, size_t i, double v)
+{
+	switch (type)
+	{
+	case ELEM_INT32:   ((int32_t *)dst)[i] = (int32_t)v; break;
+	case ELEM_FLOAT32: ((float *)dst)[i] = (float)v; break;
+	default:           ((double *)dst)[i] = v; break;
+	}
+}
+
+/* Fill dst (row-major, element type "want") from the mapped file.
+   Binary inputs are streamed chunk by chunk: the next chunk is prefetched
+   with MADV_WILLNEED and finished chunks are dropped with MADV_DONTNEED,
+   so multi-GB inputs do not keep the whole file resident twice. */
+inline void copyMatrixTo(const MappedMatrix &m, ElementType want, void *dst)
+{
+	if (m.isText)
+	{
+		/* Matrix Market arrays are column-major */
+		const char *p = m.data;
+		const char *end = (const char *)m.base + m.mapLength;
+		for (size_t i = 0; i < m.count(); i++)
+		{
+			double v = 0.0;
+			p = loaderParseNumber(p, end, v);   // checked by parseMatrixMarketHeader()
+			loaderWriteElement(dst, want, (i % m.rows) * m.cols + i / m.rows, v);
+		}
+		return;
+	}
+
+	long pageSize = sysconf(_SC_PAGESIZE);
+	size_t srcElem = elementSize(m.type);
+	size_t total = m.count() * srcElem;
+	madvise(m.base, m.mapLength, MADV_SEQUENTIAL);
+
+	for (size_t offset = 0; offset < total; offset += LOADER_CHUNK_BYTES)
+	{
+		size_t bytes = total - offset < LOADER_CHUNK_BYTES ? total - offset : LOADER_CHUNK_BYTES;
+		const char *src = m.data + offset;
+		char *ahead = (char *)(((uintptr_t)(src + bytes)) & ~(uintptr_t)(pageSize - 1));
+		char *mapEnd = (char *)m.base + m.mapLength;
+		if (ahead < mapEnd)
+			madvise(ahead, mapEnd - ahead < (ptrdiff_t)LOADER_CHUNK_BYTES ? mapEnd - ahead : LOADER_CHUNK_BYTES, MADV_WILLNEED);
+
+		if (want == m.type)
+			memcpy((char *)dst + offset, src, bytes);
+		else
+			for (size_t i = offset / srcElem; i < (offset + bytes) / srcElem; i++)
+				loaderWriteElement(dst, want, i, loaderReadElement(m.data, m.type, i));
+
+		char *done = (char *)(((uintptr_t)src) & ~(uintptr_t)(pageSize - 1));
+		madvise(done, src + bytes - done, MADV_DONTNEED);
+	}
+}
+
+/* true if the mapping can be handed to the kernel without a copy */
+inline bool canUseInPlace(const MappedMatrix &m, ElementType want)
+{
+	return !m.isText && m.type == want;
+}
+
+inline bool hasFineGrainSystemSVM(cl_device_id device)
+{
+	cl_device_svm_capabilities caps = 0;
+	clGetDeviceInfo(device, CL_DEVICE_SVM_CAPABILITIES, sizeof(caps), &caps, NULL);
+	return (caps & CL_DEVICE_SVM_FINE_GRAIN_SYSTEM) != 0;
+}
+
+/* Return an SVM pointer holding the matrix as "want" elements.
+   zeroCopy is set when the mmap pointer itself is returned; such pointers
+   must be released with releaseSVMInput, never clSVMFree'd directly. */
+inline void *loadIntoSVM(cl_context context, cl_command_queue commandQueue, cl_device_id device,
+                         const MappedMatrix &m, ElementType want, bool &zeroCopy)
+{
+	zeroCopy = canUseInPlace(m, want) && hasFineGrainSystemSVM(device);
+	if (zeroCopy)
+	{
+		madvise(m.base, m.mapLength, MADV_WILLNEED);
+		return (void *)m.data;
+	}
+
+	size_t bytes = m.count() * elementSize(want);
+	void *svm = clSVMAlloc(context, CL_MEM_READ_WRITE, bytes, 0);
+	if (svm == NULL)
+	{
+		std::cout << "Error: clSVMAlloc of " << bytes << " bytes failed" << std::endl;
+		return NULL;
+	}
+	clEnqueueSVMMap(commandQueue, CL_TRUE, CL_MAP_WRITE_INVALIDATE_REGION, svm, bytes, 0, NULL, NULL);
+	copyMatrixTo(m, want, svm);
+	clEnqueueSVMUnmap(commandQueue, svm, 0, NULL, NULL);
+	return svm;
+}
+
+inline void releaseSVMInput(cl_context context, void *ptr, bool zeroCopy)
+{
+	if (!zeroCopy && ptr != NULL)
+		clSVMFree(context, ptr);
+}
+
+/* Host pointer for CL_MEM_COPY_HOST_PTR: the mapping itself when possible,
+   otherwise a malloc'd converted copy (ownsCopy tells the caller to free it). */
+inline void *loadIntoHost(const MappedMatrix &m, ElementType want, bool &ownsCopy)
+{
+	ownsCopy = !canUseInPlace(m, want);
+	if (!ownsCopy)
+		return (void *)m.data;
+
+	void *host = malloc(m.count() * elementSize(want));
+	copyMatrixTo(m, want, host);
+	return host;
+}
+
+#endif
@@ -0,0 +1,216 @@
+/**********************************************************************
+NUMA placement of host memory for CPU OpenCL devices.
+
+With one host thread initialising an array, first touch puts every page
+on that thread's node, and a CPU device spanning several sockets then
+reads most of it remotely. The policies here decide placement before the
+first write:
+
+	NUMA_SINGLE        one thread writes everything (the programs' default)
+	NUMA_INTERLEAVE    mbind(MPOL_INTERLEAVE) over all nodes, then one
+	                   thread writes; pages alternate between nodes
+	NUMA_PARTITIONED   numaSlice() i is written by a thread pinned to
+	                   node i, matching an NDRange split into the same
+	                   contiguous slices (one per sub-device)
+
+The topology comes from /sys/devices/system/node; without it (non-NUMA
+kernels, containers) everything is one node and the policies coincide.
+SVM_NUMA_POLICY=single|interleave|partitioned selects the policy for the
+programs that take it from the environment.
+
+createNumaSubDevices() fissions a CPU device with
+CL_DEVICE_PARTITION_BY_AFFINITY_DOMAIN / NUMA. The runtime does not say
+which node a sub-device runs on; the sub-devices are assumed to come
+back in node order, as the common CPU runtimes return them.
+********************************************************************/
+
+#ifndef NUMA_HPP
+#define NUMA_HPP
+
+#include <CL/cl.h>
+#include <sched.h>
+#include <dirent.h>
+#include <stdlib.h>
+#include <string.h>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <thread>
+#include <algorithm>
+
+#include "FirstTouch.hpp"
+
+enum NumaPolicy
+{
+	NUMA_SINGLE,
+	NUMA_INTERLEAVE,
+	NUMA_PARTITIONED
+};
+
+inline const char *numaPolicyName(NumaPolicy policy)
+{
+	static const char *names[] = { "single", "interleave", "partitioned" };
+	return names[policy];
+}
+
+inline NumaPolicy numaPolicyFromEnv()
+{
+	const char *env = getenv("SVM_NUMA_POLICY");
+	if (env != NULL && strcmp(env, "interleave") == 0)
+		return NUMA_INTERLEAVE;
+	if (env != NULL && strcmp(env, "partitioned") == 0)
+		return NUMA_PARTITIONED;
+	return NUMA_SINGLE;
+}
+
+/* parse a sysfs cpulist such as "0-3,8-11" */
+inline std::vector<int> parseCpuList(const std::string &list)
+{
+	std::vector<int> cpus;
+	std::stringstream ss(list);
+	std::string range;
+	while (std::getline(ss, range, ','))
+	{
+		if (range.empty() || range[0] == '\n')
+			continue;
+		int first = atoi(range.c_str()), last = first;
+		size_t dash = range.find('-');
+		if (dash != std::string::npos)
+			last = atoi(range.c_str() + dash + 1);
+		for (int cpu = first; cpu <= last; cpu++)
+			cpus.push_back(cpu);
+	}
+	return cpus;
+}
+
+struct NumaTopology
+{
+	std::vector<int> nodes;               // node ids, ascending
+	std::vector<std::vector<int> > cpus;  // cpus[i] belong to nodes[i]
+
+	size_t size() const { return nodes.size(); }
+
+	static NumaTopology detect()
+	{
+		NumaTopology topo;
+		DIR *dir = opendir("/sys/devices/system/node");
+		if (dir != NULL)
+		{
+			struct dirent *entry;
+			while ((entry = readdir(dir)) != NULL)
+				if (strncmp(entry->d_name, "node", 4) == 0 && entry->d_name[4] >= '0' && entry->d_name[4] <= '9')
+					topo.nodes.push_back(atoi(entry->d_name + 4));
+			closedir(dir);
+		}
+		std::sort(topo.nodes.begin(), topo.nodes.end());
+
+		for (size_t i = 0; i < topo.nodes.size(); i++)
+		{
+			std::ifstream f(("/sys/devices/system/node/node" + std::to_string(topo.nodes[i]) + "/cpulist").c_str());
+			std::string list;
+			std::getline(f, list);
+			topo.cpus.push_back(parseCpuList(list));
+		}
+
+		if (topo.nodes.empty())
+		{
+			topo.nodes.push_back(0);
+			topo.cpus.push_back(std::vector<int>());
+			for (unsigned cpu = 0; cpu < std::thread::hardware_concurrency(); cpu++)
+				topo.cpus[0].push_back((int)cpu);
+		}
+		return topo;
+	}
+};
+
+/* Contiguous slice i of parts over count elements, with slice boundaries
+   on 1024-element multiples so no 4 KiB page of 4-byte elements is
+   shared between two slices. The same split is used for first touch and
+   for the NDRange offsets of the sub-devices. */
+inline void numaSlice(size_t count, size_t parts, size_t i, size_t &begin, size_t &end)
+{
+	size_t chunk = ((count + parts - 1) / parts + 1023) & ~(size_t)1023;
+	begin = std::min(count, i * chunk);
+	end = std::min(count, begin + chunk);
+}
+
+inline int interleaveNodes(void *p, size_t bytes, const NumaTopology &topo)
+{
+	uintptr_t begin, end;
+	if (!pageInterior(p, bytes, begin, end))
+		return FAILURE;
+	unsigned long nodemask = 0;
+	for (size_t i = 0; i < topo.size(); i++)
+		if (topo.nodes[i] < 64)
+			nodemask |= 1UL << topo.nodes[i];
+	long rc = syscall(__NR_mbind, begin, end - begin, MPOL_INTERLEAVE, &nodemask, sizeof(nodemask) * 8, 0);
+	return rc == 0 ? SUCCESS : FAILURE;
+}
+
+inline void pinToCpus(const std::vector<int> &cpus)
+{
+	if (cpus.empty())
+		return;
+	cpu_set_t set;
+	CPU_ZERO(&set);
+	for (size_t i = 0; i < cpus.size(); i++)
+		CPU_SET(cpus[i], &set);
+	sched_setaffinity(0, sizeof(set), &set);
+}
+
+/* Initialise count elements under policy: fill(begin, end) writes
+   elements [begin, end). Interleave advice is applied to each of the
+   regions (pointer, bytes) first, so they must not have been touched. */
+template <typename Fill>
+void numaFirstTouch(NumaPolicy policy, const NumaTopology &topo, size_t count,
+                    const std::vector<std::pair<void *, size_t> > &regions, Fill fill)
+{
+	if (policy == NUMA_INTERLEAVE)
+		for (size_t i = 0; i < regions.size(); i++)
+			if (interleaveNodes(regions[i].first, regions[i].second, topo) != SUCCESS)
+			{
+				std::cout << "mbind(MPOL_INTERLEAVE) failed: " << strerror(errno) << std::endl;
+				break;
+			}
+
+	if (policy != NUMA_PARTITIONED || topo.size() == 1)
+	{
+		fill((size_t)0, count);
+		return;
+	}
+
+	std::vector<std::thread> threads;
+	for (size_t node = 0; node < topo.size(); node++)
+	{
+		threads.push_back(std::thread([&, node]() {
+			pinToCpus(topo.cpus[node]);
+			size_t begin, end;
+			numaSlice(count, topo.size(), node, begin, end);
+			fill(begin, end);
+		}));
+	}
+	for (size_t i = 0; i < threads.size(); i++)
+		threads[i].join();
+}
+
+/* Fission a CPU device into one sub-device per NUMA node. Returns the
+   clCreateSubDevices status; subDevices is empty unless it succeeded. */
+inline cl_int createNumaSubDevices(cl_device_id device, std::vector<cl_device_id> &subDevices)
+{
+	subDevices.clear();
+	const cl_device_partition_property props[] = {
+		CL_DEVICE_PARTITION_BY_AFFINITY_DOMAIN, CL_DEVICE_AFFINITY_DOMAIN_NUMA, 0
+	};
+	cl_uint count = 0;
+	cl_int status = clCreateSubDevices(device, props, 0, NULL, &count);
+	if (status != CL_SUCCESS || count == 0)
+		return status != CL_SUCCESS ? status : CL_DEVICE_PARTITION_FAILED;
+	subDevices.resize(count);
+	status = clCreateSubDevices(device, props, count, &subDevices[0], NULL);
+	if (status != CL_SUCCESS)
+		subDevices.clear();
+	return status;
+}
+
+#endif
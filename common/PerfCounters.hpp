@@ -0,0 +1,275 @@
+/**********************************************************************
+Optional Linux hardware/software counters per benchmark phase.
+
+Enabled by setting SVM_PERF_COUNTERS=1 in the environment; otherwise
+every call below is a no-op and the programs behave as before. Counters
+are opened for the whole process with inherit=1, so on a CPU OpenCL
+device the runtime's worker threads are counted too. Only threads
+created after the counters are opened are covered, which is why
+PerfCounters::instance() should be called at the top of main(), before
+the first context is created.
+
+	PhaseProfiler phases("SVM");
+	phases.next("setup");
+	...                                // Steps 1-7
+	phases.next("kernel", queue);      // clFinish(queue) first when enabled
+	...
+	phases.end(queue);
+	phases.report();
+
+With SVM_TRACE set, each phase is also a host span of the timeline
+(Trace.hpp), with or without counters.
+
+Counters that the kernel or the hardware refuses (VMs, high
+perf_event_paranoid) are reported as n/a; with paranoid >= 2 the
+hardware events fall back to user-space only.
+********************************************************************/
+
+#ifndef PERF_COUNTERS_HPP
+#define PERF_COUNTERS_HPP
+
+#include <CL/cl.h>
+#include <linux/perf_event.h>
+#include <sys/syscall.h>
+#include <sys/ioctl.h>
+#include <unistd.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <iostream>
+#include <iomanip>
+#include <string>
+#include <vector>
+#include <chrono>
+
+#include "Trace.hpp"
+
+enum PerfCounterId
+{
+	PERF_CYCLES,
+	PERF_INSTRUCTIONS,
+	PERF_LLC_MISSES,
+	PERF_DTLB_MISSES,
+	PERF_PAGE_FAULTS,
+	PERF_NUM_COUNTERS
+};
+
+struct PerfSample
+{
+	double value[PERF_NUM_COUNTERS];
+	bool valid[PERF_NUM_COUNTERS];
+};
+
+class PerfCounters
+{
+public:
+	static bool enabled()
+	{
+		const char *env = getenv("SVM_PERF_COUNTERS");
+		return env != NULL && env[0] != '\0' && strcmp(env, "0") != 0;
+	}
+
+	/* process-wide counters, opened on first use when enabled */
+	static PerfCounters &instance()
+	{
+		static PerfCounters counters;
+		return counters;
+	}
+
+	static const char *name(int id)
+	{
+		static const char *names[] = { "cycles", "instructions", "LLC-misses", "dTLB-misses", "page-faults" };
+		return names[id];
+	}
+
+	bool active() const { return active_; }
+
+	void read(PerfSample &sample) const
+	{
+		for (int i = 0; i < PERF_NUM_COUNTERS; i++)
+		{
+			sample.value[i] = 0.0;
+			sample.valid[i] = false;
+			if (fds_[i] < 0)
+				continue;
+			uint64_t buf[3];   // value, time enabled, time running
+			if (::read(fds_[i], buf, sizeof(buf)) != (ssize_t)sizeof(buf))
+				continue;
+			sample.valid[i] = true;
+			// scale when the kernel multiplexed the counter
+			sample.value[i] = buf[2] > 0 && buf[2] < buf[1] ? (double)buf[0] * buf[1] / buf[2] : (double)buf[0];
+		}
+	}
+
+	~PerfCounters()
+	{
+		for (int i = 0; i < PERF_NUM_COUNTERS; i++)
+			if (fds_[i] >= 0)
+				close(fds_[i]);
+	}
+
+private:
+	PerfCounters() : active_(false)
+	{
+		for (int i = 0; i < PERF_NUM_COUNTERS; i++)
+			fds_[i] = -1;
+		if (!enabled())
+			return;
+
+		const uint64_t cacheMiss = (PERF_COUNT_HW_CACHE_OP_READ << 8) | (PERF_COUNT_HW_CACHE_RESULT_MISS << 16);
+		fds_[PERF_CYCLES] = openCounter(PERF_TYPE_HARDWARE, PERF_COUNT_HW_CPU_CYCLES);
+		fds_[PERF_INSTRUCTIONS] = openCounter(PERF_TYPE_HARDWARE, PERF_COUNT_HW_INSTRUCTIONS);
+		fds_[PERF_LLC_MISSES] = openCounter(PERF_TYPE_HW_CACHE, PERF_COUNT_HW_CACHE_LL | cacheMiss);
+		fds_[PERF_DTLB_MISSES] = openCounter(PERF_TYPE_HW_CACHE, PERF_COUNT_HW_CACHE_DTLB | cacheMiss);
+		fds_[PERF_PAGE_FAULTS] = openCounter(PERF_TYPE_SOFTWARE, PERF_COUNT_SW_PAGE_FAULTS);
+
+		for (int i = 0; i < PERF_NUM_COUNTERS; i++)
+		{
+			if (fds_[i] >= 0)
+				active_ = true;
+			else
+				std::cout << "perf: " << name(i) << " not available" << std::endl;
+		}
+	}
+
+	static int openCounter(uint32_t type, uint64_t config)
+	{
+		struct perf_event_attr attr;
+		memset(&attr, 0, sizeof(attr));
+		attr.size = sizeof(attr);
+		attr.type = type;
+		attr.config = config;
+		attr.inherit = 1;
+		attr.read_format = PERF_FORMAT_TOTAL_TIME_ENABLED | PERF_FORMAT_TOTAL_TIME_RUNNING;
+		attr.exclude_hv = 1;
+
+		int fd = (int)syscall(__NR_perf_event_open, &attr, 0, -1, -1, 0);
+		if (fd < 0)
+		{
+			// perf_event_paranoid >= 2: user-space only
+			attr.exclude_kernel = 1;
+			fd = (int)syscall(__NR_perf_event_open, &attr, 0, -1, -1, 0);
+		}
+		return fd;
+	}
+
+	PerfCounters(const PerfCounters &);
+	PerfCounters &operator=(const PerfCounters &);
+
+	int fds_[PERF_NUM_COUNTERS];
+	bool active_;
+};
+
+
+/* Wall time and counter deltas for consecutive named phases of one
+   benchmark run. */
+class PhaseProfiler
+{
+public:
+	explicit PhaseProfiler(const char *benchmark)
+		: benchmark_(benchmark), enabled_(PerfCounters::enabled() && PerfCounters::instance().active()),
+		  open_(false) {}
+
+	/* close the current phase (if any) and start the next one; with a
+	   queue, wait for it first so enqueued work is charged to the phase
+	   that issued it */
+	void next(const char *phase, cl_command_queue queue = NULL)
+	{
+		end(queue);
+		if (Trace::enabled())
+		{
+			spanName_ = benchmark_ + ": " + phase;
+			spanStart_ = std::chrono::steady_clock::now();
+		}
+		if (!enabled_)
+			return;
+		Phase p;
+		p.name = phase;
+		PerfCounters::instance().read(p.start);
+		p.startTime = std::chrono::steady_clock::now();
+		phases_.push_back(p);
+		open_ = true;
+	}
+
+	void end(cl_command_queue queue = NULL)
+	{
+		endSpan(queue);
+		endCounters(queue);
+	}
+
+	void report(std::ostream &os = std::cout)
+	{
+		if (!enabled_)
+			return;
+		end();
+		os << "\nPerf counters, " << benchmark_ << ":" << std::endl;
+		os << std::setw(14) << std::left << "phase" << std::right << std::setw(12) << "ms";
+		for (int c = 0; c < PERF_NUM_COUNTERS; c++)
+			os << std::setw(15) << PerfCounters::name(c);
+		os << std::setw(8) << "IPC" << std::endl;
+
+		std::ios::fmtflags flags = os.flags();
+		os << std::fixed;
+		for (size_t i = 0; i < phases_.size(); i++)
+		{
+			const Phase &p = phases_[i];
+			os << std::setw(14) << std::left << p.name << std::right
+			   << std::setw(12) << std::setprecision(3) << p.seconds * 1e3 << std::setprecision(0);
+			for (int c = 0; c < PERF_NUM_COUNTERS; c++)
+			{
+				if (p.start.valid[c] && p.stop.valid[c])
+					os << std::setw(15) << p.stop.value[c] - p.start.value[c];
+				else
+					os << std::setw(15) << "n/a";
+			}
+			double cycles = p.stop.value[PERF_CYCLES] - p.start.value[PERF_CYCLES];
+			double instructions = p.stop.value[PERF_INSTRUCTIONS] - p.start.value[PERF_INSTRUCTIONS];
+			if (cycles > 0 && p.stop.valid[PERF_INSTRUCTIONS])
+				os << std::setw(8) << std::setprecision(2) << instructions / cycles;
+			os << std::endl;
+		}
+		os.flags(flags);
+	}
+
+private:
+	struct Phase
+	{
+		std::string name;
+		std::chrono::steady_clock::time_point startTime;
+		double seconds;
+		PerfSample start;
+		PerfSample stop;
+	};
+
+	void endCounters(cl_command_queue queue)
+	{
+		if (!enabled_ || !open_)
+			return;
+		if (queue != NULL)
+			clFinish(queue);
+		Phase &p = phases_.back();
+		p.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - p.startTime).count();
+		PerfCounters::instance().read(p.stop);
+		open_ = false;
+	}
+
+	/* the phase as a host span of the SVM_TRACE timeline */
+	void endSpan(cl_command_queue queue)
+	{
+		if (spanName_.empty())
+			return;
+		if (queue != NULL)
+			clFinish(queue);
+		Trace::instance().span(spanName_, "phase", spanStart_, std::chrono::steady_clock::now());
+		spanName_.clear();
+	}
+
+	std::string benchmark_;
+	bool enabled_;
+	bool open_;
+	std::vector<Phase> phases_;
+	std::string spanName_;
+	std::chrono::steady_clock::time_point spanStart_;
+};
+
+#endif
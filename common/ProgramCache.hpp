@@ -0,0 +1,80 @@
+/**********************************************************************
+Programs built once per (source files, build options).
+
+Used for shape-specialised kernels: the sizes, tile size and element
+type go into the options (-DM=1024 -DTS=16 -DT=int ...), so every
+distinct production shape gets its own program and repeated calls with
+the same shape reuse it:
+
+	ProgramCache cache(env);
+	cl_program p = cache.get(files, 2, options.c_str());
+
+Programs are owned by the cache and released with it. A failed build is
+remembered too (get() keeps returning NULL for that key) so callers can
+fall back to the generic kernel without rebuilding every time.
+********************************************************************/
+
+#ifndef PROGRAM_CACHE_HPP
+#define PROGRAM_CACHE_HPP
+
+#include <CL/cl.h>
+#include <map>
+#include <string>
+#include <chrono>
+
+#include "CLSetup.hpp"
+
+class ProgramCache
+{
+public:
+	explicit ProgramCache(CLEnv &env) : env_(env), hits_(0), misses_(0), buildSeconds_(0.0) {}
+
+	~ProgramCache()
+	{
+		for (std::map<std::string, cl_program>::iterator it = programs_.begin(); it != programs_.end(); ++it)
+			if (it->second != NULL)
+				clReleaseProgram(it->second);
+	}
+
+	cl_program get(const char **filenames, int count, const char *options)
+	{
+		std::string key = options != NULL ? options : "";
+		for (int i = 0; i < count; i++)
+			key += std::string("\n") + filenames[i];
+
+		std::map<std::string, cl_program>::iterator it = programs_.find(key);
+		if (it != programs_.end())
+		{
+			hits_++;
+			return it->second;
+		}
+
+		misses_++;
+		std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+		cl_program program = buildProgramFromFiles(env_, filenames, count, options);
+		buildSeconds_ += std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+		programs_[key] = program;
+		return program;
+	}
+
+	cl_program get(const char *filename, const char *options)
+	{
+		return get(&filename, 1, options);
+	}
+
+	size_t hits() const { return hits_; }
+	size_t misses() const { return misses_; }
+	double buildSeconds() const { return buildSeconds_; }
+
+private:
+	ProgramCache(const ProgramCache &);
+	ProgramCache &operator=(const ProgramCache &);
+
+	CLEnv &env_;
+	std::map<std::string, cl_program> programs_;
+	size_t hits_;
+	size_t misses_;
+	double buildSeconds_;
+};
+
+#endif
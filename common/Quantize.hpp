@@ -0,0 +1,144 @@
+/**********************************************************************
+Host-side quantize / dequantize helpers for the mixed-precision modes.
+
+int8: symmetric per-tensor quantization, real = scale * q with q in
+[-127, 127] and scale = max|x| / 127. An int8 x int8 product summed in
+int32 dequantizes with scaleA * scaleB:
+
+	float sa = int8Scale(a, n), sb = int8Scale(b, n);
+	quantizeInt8(a, n, sa, qa);
+	quantizeInt8(b, n, sb, qb);
+	... kernel: int32 acc = sum qa * qb ...
+	dequantizeInt32(acc, m, sa * sb, c);
+
+fp16: IEEE binary16 bit patterns (cl_half), rounded to nearest even, as
+read by vload_half() in a kernel; no cl_khr_fp16 needed for storage.
+
+compareToReference() summarises the error of a result against a host
+reference computed in higher precision.
+********************************************************************/
+
+#ifndef QUANTIZE_HPP
+#define QUANTIZE_HPP
+
+#include <math.h>
+#include <stdint.h>
+#include <string.h>
+#include <stddef.h>
+
+inline float int8Scale(const float *x, size_t count)
+{
+	float maxAbs = 0.0f;
+	for (size_t i = 0; i < count; i++)
+		maxAbs = fmaxf(maxAbs, fabsf(x[i]));
+	return maxAbs > 0.0f ? maxAbs / 127.0f : 1.0f;
+}
+
+inline void quantizeInt8(const float *x, size_t count, float scale, int8_t *q)
+{
+	for (size_t i = 0; i < count; i++)
+	{
+		float v = roundf(x[i] / scale);
+		q[i] = (int8_t)fminf(127.0f, fmaxf(-127.0f, v));
+	}
+}
+
+inline void dequantizeInt32(const int32_t *acc, size_t count, float scale, float *out)
+{
+	for (size_t i = 0; i < count; i++)
+		out[i] = (float)acc[i] * scale;
+}
+
+inline uint16_t floatToHalf(float f)
+{
+	uint32_t x;
+	memcpy(&x, &f, sizeof(x));
+	uint16_t sign = (uint16_t)((x >> 16) & 0x8000);
+	uint32_t mantissa = x & 0x007fffff;
+	int exponent = (int)((x >> 23) & 0xff);
+
+	if (exponent == 0xff)   // inf / nan (keep nan quiet)
+		return sign | 0x7c00 | (mantissa ? 0x0200 | (mantissa >> 13) : 0);
+
+	exponent -= 127 - 15;
+	if (exponent >= 0x1f)   // overflow
+		return sign | 0x7c00;
+	if (exponent <= 0)      // subnormal or zero
+	{
+		if (exponent < -10)
+			return sign;
+		mantissa |= 0x00800000;
+		int shift = 14 - exponent;
+		uint32_t half = mantissa >> shift;
+		uint32_t rest = mantissa & ((1u << shift) - 1);
+		uint32_t midpoint = 1u << (shift - 1);
+		if (rest > midpoint || (rest == midpoint && (half & 1)))
+			half++;
+		return sign | (uint16_t)half;
+	}
+
+	uint32_t half = ((uint32_t)exponent << 10) | (mantissa >> 13);
+	uint32_t rest = mantissa & 0x1fff;
+	if (rest > 0x1000 || (rest == 0x1000 && (half & 1)))
+		half++;   // may carry into the exponent, up to inf
+	return sign | (uint16_t)half;
+}
+
+inline float halfToFloat(uint16_t h)
+{
+	uint32_t sign = (uint32_t)(h & 0x8000) << 16;
+	uint32_t exponent = (h >> 10) & 0x1f;
+	uint32_t mantissa = h & 0x03ff;
+	uint32_t x;
+
+	if (exponent == 0x1f)
+		x = sign | 0x7f800000 | (mantissa << 13);
+	else if (exponent != 0)
+		x = sign | ((exponent + 127 - 15) << 23) | (mantissa << 13);
+	else if (mantissa == 0)
+		x = sign;
+	else
+	{
+		exponent = 127 - 15 + 1;
+		while ((mantissa & 0x0400) == 0)
+		{
+			mantissa <<= 1;
+			exponent--;
+		}
+		x = sign | (exponent << 23) | ((mantissa & 0x03ff) << 13);
+	}
+	float f;
+	memcpy(&f, &x, sizeof(f));
+	return f;
+}
+
+inline void toHalf(const float *x, size_t count, uint16_t *h)
+{
+	for (size_t i = 0; i < count; i++)
+		h[i] = floatToHalf(x[i]);
+}
+
+struct QuantError
+{
+	double maxAbs;     // largest |x - ref|
+	double rms;        // root mean square of x - ref
+	double relative;   // maxAbs / max|ref|
+};
+
+inline QuantError compareToReference(const float *x, const double *ref, size_t count)
+{
+	QuantError e = { 0.0, 0.0, 0.0 };
+	double refMax = 0.0, sum = 0.0;
+	for (size_t i = 0; i < count; i++)
+	{
+		double d = fabs((double)x[i] - ref[i]);
+		e.maxAbs = d > e.maxAbs ? d : e.maxAbs;
+		refMax = fabs(ref[i]) > refMax ? fabs(ref[i]) : refMax;
+		sum += d * d;
+	}
+	e.rms = count > 0 ? sqrt(sum / count) : 0.0;
+	e.relative = refMax > 0.0 ? e.maxAbs / refMax : e.maxAbs;
+	return e;
+}
+
+#endif
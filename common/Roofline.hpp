@@ -0,0 +1,224 @@
+/**********************************************************************
+Roofline reporting: achieved vs attainable performance per kernel run.
+
+Each benchmark mode records its kernel with the operation and byte
+counts of the algorithm (compulsory traffic: every input read once,
+every output written once) and the kernel's profiled execution time:
+
+	cl_event kernelEvent;
+	clEnqueueNDRangeKernel(..., &kernelEvent);
+	Roofline::instance().recordEvent("GEMM", "SVM", 2.0 * M * N * K,
+	                                 (szA + szB + szC) * sizeof(int), kernelEvent);
+	...
+	Roofline::instance().report();            // end of main()
+	Roofline::instance().exportCsv("roofline.csv");
+
+The queue needs CL_QUEUE_PROFILING_ENABLE. Repeated runs of the same
+(benchmark, mode) keep the fastest. Peak bandwidth (float4 copy) and
+peak arithmetic rate (independent float4 mad chains) are measured once,
+on first report, on the device setupCL() picks. Integer kernels count
+integer operations against the float peak, which is only an estimate
+of the integer roof.
+********************************************************************/
+
+#ifndef ROOFLINE_HPP
+#define ROOFLINE_HPP
+
+#include <CL/cl.h>
+#include <stdio.h>
+#include <algorithm>
+#include <iostream>
+#include <iomanip>
+#include <fstream>
+#include <string>
+#include <vector>
+
+#include "CLSetup.hpp"
+
+struct RooflineSample
+{
+	std::string benchmark;
+	std::string mode;
+	double ops;
+	double bytes;
+	double seconds;
+
+	double intensity() const { return ops / bytes; }
+	double opsPerSecond() const { return ops / seconds; }
+	double bytesPerSecond() const { return bytes / seconds; }
+};
+
+class Roofline
+{
+public:
+	static Roofline &instance()
+	{
+		static Roofline roofline;
+		return roofline;
+	}
+
+	void record(const std::string &benchmark, const std::string &mode, double ops, double bytes, double seconds)
+	{
+		if (seconds <= 0.0 || bytes <= 0.0)
+			return;
+		for (size_t i = 0; i < samples_.size(); i++)
+		{
+			if (samples_[i].benchmark == benchmark && samples_[i].mode == mode)
+			{
+				samples_[i].seconds = std::min(samples_[i].seconds, seconds);
+				return;
+			}
+		}
+		RooflineSample s = { benchmark, mode, ops, bytes, seconds };
+		samples_.push_back(s);
+	}
+
+	/* waits for the kernel, records it and releases the event */
+	void recordEvent(const std::string &benchmark, const std::string &mode, double ops, double bytes, cl_event event)
+	{
+		clWaitForEvents(1, &event);
+		record(benchmark, mode, ops, bytes, eventSeconds(event));
+		clReleaseEvent(event);
+	}
+
+	/* measured device peaks; 0 until measurePeaks() succeeded */
+	double peakBytesPerSecond() const { return peakBandwidth_; }
+	double peakOpsPerSecond() const { return peakOps_; }
+
+	double attainable(const RooflineSample &s) const
+	{
+		return std::min(peakOps_, s.intensity() * peakBandwidth_);
+	}
+
+	int measurePeaks()
+	{
+		if (peakOps_ > 0.0)
+			return SUCCESS;
+
+		CLEnv env;
+		if (setupCL(env) != SUCCESS)
+			return FAILURE;
+
+		const char *source =
+			"__kernel void roofline_copy(__global const float4 *in, __global float4 *out, uint n) {\n"
+			"  for (uint i = get_global_id(0); i < n; i += get_global_size(0))\n"
+			"    out[i] = in[i];\n"
+			"}\n"
+			"__kernel void roofline_mad(__global float *out, float a, float b) {\n"
+			"  float4 x0 = (float4)(get_global_id(0)), x1 = x0 + 1, x2 = x0 + 2, x3 = x0 + 3;\n"
+			"  float4 x4 = x0 + 4, x5 = x0 + 5, x6 = x0 + 6, x7 = x0 + 7;\n"
+			"  for (int i = 0; i < 256; i++) {\n"
+			"    x0 = mad(x0, a, b); x1 = mad(x1, a, b); x2 = mad(x2, a, b); x3 = mad(x3, a, b);\n"
+			"    x4 = mad(x4, a, b); x5 = mad(x5, a, b); x6 = mad(x6, a, b); x7 = mad(x7, a, b);\n"
+			"  }\n"
+			"  float4 s = x0 + x1 + x2 + x3 + x4 + x5 + x6 + x7;\n"
+			"  out[get_global_id(0)] = s.x + s.y + s.z + s.w;\n"
+			"}\n";
+		size_t sourceSize[] = { strlen(source) };
+		cl_int status;
+		cl_program program = clCreateProgramWithSource(env.context, 1, &source, sourceSize, &status);
+		status = clBuildProgram(program, 1, env.devices, NULL, NULL, NULL);
+		if (status != CL_SUCCESS)
+		{
+			std::cout << "Error: building roofline kernels failed, status: " << status << std::endl;
+			clReleaseProgram(program);
+			releaseCL(env);
+			return FAILURE;
+		}
+		cl_kernel copy = clCreateKernel(program, "roofline_copy", NULL);
+		cl_kernel mad = clCreateKernel(program, "roofline_mad", NULL);
+
+		/* bandwidth: 64 MB each way, well beyond any last-level cache */
+		const cl_uint vectors = (64 << 20) / 16;
+		cl_mem in = clCreateBuffer(env.context, CL_MEM_READ_ONLY, (size_t)vectors * 16, NULL, NULL);
+		cl_mem out = clCreateBuffer(env.context, CL_MEM_WRITE_ONLY, (size_t)vectors * 16, NULL, NULL);
+		float zero = 0.0f;
+		clEnqueueFillBuffer(env.commandQueue, in, &zero, sizeof(zero), 0, (size_t)vectors * 16, 0, NULL, NULL);
+		clSetKernelArg(copy, 0, sizeof(cl_mem), &in);
+		clSetKernelArg(copy, 1, sizeof(cl_mem), &out);
+		clSetKernelArg(copy, 2, sizeof(cl_uint), &vectors);
+		size_t copyGlobal[1] = { vectors };
+		double copySeconds = timeKernel(env.commandQueue, copy, 1, copyGlobal, NULL, 5);
+		peakBandwidth_ = 2.0 * vectors * 16 / copySeconds;
+
+		/* arithmetic: 8 chains x 4 lanes x 256 mads x 2 ops per work-item */
+		const size_t items = 1 << 20;
+		cl_mem sink = clCreateBuffer(env.context, CL_MEM_WRITE_ONLY, items * sizeof(float), NULL, NULL);
+		float a = 0.999f, b = 0.001f;
+		clSetKernelArg(mad, 0, sizeof(cl_mem), &sink);
+		clSetKernelArg(mad, 1, sizeof(float), &a);
+		clSetKernelArg(mad, 2, sizeof(float), &b);
+		size_t madGlobal[1] = { items };
+		double madSeconds = timeKernel(env.commandQueue, mad, 1, madGlobal, NULL, 5);
+		peakOps_ = (double)items * 8 * 4 * 256 * 2 / madSeconds;
+
+		clReleaseMemObject(in);
+		clReleaseMemObject(out);
+		clReleaseMemObject(sink);
+		clReleaseKernel(copy);
+		clReleaseKernel(mad);
+		clReleaseProgram(program);
+		releaseCL(env);
+		return SUCCESS;
+	}
+
+	void report(std::ostream &os = std::cout)
+	{
+		if (samples_.empty() || measurePeaks() != SUCCESS)
+			return;
+		std::ios::fmtflags flags = os.flags();
+		os << std::fixed << std::setprecision(2);
+		os << "\nRoofline (peak " << peakBandwidth_ * 1e-9 << " GB/s, " << peakOps_ * 1e-9
+		   << " GFLOP/s, ridge at " << peakOps_ / peakBandwidth_ << " FLOP/B):" << std::endl;
+		os << std::setw(12) << std::left << "benchmark" << std::setw(12) << "mode" << std::right
+		   << std::setw(10) << "FLOP/B" << std::setw(12) << "GFLOP/s" << std::setw(10) << "GB/s"
+		   << std::setw(12) << "attainable" << std::setw(9) << "% roof" << "  bound" << std::endl;
+		for (size_t i = 0; i < samples_.size(); i++)
+		{
+			const RooflineSample &s = samples_[i];
+			bool memoryBound = s.intensity() * peakBandwidth_ < peakOps_;
+			os << std::setw(12) << std::left << s.benchmark << std::setw(12) << s.mode << std::right
+			   << std::setw(10) << s.intensity() << std::setw(12) << s.opsPerSecond() * 1e-9
+			   << std::setw(10) << s.bytesPerSecond() * 1e-9 << std::setw(12) << attainable(s) * 1e-9
+			   << std::setw(8) << 100.0 * s.opsPerSecond() / attainable(s) << "%"
+			   << (memoryBound ? "  memory" : "  compute") << std::endl;
+		}
+		os.flags(flags);
+	}
+
+	/* one row per sample, with the peaks repeated so each row can be
+	   plotted against its own roof */
+	int exportCsv(const char *path)
+	{
+		if (samples_.empty() || measurePeaks() != SUCCESS)
+			return FAILURE;
+		std::ofstream f(path);
+		if (!f.is_open())
+		{
+			std::cout << "Error: cannot write " << path << std::endl;
+			return FAILURE;
+		}
+		f << "benchmark,mode,ops,bytes,seconds,intensity,gflops,gbps,peak_gflops,peak_gbps,attainable_gflops,percent_of_roof\n";
+		for (size_t i = 0; i < samples_.size(); i++)
+		{
+			const RooflineSample &s = samples_[i];
+			f << s.benchmark << ',' << s.mode << ',' << s.ops << ',' << s.bytes << ',' << s.seconds << ','
+			  << s.intensity() << ',' << s.opsPerSecond() * 1e-9 << ',' << s.bytesPerSecond() * 1e-9 << ','
+			  << peakOps_ * 1e-9 << ',' << peakBandwidth_ * 1e-9 << ',' << attainable(s) * 1e-9 << ','
+			  << 100.0 * s.opsPerSecond() / attainable(s) << '\n';
+		}
+		std::cout << "Roofline data written to " << path << std::endl;
+		return SUCCESS;
+	}
+
+private:
+	Roofline() : peakBandwidth_(0.0), peakOps_(0.0) {}
+	Roofline(const Roofline &);
+	Roofline &operator=(const Roofline &);
+
+	std::vector<RooflineSample> samples_;
+	double peakBandwidth_;
+	double peakOps_;
+};
+
+#endif
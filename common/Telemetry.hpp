@@ -0,0 +1,264 @@
+/**********************************************************************
+Telemetry for long-running soak tests (Driver --soak).
+
+	SvmAccounting     live and peak bytes of SVM allocations; in the
+	                  driver build (SVM_BENCH_DRIVER) every clSVMAlloc /
+	                  clSVMFree after this header goes through it, and
+	                  the common headers that allocate SVM include it
+	residentBytes()   RSS from /proc/self/statm
+	RollingWindow     the last N run times of one benchmark mode:
+	                  throughput and percentiles over the window, and
+	                  drift of the median against the first runs (thermal
+	                  throttling shows up as a drift above 1)
+	GrowthDetector    flags a resource that grew in each of the last N
+	                  soak iterations
+	MetricsFile       Prometheus text exposition format, rewritten via a
+	                  temporary file and rename() so readers (a
+	                  node_exporter textfile collector, watch cat) never
+	                  see a partial file
+********************************************************************/
+
+#ifndef TELEMETRY_HPP
+#define TELEMETRY_HPP
+
+#include <CL/cl.h>
+#include <stdio.h>
+#include <unistd.h>
+#include <algorithm>
+#include <deque>
+#include <fstream>
+#include <mutex>
+#include <sstream>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+class SvmAccounting
+{
+public:
+	static SvmAccounting &instance()
+	{
+		static SvmAccounting accounting;
+		return accounting;
+	}
+
+	void *alloc(cl_context context, cl_svm_mem_flags flags, size_t size, cl_uint alignment)
+	{
+		void *ptr = clSVMAlloc(context, flags, size, alignment);
+		if (ptr != NULL)
+		{
+			std::lock_guard<std::mutex> lock(mutex_);
+			sizes_[ptr] = size;
+			bytes_ += size;
+			peak_ = std::max(peak_, bytes_);
+			allocations_++;
+		}
+		return ptr;
+	}
+
+	void free(cl_context context, void *ptr)
+	{
+		{
+			std::lock_guard<std::mutex> lock(mutex_);
+			std::unordered_map<void *, size_t>::iterator it = sizes_.find(ptr);
+			if (it != sizes_.end())
+			{
+				bytes_ -= it->second;
+				sizes_.erase(it);
+			}
+		}
+		clSVMFree(context, ptr);
+	}
+
+	size_t bytes() const { std::lock_guard<std::mutex> lock(mutex_); return bytes_; }
+	size_t peak() const { std::lock_guard<std::mutex> lock(mutex_); return peak_; }
+	size_t allocations() const { std::lock_guard<std::mutex> lock(mutex_); return allocations_; }
+	size_t live() const { std::lock_guard<std::mutex> lock(mutex_); return sizes_.size(); }
+
+private:
+	SvmAccounting() : bytes_(0), peak_(0), allocations_(0) {}
+
+	mutable std::mutex mutex_;
+	std::unordered_map<void *, size_t> sizes_;
+	size_t bytes_;
+	size_t peak_;
+	size_t allocations_;
+};
+
+inline void *trackedSVMAlloc(cl_context context, cl_svm_mem_flags flags, size_t size, cl_uint alignment)
+{
+	return SvmAccounting::instance().alloc(context, flags, size, alignment);
+}
+
+inline void trackedSVMFree(cl_context context, void *ptr)
+{
+	SvmAccounting::instance().free(context, ptr);
+}
+
+/* resident set size in bytes, 0 if /proc is unavailable */
+inline size_t residentBytes()
+{
+	std::ifstream statm("/proc/self/statm");
+	size_t size = 0, resident = 0;
+	if (!(statm >> size >> resident))
+		return 0;
+	return resident * (size_t)sysconf(_SC_PAGESIZE);
+}
+
+class RollingWindow
+{
+public:
+	explicit RollingWindow(size_t capacity = 64, size_t baselineRuns = 8)
+		: capacity_(capacity), baselineRuns_(baselineRuns), total_(0), failures_(0), baseline_(0.0) {}
+
+	void add(double seconds, bool failed = false)
+	{
+		samples_.push_back(seconds);
+		if (samples_.size() > capacity_)
+			samples_.pop_front();
+		total_++;
+		failures_ += failed;
+		if (baseline_ == 0.0 && total_ == baselineRuns_)
+			baseline_ = percentile(50);
+	}
+
+	size_t runs() const { return total_; }
+	size_t failures() const { return failures_; }
+
+	/* runs per second of busy time over the window */
+	double throughput() const
+	{
+		double sum = 0.0;
+		for (size_t i = 0; i < samples_.size(); i++)
+			sum += samples_[i];
+		return sum > 0.0 ? samples_.size() / sum : 0.0;
+	}
+
+	/* p in [0, 100], over the window */
+	double percentile(double p) const
+	{
+		if (samples_.empty())
+			return 0.0;
+		std::vector<double> sorted(samples_.begin(), samples_.end());
+		std::sort(sorted.begin(), sorted.end());
+		size_t index = (size_t)(p / 100.0 * (sorted.size() - 1) + 0.5);
+		return sorted[std::min(index, sorted.size() - 1)];
+	}
+
+	/* window median over the median of the first runs; 1 until known */
+	double drift() const { return baseline_ > 0.0 ? percentile(50) / baseline_ : 1.0; }
+
+private:
+	std::deque<double> samples_;
+	size_t capacity_;
+	size_t baselineRuns_;
+	size_t total_;
+	size_t failures_;
+	double baseline_;
+};
+
+class GrowthDetector
+{
+public:
+	/* suspect growth when each of the last window samples is above the
+	   one before and they rose by more than minGrowth overall; a single
+	   step followed by flat samples is not a leak */
+	GrowthDetector(const std::string &resource, size_t window, double minGrowth)
+		: resource_(resource), window_(window), minGrowth_(minGrowth), suspected_(false) {}
+
+	bool add(double value)
+	{
+		samples_.push_back(value);
+		if (samples_.size() > window_)
+			samples_.pop_front();
+		bool monotonic = samples_.size() == window_;
+		for (size_t i = 1; i < samples_.size() && monotonic; i++)
+			monotonic = samples_[i] > samples_[i - 1];
+		suspected_ = monotonic && growth() > minGrowth_;
+		return suspected_;
+	}
+
+	const std::string &resource() const { return resource_; }
+	bool suspected() const { return suspected_; }
+	double growth() const { return samples_.empty() ? 0.0 : samples_.back() - samples_.front(); }
+
+private:
+	std::string resource_;
+	size_t window_;
+	double minGrowth_;
+	bool suspected_;
+	std::deque<double> samples_;
+};
+
+class MetricsFile
+{
+public:
+	explicit MetricsFile(const std::string &path) : path_(path) {}
+
+	void gauge(const std::string &name, const std::string &help, double value, const std::string &labels = "")
+	{
+		sample(name, help, "gauge", value, labels);
+	}
+
+	void counter(const std::string &name, const std::string &help, double value, const std::string &labels = "")
+	{
+		sample(name, help, "counter", value, labels);
+	}
+
+	/* write everything sampled since the last flush */
+	bool flush()
+	{
+		std::string tmp = path_ + ".tmp";
+		std::ofstream out(tmp.c_str());
+		for (size_t f = 0; f < families_.size(); f++)
+		{
+			out << "# HELP " << families_[f].name << " " << families_[f].help << "\n"
+			    << "# TYPE " << families_[f].name << " " << families_[f].type << "\n";
+			for (size_t s = 0; s < families_[f].samples.size(); s++)
+				out << families_[f].samples[s] << "\n";
+		}
+		families_.clear();
+		out.close();
+		return out && rename(tmp.c_str(), path_.c_str()) == 0;
+	}
+
+	const std::string &path() const { return path_; }
+
+private:
+	struct Family
+	{
+		std::string name;
+		std::string help;
+		std::string type;
+		std::vector<std::string> samples;
+	};
+
+	void sample(const std::string &name, const std::string &help, const char *type, double value, const std::string &labels)
+	{
+		size_t f = 0;
+		while (f < families_.size() && families_[f].name != name)
+			f++;
+		if (f == families_.size())
+		{
+			Family family = { name, help, type, std::vector<std::string>() };
+			families_.push_back(family);
+		}
+		std::ostringstream line;
+		line.precision(9);
+		line << name;
+		if (!labels.empty())
+			line << "{" << labels << "}";
+		line << " " << value;
+		families_[f].samples.push_back(line.str());
+	}
+
+	std::string path_;
+	std::vector<Family> families_;
+};
+
+#ifdef SVM_BENCH_DRIVER
+#define clSVMAlloc trackedSVMAlloc
+#define clSVMFree trackedSVMFree
+#endif
+
+#endif
@@ -0,0 +1,459 @@
+/**********************************************************************
+Timeline of every enqueued OpenCL command and named host spans, exported
+as Chrome trace JSON (open in ui.perfetto.dev or chrome://tracing).
+
+Off unless SVM_TRACE is set to the output path ("1" writes trace.json):
+
+	SVM_TRACE=gemm.json ./prog
+
+CLSetup.hpp, and every common header that enqueues commands, includes
+this header, so in every program the clEnqueue* calls below go through
+traced wrappers: each command gets an event (the caller's, or one owned
+by the trace) and its QUEUED / SUBMIT / START / END profiling timestamps
+are read once it completes. Device timestamps are moved onto the host
+clock by pinning each command's QUEUED time to the moment its clEnqueue*
+call began, so host and device tracks line up without a common clock.
+Queues created without CL_QUEUE_PROFILING_ENABLE only contribute the
+host side of their calls.
+
+Host spans: every PhaseProfiler phase and every driver mode, or
+
+	{
+		TraceSpan span("upload");
+		...
+	}
+
+The file is written by Trace::instance().write(), or at exit.
+********************************************************************/
+
+#ifndef TRACE_HPP
+#define TRACE_HPP
+
+#include <CL/cl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <chrono>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <map>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+class Trace
+{
+public:
+	typedef std::chrono::steady_clock Clock;
+
+	static Trace &instance()
+	{
+		static Trace trace;
+		return trace;
+	}
+
+	/* SVM_TRACE is set; checked once */
+	static bool enabled()
+	{
+		static bool on = getenv("SVM_TRACE") != NULL && (instance(), true);
+		return on;
+	}
+
+	/* one enqueued command; takes over a reference to event */
+	void command(cl_command_queue queue, const char *kind, const std::string &name, size_t bytes,
+	             Clock::time_point callStart, Clock::time_point callEnd, cl_event event)
+	{
+		std::lock_guard<std::mutex> lock(mutex_);
+		Command c;
+		c.queue = queueId(queue);
+		c.thread = threadId();
+		c.kind = kind;
+		c.name = name;
+		c.bytes = bytes;
+		c.callStart = nanos(callStart);
+		c.callEnd = nanos(callEnd);
+		c.event = event;
+		c.queued = c.submit = c.start = c.end = -1;
+		pending_.push_back(c);
+		if (pending_.size() >= MAX_PENDING)
+			resolve(false);
+	}
+
+	void span(const std::string &name, const char *category, Clock::time_point start, Clock::time_point end)
+	{
+		std::lock_guard<std::mutex> lock(mutex_);
+		Span s = { name, category, threadId(), nanos(start), nanos(end) };
+		if (spans_.size() < MAX_RECORDS)
+			spans_.push_back(s);
+	}
+
+	/* wait for outstanding commands and write the JSON file */
+	bool write()
+	{
+		std::lock_guard<std::mutex> lock(mutex_);
+		written_ = true;
+		resolve(true);
+
+		const char *env = getenv("SVM_TRACE");
+		std::string path = env == NULL || std::string(env) == "1" ? "trace.json" : env;
+		std::ofstream out(path.c_str());
+		out << std::fixed << std::setprecision(3) << "{\"displayTimeUnit\":\"ns\",\"traceEvents\":[\n";
+		out << "{\"ph\":\"M\",\"pid\":1,\"name\":\"process_name\",\"args\":{\"name\":\"host\"}},\n"
+		    << "{\"ph\":\"M\",\"pid\":2,\"name\":\"process_name\",\"args\":{\"name\":\"OpenCL device\"}}";
+		for (size_t t = 0; t < threads_.size(); t++)
+			out << ",\n{\"ph\":\"M\",\"pid\":1,\"tid\":" << t << ",\"name\":\"thread_name\",\"args\":{\"name\":\"thread " << t << "\"}}";
+		for (size_t q = 0; q < queues_.size(); q++)
+			out << ",\n{\"ph\":\"M\",\"pid\":2,\"tid\":" << q << ",\"name\":\"thread_name\",\"args\":{\"name\":\"queue " << q << "\"}}";
+
+		for (size_t i = 0; i < spans_.size(); i++)
+		{
+			const Span &s = spans_[i];
+			out << ",\n{\"ph\":\"X\",\"pid\":1,\"tid\":" << s.thread << ",\"cat\":\"" << s.category
+			    << "\",\"name\":\"" << escape(s.name) << "\",\"ts\":" << s.start * 1e-3 << ",\"dur\":" << (s.end - s.start) * 1e-3 << "}";
+		}
+		for (size_t i = 0; i < done_.size(); i++)
+		{
+			const Command &c = done_[i];
+			std::string name = escape(c.name);
+			out << ",\n{\"ph\":\"X\",\"pid\":1,\"tid\":" << c.thread << ",\"cat\":\"api\",\"name\":\"enqueue " << name
+			    << "\",\"ts\":" << c.callStart * 1e-3 << ",\"dur\":" << (c.callEnd - c.callStart) * 1e-3 << "}";
+			if (c.start < 0)
+				continue;
+			out << ",\n{\"ph\":\"X\",\"pid\":2,\"tid\":" << c.queue << ",\"cat\":\"" << c.kind << "\",\"name\":\"" << name
+			    << "\",\"ts\":" << c.start * 1e-3 << ",\"dur\":" << (c.end - c.start) * 1e-3
+			    << ",\"args\":{\"queued_to_submit_us\":" << (c.submit - c.queued) * 1e-3
+			    << ",\"submit_to_start_us\":" << (c.start - c.submit) * 1e-3;
+			if (c.bytes > 0)
+				out << ",\"bytes\":" << c.bytes;
+			out << "}}";
+			out << ",\n{\"ph\":\"s\",\"id\":" << i << ",\"pid\":1,\"tid\":" << c.thread << ",\"cat\":\"flow\",\"name\":\"enqueue\",\"ts\":"
+			    << c.callStart * 1e-3 << "},\n{\"ph\":\"f\",\"bp\":\"e\",\"id\":" << i << ",\"pid\":2,\"tid\":" << c.queue
+			    << ",\"cat\":\"flow\",\"name\":\"enqueue\",\"ts\":" << c.start * 1e-3 << "}";
+		}
+		out << "\n]}\n";
+		out.close();
+		if (!out)
+		{
+			std::cout << "Error: cannot write trace " << path << std::endl;
+			return false;
+		}
+		std::cout << "Trace: " << done_.size() << " commands, " << spans_.size() << " spans in " << path
+		          << (dropped_ ? " (" + std::to_string(dropped_) + " commands dropped)" : std::string()) << std::endl;
+		return true;
+	}
+
+private:
+	static const size_t MAX_PENDING = 1024;       // unresolved events before a sweep
+	static const size_t MAX_RECORDS = 1 << 20;    // commands / spans kept; later ones are dropped
+
+	struct Command
+	{
+		int queue;
+		int thread;
+		std::string kind;
+		std::string name;
+		size_t bytes;
+		int64_t callStart, callEnd;             // host, ns since the trace began
+		cl_event event;
+		int64_t queued, submit, start, end;     // moved onto the host clock; -1 if unknown
+	};
+
+	struct Span
+	{
+		std::string name;
+		const char *category;
+		int thread;
+		int64_t start, end;
+	};
+
+	Trace() : origin_(Clock::now()), written_(false), dropped_(0) {}
+
+	~Trace()
+	{
+		if (!written_ && (!pending_.empty() || !done_.empty() || !spans_.empty()))
+			write();
+	}
+
+	int64_t nanos(Clock::time_point t) const
+	{
+		return std::chrono::duration_cast<std::chrono::nanoseconds>(t - origin_).count();
+	}
+
+	int queueId(cl_command_queue queue)
+	{
+		std::map<cl_command_queue, int>::iterator it = queues_.find(queue);
+		if (it != queues_.end())
+			return it->second;
+		int id = (int)queues_.size();
+		queues_[queue] = id;
+		return id;
+	}
+
+	int threadId()
+	{
+		std::thread::id self = std::this_thread::get_id();
+		for (size_t t = 0; t < threads_.size(); t++)
+			if (threads_[t] == self)
+				return (int)t;
+		threads_.push_back(self);
+		return (int)threads_.size() - 1;
+	}
+
+	/* read the timestamps of completed commands (of all, waiting, with
+	   wait) and release their events */
+	void resolve(bool wait)
+	{
+		std::vector<Command> still;
+		for (size_t i = 0; i < pending_.size(); i++)
+		{
+			Command &c = pending_[i];
+			cl_int state = CL_COMPLETE;
+			if (wait)
+				clWaitForEvents(1, &c.event);
+			clGetEventInfo(c.event, CL_EVENT_COMMAND_EXECUTION_STATUS, sizeof(state), &state, NULL);
+			if (state > CL_COMPLETE)
+			{
+				still.push_back(c);
+				continue;
+			}
+
+			cl_ulong t[4];
+			const cl_profiling_info info[4] = { CL_PROFILING_COMMAND_QUEUED, CL_PROFILING_COMMAND_SUBMIT,
+			                                    CL_PROFILING_COMMAND_START, CL_PROFILING_COMMAND_END };
+			bool profiled = state == CL_COMPLETE;
+			for (int k = 0; k < 4 && profiled; k++)
+				profiled = clGetEventProfilingInfo(c.event, info[k], sizeof(cl_ulong), &t[k], NULL) == CL_SUCCESS;
+			if (profiled)
+			{
+				c.queued = c.callStart;
+				c.submit = c.callStart + (int64_t)(t[1] - t[0]);
+				c.start = c.callStart + (int64_t)(t[2] - t[0]);
+				c.end = c.callStart + (int64_t)(t[3] - t[0]);
+			}
+			clReleaseEvent(c.event);
+			c.event = NULL;
+			if (done_.size() < MAX_RECORDS)
+				done_.push_back(c);
+			else
+				dropped_++;
+		}
+		pending_.swap(still);
+	}
+
+	static std::string escape(const std::string &s)
+	{
+		std::string out;
+		for (size_t i = 0; i < s.size(); i++)
+		{
+			if (s[i] == '"' || s[i] == '\\')
+				out += '\\';
+			out += s[i];
+		}
+		return out;
+	}
+
+	std::mutex mutex_;
+	Clock::time_point origin_;
+	std::vector<Command> pending_;
+	std::vector<Command> done_;
+	std::vector<Span> spans_;
+	std::map<cl_command_queue, int> queues_;
+	std::vector<std::thread::id> threads_;
+	bool written_;
+	size_t dropped_;
+};
+
+/* host span from construction to destruction */
+class TraceSpan
+{
+public:
+	explicit TraceSpan(const std::string &name, const char *category = "host")
+		: name_(name), category_(category), start_(Trace::Clock::now()) {}
+
+	~TraceSpan()
+	{
+		if (Trace::enabled())
+			Trace::instance().span(name_, category_, start_, Trace::Clock::now());
+	}
+
+private:
+	std::string name_;
+	const char *category_;
+	Trace::Clock::time_point start_;
+};
+
+/* Event plumbing shared by the wrappers: the command always gets an event;
+   the caller receives its own reference when it asked for one. */
+class TracedCall
+{
+public:
+	explicit TracedCall(cl_event *user) : user_(user), event_(NULL), start_(Trace::Clock::now()) {}
+
+	cl_event *event() { return &event_; }
+
+	void done(cl_command_queue queue, const char *kind, const std::string &name, size_t bytes, cl_int status)
+	{
+		Trace::Clock::time_point end = Trace::Clock::now();
+		if (status != CL_SUCCESS || event_ == NULL)
+			return;
+		if (user_ != NULL)
+		{
+			*user_ = event_;
+			clRetainEvent(event_);
+		}
+		Trace::instance().command(queue, kind, name, bytes, start_, end, event_);
+	}
+
+private:
+	cl_event *user_;
+	cl_event event_;
+	Trace::Clock::time_point start_;
+};
+
+inline std::string traceKernelName(cl_kernel kernel)
+{
+	char name[256] = "";
+	clGetKernelInfo(kernel, CL_KERNEL_FUNCTION_NAME, sizeof(name), name, NULL);
+	return name;
+}
+
+inline cl_int tracedEnqueueNDRangeKernel(cl_command_queue queue, cl_kernel kernel, cl_uint dims, const size_t *offset,
+                                         const size_t *global, const size_t *local, cl_uint numWait, const cl_event *wait, cl_event *event)
+{
+	if (!Trace::enabled())
+		return clEnqueueNDRangeKernel(queue, kernel, dims, offset, global, local, numWait, wait, event);
+	TracedCall call(event);
+	cl_int status = clEnqueueNDRangeKernel(queue, kernel, dims, offset, global, local, numWait, wait, call.event());
+	call.done(queue, "kernel", traceKernelName(kernel), 0, status);
+	return status;
+}
+
+inline cl_int tracedEnqueueReadBuffer(cl_command_queue queue, cl_mem buffer, cl_bool blocking, size_t offset, size_t size,
+                                      void *ptr, cl_uint numWait, const cl_event *wait, cl_event *event)
+{
+	if (!Trace::enabled())
+		return clEnqueueReadBuffer(queue, buffer, blocking, offset, size, ptr, numWait, wait, event);
+	TracedCall call(event);
+	cl_int status = clEnqueueReadBuffer(queue, buffer, blocking, offset, size, ptr, numWait, wait, call.event());
+	call.done(queue, "read", "ReadBuffer", size, status);
+	return status;
+}
+
+inline cl_int tracedEnqueueWriteBuffer(cl_command_queue queue, cl_mem buffer, cl_bool blocking, size_t offset, size_t size,
+                                       const void *ptr, cl_uint numWait, const cl_event *wait, cl_event *event)
+{
+	if (!Trace::enabled())
+		return clEnqueueWriteBuffer(queue, buffer, blocking, offset, size, ptr, numWait, wait, event);
+	TracedCall call(event);
+	cl_int status = clEnqueueWriteBuffer(queue, buffer, blocking, offset, size, ptr, numWait, wait, call.event());
+	call.done(queue, "write", "WriteBuffer", size, status);
+	return status;
+}
+
+inline cl_int tracedEnqueueFillBuffer(cl_command_queue queue, cl_mem buffer, const void *pattern, size_t patternSize,
+                                      size_t offset, size_t size, cl_uint numWait, const cl_event *wait, cl_event *event)
+{
+	if (!Trace::enabled())
+		return clEnqueueFillBuffer(queue, buffer, pattern, patternSize, offset, size, numWait, wait, event);
+	TracedCall call(event);
+	cl_int status = clEnqueueFillBuffer(queue, buffer, pattern, patternSize, offset, size, numWait, wait, call.event());
+	call.done(queue, "write", "FillBuffer", size, status);
+	return status;
+}
+
+inline cl_int tracedEnqueueWriteImage(cl_command_queue queue, cl_mem image, cl_bool blocking, const size_t *origin,
+                                      const size_t *region, size_t rowPitch, size_t slicePitch, const void *ptr,
+                                      cl_uint numWait, const cl_event *wait, cl_event *event)
+{
+	if (!Trace::enabled())
+		return clEnqueueWriteImage(queue, image, blocking, origin, region, rowPitch, slicePitch, ptr, numWait, wait, event);
+	TracedCall call(event);
+	cl_int status = clEnqueueWriteImage(queue, image, blocking, origin, region, rowPitch, slicePitch, ptr, numWait, wait, call.event());
+	call.done(queue, "write", "WriteImage", 0, status);
+	return status;
+}
+
+inline void *tracedEnqueueMapBuffer(cl_command_queue queue, cl_mem buffer, cl_bool blocking, cl_map_flags flags,
+                                    size_t offset, size_t size, cl_uint numWait, const cl_event *wait, cl_event *event,
+                                    cl_int *errcode)
+{
+	if (!Trace::enabled())
+		return clEnqueueMapBuffer(queue, buffer, blocking, flags, offset, size, numWait, wait, event, errcode);
+	TracedCall call(event);
+	cl_int status;
+	void *ptr = clEnqueueMapBuffer(queue, buffer, blocking, flags, offset, size, numWait, wait, call.event(), &status);
+	call.done(queue, "map", "MapBuffer", size, status);
+	if (errcode != NULL)
+		*errcode = status;
+	return ptr;
+}
+
+inline cl_int tracedEnqueueUnmapMemObject(cl_command_queue queue, cl_mem memobj, void *ptr,
+                                          cl_uint numWait, const cl_event *wait, cl_event *event)
+{
+	if (!Trace::enabled())
+		return clEnqueueUnmapMemObject(queue, memobj, ptr, numWait, wait, event);
+	TracedCall call(event);
+	cl_int status = clEnqueueUnmapMemObject(queue, memobj, ptr, numWait, wait, call.event());
+	call.done(queue, "unmap", "UnmapMemObject", 0, status);
+	return status;
+}
+
+inline cl_int tracedEnqueueSVMMap(cl_command_queue queue, cl_bool blocking, cl_map_flags flags, void *ptr, size_t size,
+                                  cl_uint numWait, const cl_event *wait, cl_event *event)
+{
+	if (!Trace::enabled())
+		return clEnqueueSVMMap(queue, blocking, flags, ptr, size, numWait, wait, event);
+	TracedCall call(event);
+	cl_int status = clEnqueueSVMMap(queue, blocking, flags, ptr, size, numWait, wait, call.event());
+	call.done(queue, "map", "SVMMap", size, status);
+	return status;
+}
+
+inline cl_int tracedEnqueueSVMUnmap(cl_command_queue queue, void *ptr, cl_uint numWait, const cl_event *wait, cl_event *event)
+{
+	if (!Trace::enabled())
+		return clEnqueueSVMUnmap(queue, ptr, numWait, wait, event);
+	TracedCall call(event);
+	cl_int status = clEnqueueSVMUnmap(queue, ptr, numWait, wait, call.event());
+	call.done(queue, "unmap", "SVMUnmap", 0, status);
+	return status;
+}
+
+inline cl_int tracedEnqueueSVMMemcpy(cl_command_queue queue, cl_bool blocking, void *dst, const void *src, size_t size,
+                                     cl_uint numWait, const cl_event *wait, cl_event *event)
+{
+	if (!Trace::enabled())
+		return clEnqueueSVMMemcpy(queue, blocking, dst, src, size, numWait, wait, event);
+	TracedCall call(event);
+	cl_int status = clEnqueueSVMMemcpy(queue, blocking, dst, src, size, numWait, wait, call.event());
+	call.done(queue, "copy", "SVMMemcpy", size, status);
+	return status;
+}
+
+inline cl_int tracedEnqueueSVMMemFill(cl_command_queue queue, void *ptr, const void *pattern, size_t patternSize, size_t size,
+                                      cl_uint numWait, const cl_event *wait, cl_event *event)
+{
+	if (!Trace::enabled())
+		return clEnqueueSVMMemFill(queue, ptr, pattern, patternSize, size, numWait, wait, event);
+	TracedCall call(event);
+	cl_int status = clEnqueueSVMMemFill(queue, ptr, pattern, patternSize, size, numWait, wait, call.event());
+	call.done(queue, "write", "SVMMemFill", size, status);
+	return status;
+}
+
+#define clEnqueueNDRangeKernel tracedEnqueueNDRangeKernel
+#define clEnqueueReadBuffer tracedEnqueueReadBuffer
+#define clEnqueueWriteBuffer tracedEnqueueWriteBuffer
+#define clEnqueueFillBuffer tracedEnqueueFillBuffer
+#define clEnqueueWriteImage tracedEnqueueWriteImage
+#define clEnqueueMapBuffer tracedEnqueueMapBuffer
+#define clEnqueueUnmapMemObject tracedEnqueueUnmapMemObject
+#define clEnqueueSVMMap tracedEnqueueSVMMap
+#define clEnqueueSVMUnmap tracedEnqueueSVMUnmap
+#define clEnqueueSVMMemcpy tracedEnqueueSVMMemcpy
+#define clEnqueueSVMMemFill tracedEnqueueSVMMemFill
+
+#endif